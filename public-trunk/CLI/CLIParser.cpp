@@ -778,6 +778,22 @@ int noise(int argc, char** argv, ostream& os)
         return SUCCESS;
 }
 
+int iqdump(int argc, char** argv, ostream& os)
+{
+	if (argc>2) return BAD_NUM_ARGS;
+
+	unsigned seconds = 0;
+	if (argc==2) seconds = atoi(argv[1]);
+
+	if (!gTRX.ARFCN(0)->dumpSamples(seconds)) {
+		os << "transceiver refused the dump, capture is off or a dump is running" << endl;
+		return SUCCESS;
+	}
+	os << "transceiver is writing captured samples to its working directory" << endl;
+
+	return SUCCESS;
+}
+
 int echofirst(int argc, char** argv, ostream& os)
 {
 	if (argc!=2) return BAD_NUM_ARGS;
@@ -900,6 +916,7 @@ Parser::Parser()
 	addCommand("power", power, "[minAtten maxAtten] -- report current attentuation or set min/max bounds");
         addCommand("rxgain", rxgain, "[newRxgain] -- get/set the RX gain in dB");
         addCommand("noise", noise, "-- report receive noise level in RSSI dB");
+	addCommand("iqdump", iqdump, "[seconds] -- have the transceiver write its recently captured raw samples to disk");
 	addCommand("unconfig", unconfig, "key -- remove a config value");
 	addCommand("notices", notices, "-- show startup copyright and legal notices");
 	addCommand("echo", echofirst, "<string> -- print <string> to the screen");
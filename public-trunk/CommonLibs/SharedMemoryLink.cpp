@@ -0,0 +1,251 @@
+/*
+* Copyright 2011 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "Threads.h"
+#include "SharedMemoryLink.h"
+
+
+/** Identifies a link segment of this layout. */
+static const uint32_t sSegmentMagic = 0x4f425453;	// "OBTS"
+static const uint32_t sSegmentVersion = 1;
+
+
+/**
+	One direction of a link.
+	The counters only ever increase; the slot index is the counter modulo
+	the ring size. Each counter has a cache line to itself, so the writer
+	and reader do not contend for lines they do not share.
+*/
+struct SharedMemoryRing {
+	volatile uint32_t head;			///< messages written, owned by the writer
+	char pad0[60];
+	volatile uint32_t tail;			///< messages read, owned by the reader
+	char pad1[60];
+	volatile int32_t sequence;		///< futex word, bumped to wake the reader
+	volatile int32_t waiting;		///< set while the reader may sleep
+	char pad2[56];
+	struct {
+		uint32_t length;
+		char data[SHMLINK_MAX_MESSAGE+4];
+	} slot[SHMLINK_SLOTS];
+};
+
+
+struct SharedMemorySegment {
+	uint32_t magic;
+	uint32_t version;
+	char pad[56];
+	SharedMemoryRing ring[2];
+};
+
+
+
+static int futexWait(volatile int32_t *addr, int32_t value, unsigned timeout)
+{
+	struct timespec ts;
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000000;
+	return syscall(SYS_futex, addr, FUTEX_WAIT, value, &ts, NULL, 0);
+}
+
+static int futexWake(volatile int32_t *addr)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+
+
+SharedMemoryLink::SharedMemoryLink()
+	:mSegment(NULL),mDropped(0)
+{
+}
+
+
+SharedMemoryLink::~SharedMemoryLink()
+{
+	close();
+}
+
+
+static SharedMemorySegment *mapSegment(int fd)
+{
+	void *ptr = mmap(NULL, sizeof(SharedMemorySegment),
+		PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (ptr==MAP_FAILED) {
+		CERR("WARNING -- mmap() failed for shared memory link, " << strerror(errno));
+		return NULL;
+	}
+	return (SharedMemorySegment*)ptr;
+}
+
+
+bool SharedMemoryLink::create(const char *name)
+{
+	close();
+
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0600);
+	if (fd<0) {
+		CERR("WARNING -- shm_open() failed for " << name << ", " << strerror(errno));
+		return false;
+	}
+	if (ftruncate(fd, sizeof(SharedMemorySegment))!=0) {
+		CERR("WARNING -- ftruncate() failed for " << name << ", " << strerror(errno));
+		::close(fd);
+		shm_unlink(name);
+		return false;
+	}
+
+	mSegment = mapSegment(fd);
+	if (!mSegment) {
+		shm_unlink(name);
+		return false;
+	}
+
+	// A new segment is zero-filled, so the rings start out empty.
+	mSegment->version = sSegmentVersion;
+	__sync_synchronize();
+	mSegment->magic = sSegmentMagic;
+	return true;
+}
+
+
+bool SharedMemoryLink::attach(const char *name)
+{
+	close();
+
+	int fd = shm_open(name, O_RDWR, 0600);
+	if (fd<0) {
+		CERR("WARNING -- shm_open() failed for " << name << ", " << strerror(errno));
+		return false;
+	}
+
+	struct stat st;
+	if ((fstat(fd,&st)!=0) || (st.st_size<(off_t)sizeof(SharedMemorySegment))) {
+		CERR("WARNING -- shared memory link " << name << " is too small");
+		::close(fd);
+		return false;
+	}
+
+	mSegment = mapSegment(fd);
+	if (!mSegment) return false;
+
+	// Both sides have it mapped now, so the name is no longer needed.
+	shm_unlink(name);
+
+	if ((mSegment->magic!=sSegmentMagic) || (mSegment->version!=sSegmentVersion)) {
+		CERR("WARNING -- shared memory link " << name << " has an unknown layout");
+		close();
+		return false;
+	}
+	return true;
+}
+
+
+void SharedMemoryLink::close()
+{
+	if (!mSegment) return;
+	munmap(mSegment, sizeof(SharedMemorySegment));
+	mSegment = NULL;
+}
+
+
+bool SharedMemoryLink::write(Direction dir, const char *buffer, size_t length)
+{
+	assert(mSegment);
+	assert(length<=SHMLINK_MAX_MESSAGE);
+	SharedMemoryRing &ring = mSegment->ring[dir];
+
+	uint32_t head = ring.head;
+	if (head - ring.tail >= SHMLINK_SLOTS) {
+		mDropped++;
+		return false;
+	}
+
+	unsigned ix = head % SHMLINK_SLOTS;
+	memcpy(ring.slot[ix].data, buffer, length);
+	ring.slot[ix].length = length;
+
+	// Publish the slot, then check for a sleeping reader.
+	// The full barrier pairs with the one in read().
+	__sync_synchronize();
+	ring.head = head + 1;
+	__sync_synchronize();
+	if (ring.waiting) {
+		__sync_fetch_and_add(&ring.sequence, 1);
+		futexWake(&ring.sequence);
+	}
+	return true;
+}
+
+
+int SharedMemoryLink::read(Direction dir, char *buffer, unsigned timeout)
+{
+	assert(mSegment);
+	SharedMemoryRing &ring = mSegment->ring[dir];
+
+	uint32_t tail = ring.tail;
+	if (ring.head == tail) {
+		// Announce the wait, then look again, so that a writer either
+		// sees the flag or its message is seen here.
+		int32_t sequence = ring.sequence;
+		ring.waiting = 1;
+		__sync_synchronize();
+		if (ring.head == tail) futexWait(&ring.sequence, sequence, timeout);
+		ring.waiting = 0;
+		if (ring.head == tail) return 0;
+	}
+
+	__sync_synchronize();
+	unsigned ix = tail % SHMLINK_SLOTS;
+	uint32_t length = ring.slot[ix].length;
+	// The peer can write anything into the segment, so check the length
+	// before copying, and skip the slot if it is bad.
+	if (length>SHMLINK_MAX_MESSAGE) {
+		CERR("WARNING -- dropped shared memory link message of " << length << " bytes");
+		length = 0;
+	}
+	else memcpy(buffer, ring.slot[ix].data, length);
+
+	// Release the slot only after the copy is complete.
+	__sync_synchronize();
+	ring.tail = tail + 1;
+	return length;
+}
+
+
+// vim: ts=4 sw=4
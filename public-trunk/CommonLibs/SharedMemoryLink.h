@@ -0,0 +1,122 @@
+/*
+* Copyright 2011 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef SHAREDMEMORYLINK_H
+#define SHAREDMEMORYLINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** Number of messages each direction of a link can hold. */
+#define SHMLINK_SLOTS 256
+
+/** Largest message a link can carry, in bytes. */
+#define SHMLINK_MAX_MESSAGE 248
+
+
+/** The layout of a link segment, shared by both processes. */
+struct SharedMemorySegment;
+
+
+/**
+	A message link between two processes on the same host, with one
+	single-producer, single-consumer ring per direction in a POSIX shared
+	memory segment. Messages are copied into fixed size slots and no
+	system call is made unless the reader is asleep; a sleeping reader
+	waits on a futex in the segment.
+
+	One side creates the segment and hands its name to the peer, which
+	attaches to it. Each direction must have only one writer thread and
+	one reader thread.
+*/
+class SharedMemoryLink {
+
+	public:
+
+	/** Link directions. */
+	enum Direction {
+		DOWNLINK = 0,		///< from the GSM core to the transceiver
+		UPLINK = 1			///< from the transceiver to the GSM core
+	};
+
+	private:
+
+	SharedMemorySegment *mSegment;		///< the mapped segment, or NULL
+	unsigned long mDropped;				///< writes refused because a ring was full
+
+	public:
+
+	SharedMemoryLink();
+
+	~SharedMemoryLink();
+
+	/**
+		Create and map a new segment, replacing any segment of that name.
+		@param name The POSIX shared memory name, starting with a slash.
+		@return true on success.
+	*/
+	bool create(const char *name);
+
+	/**
+		Map a segment created by the peer, and remove its name.
+		@param name The name the peer passed to create().
+		@return true on success.
+	*/
+	bool attach(const char *name);
+
+	/** Unmap the segment. */
+	void close();
+
+	/** True when a segment is mapped. */
+	bool active() const { return mSegment!=NULL; }
+
+	/**
+		Queue a message, without blocking.
+		@param dir The direction to write.
+		@param buffer The message bytes.
+		@param length The message length, at most SHMLINK_MAX_MESSAGE.
+		@return true on success, false if the ring is full.
+	*/
+	bool write(Direction dir, const char *buffer, size_t length);
+
+	/**
+		Dequeue a message, waiting for one if the ring is empty.
+		@param dir The direction to read.
+		@param buffer A buffer of at least SHMLINK_MAX_MESSAGE bytes.
+		@param timeout The longest time to wait in milliseconds.
+		@return The message length, or 0 if none arrived in time or
+			the message was longer than SHMLINK_MAX_MESSAGE.
+	*/
+	int read(Direction dir, char *buffer, unsigned timeout);
+
+	/** Number of writes refused because a ring was full. */
+	unsigned long dropped() const { return mDropped; }
+
+};
+
+
+#endif
+// vim: ts=4 sw=4
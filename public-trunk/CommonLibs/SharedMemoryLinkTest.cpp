@@ -0,0 +1,165 @@
+/*
+* Copyright 2011 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+*
+* This use of this software may be subject to additional restrictions.
+* See the LEGAL file in the main directory for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "SharedMemoryLink.h"
+#include "Threads.h"
+#include "Timeval.h"
+
+using namespace std;
+
+
+static int gFailures = 0;
+
+static void check(bool ok, const char *what)
+{
+	COUT((ok ? "ok: " : "FAILED: ") << what);
+	if (!ok) gFailures++;
+}
+
+
+// Fill a message whose bytes depend on its sequence number.
+static size_t makeMessage(char *buffer, unsigned seq)
+{
+	size_t length = 1 + seq % SHMLINK_MAX_MESSAGE;
+	for (size_t i=0; i<length; i++) buffer[i] = (char)(seq + i);
+	return length;
+}
+
+static bool checkMessage(const char *buffer, int length, unsigned seq)
+{
+	char expected[SHMLINK_MAX_MESSAGE];
+	if (length!=(int)makeMessage(expected,seq)) return false;
+	return memcmp(buffer,expected,length)==0;
+}
+
+
+SharedMemoryLink gCore;
+SharedMemoryLink gTrx;
+
+static const unsigned sWakeupCount = 1000;
+
+void* wakeupWriter(void*)
+{
+	char buffer[SHMLINK_MAX_MESSAGE];
+	for (unsigned seq=0; seq<sWakeupCount; seq++) {
+		size_t length = makeMessage(buffer,seq);
+		while (!gCore.write(SharedMemoryLink::DOWNLINK,buffer,length)) usleep(100);
+		// Let the reader go to sleep now and then.
+		if (seq%100==0) usleep(10000);
+	}
+	return NULL;
+}
+
+
+int main(int argc, char *argv[])
+{
+	char name[64];
+	sprintf(name,"/SharedMemoryLinkTest.%d",getpid());
+	char buffer[SHMLINK_MAX_MESSAGE];
+
+	// create and attach
+	check(gCore.create(name),"create");
+	check(gTrx.attach(name),"attach");
+	check(gCore.active() && gTrx.active(),"both sides active");
+	SharedMemoryLink late;
+	check(!late.attach(name),"name removed after attach");
+
+	// a message each way
+	size_t length = makeMessage(buffer,7);
+	check(gCore.write(SharedMemoryLink::DOWNLINK,buffer,length),"downlink write");
+	int got = gTrx.read(SharedMemoryLink::DOWNLINK,buffer,100);
+	check(checkMessage(buffer,got,7),"downlink read");
+	length = makeMessage(buffer,SHMLINK_MAX_MESSAGE-1);
+	check(gTrx.write(SharedMemoryLink::UPLINK,buffer,length),"uplink write of the largest message");
+	got = gCore.read(SharedMemoryLink::UPLINK,buffer,100);
+	check(checkMessage(buffer,got,SHMLINK_MAX_MESSAGE-1),"uplink read of the largest message");
+
+	// timeout on an empty ring
+	Timeval start;
+	got = gTrx.read(SharedMemoryLink::DOWNLINK,buffer,50);
+	long waited = start.elapsed();
+	check(got==0,"empty read returns nothing");
+	check((waited>=40) && (waited<1000),"empty read waits for the timeout");
+
+	// wraparound, several passes over the slots, half a ring in flight
+	bool inOrder = true;
+	unsigned readSeq = 0;
+	for (unsigned seq=0; seq<4*SHMLINK_SLOTS; seq++) {
+		length = makeMessage(buffer,seq);
+		if (!gCore.write(SharedMemoryLink::DOWNLINK,buffer,length)) inOrder = false;
+		if (seq<SHMLINK_SLOTS/2) continue;
+		got = gTrx.read(SharedMemoryLink::DOWNLINK,buffer,0);
+		if (!checkMessage(buffer,got,readSeq++)) inOrder = false;
+	}
+	while (readSeq<4*SHMLINK_SLOTS) {
+		got = gTrx.read(SharedMemoryLink::DOWNLINK,buffer,0);
+		if (!checkMessage(buffer,got,readSeq++)) inOrder = false;
+	}
+	check(inOrder,"messages intact across ring wraparound");
+	check(gCore.dropped()==0,"no writes refused while draining");
+
+	// full ring
+	unsigned written = 0;
+	for (unsigned seq=0; seq<SHMLINK_SLOTS; seq++) {
+		length = makeMessage(buffer,seq);
+		if (gCore.write(SharedMemoryLink::DOWNLINK,buffer,length)) written++;
+	}
+	check(written==SHMLINK_SLOTS,"ring holds SHMLINK_SLOTS messages");
+	length = makeMessage(buffer,SHMLINK_SLOTS);
+	check(!gCore.write(SharedMemoryLink::DOWNLINK,buffer,length),"write to a full ring refused");
+	check(gCore.dropped()==1,"refused write counted");
+	got = gTrx.read(SharedMemoryLink::DOWNLINK,buffer,0);
+	check(checkMessage(buffer,got,0),"oldest message kept when full");
+	check(gCore.write(SharedMemoryLink::DOWNLINK,buffer,got),"write after a read");
+	for (unsigned seq=1; seq<=SHMLINK_SLOTS; seq++)
+		gTrx.read(SharedMemoryLink::DOWNLINK,buffer,0);
+	check(gTrx.read(SharedMemoryLink::DOWNLINK,buffer,0)==0,"ring drained");
+
+	// a sleeping reader is woken by the writer thread
+	Thread writer;
+	writer.start(wakeupWriter,NULL);
+	inOrder = true;
+	for (unsigned seq=0; seq<sWakeupCount; seq++) {
+		got = gTrx.read(SharedMemoryLink::DOWNLINK,buffer,1000);
+		if (!checkMessage(buffer,got,seq)) inOrder = false;
+	}
+	writer.join();
+	check(inOrder,"messages from another thread");
+
+	gTrx.close();
+	gCore.close();
+	check(!gCore.active(),"closed");
+
+	COUT((gFailures ? "FAILED" : "PASSED"));
+	return gFailures ? 1 : 0;
+}
+
+// vim: ts=4 sw=4
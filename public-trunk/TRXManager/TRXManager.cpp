@@ -138,10 +138,30 @@ void TransceiverManager::clockHandler()
 
 void ::ARFCNManager::start()
 {
+	if (gConfig.defines("TRX.SharedMemory")) openBurstLink();
 	mRxThread.start((void*(*)(void*))ReceiveLoopAdapter,this);
 }
 
 
+bool ::ARFCNManager::openBurstLink()
+{
+	// The transceiver names the segment after its end of the data socket.
+	int status = sendCommand("SHMOPEN");
+	if (status!=0) {
+		LOG(ALARM) << "SHMOPEN failed with status " << status << ", keeping the data socket";
+		return false;
+	}
+	char name[32];
+	sprintf(name,"/openbts-trx-%d",mDataSocket.port()-100);
+	if (!mBurstLink.attach(name)) {
+		LOG(ALARM) << "cannot attach to " << name << ", keeping the data socket";
+		return false;
+	}
+	LOG(NOTICE) << "burst link to transceiver is " << name;
+	return true;
+}
+
+
 void ::ARFCNManager::installDecoder(GSM::L1Decoder *wL1d)
 {
 	unsigned TN = wL1d->TN();
@@ -192,9 +212,12 @@ void ::ARFCNManager::writeHighSide(const GSM::TxBurst& burst)
 	for (unsigned i=0; i<gSlotLen; i++) {
 		*wp++ = (unsigned char)((*dp++) & 0x01);
 	}
-	// write to the socket
+	// write to the link or the socket
 	mDataSocketLock.lock();
-	mDataSocket.write(buffer,bufferSize);
+	if (!mBurstLink.active()) mDataSocket.write(buffer,bufferSize);
+	else if (!mBurstLink.write(SharedMemoryLink::DOWNLINK,buffer,bufferSize)) {
+		LOG(WARN) << "burst link full, dropping burst for " << burst.time();
+	}
 	mDataSocketLock.unlock();
 }
 
@@ -205,8 +228,15 @@ void ::ARFCNManager::driveRx()
 {
 	// read the message
 	char buffer[MAX_UDP_LENGTH];
-	int msgLen = mDataSocket.read(buffer);
-	if (msgLen<=0) SOCKET_ERROR;
+	int msgLen;
+	if (mBurstLink.active()) {
+		// Wait in short steps so the thread can still be cancelled.
+		msgLen = mBurstLink.read(SharedMemoryLink::UPLINK,buffer,100);
+		if (msgLen==0) return;
+	} else {
+		msgLen = mDataSocket.read(buffer);
+		if (msgLen<=0) SOCKET_ERROR;
+	}
 	// decode
 	unsigned char *rp = (unsigned char*)buffer;
 	// timeslot number
@@ -455,6 +485,30 @@ bool ::ARFCNManager::setMaxDelay(unsigned km)
         return true;
 }
 
+bool ::ARFCNManager::setDFEDistance(unsigned channelPercent, unsigned SNRdB)
+{
+	char paramBuf[MAX_UDP_LENGTH];
+	sprintf(paramBuf,"%u %u", channelPercent, SNRdB);
+	int status = sendCommand("SETDFE",paramBuf);
+	if (status!=0) {
+		LOG(ALARM) << "SETDFE failed with status " << status;
+		return false;
+	}
+	return true;
+}
+
+bool ::ARFCNManager::setEqualizer(unsigned combo, unsigned memory)
+{
+	char paramBuf[MAX_UDP_LENGTH];
+	sprintf(paramBuf,"%u %u", combo, memory);
+	int status = sendCommand("SETEQ",paramBuf);
+	if (status!=0) {
+		LOG(ALARM) << "SETEQ failed with status " << status;
+		return false;
+	}
+	return true;
+}
+
 signed ::ARFCNManager::setRxGain(signed rxGain)
 {
         signed newRxGain;
@@ -477,6 +531,16 @@ signed ::ARFCNManager::getNoiseLevel(void)
         return noiselevel;
 }
 
+bool ::ARFCNManager::dumpSamples(unsigned seconds)
+{
+	int status = sendCommand("IQDUMP",seconds);
+	if (status!=0) {
+		LOG(WARN) << "IQDUMP failed with status " << status;
+		return false;
+	}
+	return true;
+}
+
 void ::ARFCNManager::receiveBurst(const RxBurst& inBurst)
 {
 	LOG(DEEPDEBUG) << "receiveBurst: " << inBurst;
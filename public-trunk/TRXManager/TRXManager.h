@@ -33,6 +33,7 @@
 
 #include "Threads.h"
 #include "Sockets.h"
+#include "SharedMemoryLink.h"
 #include "Interthread.h"
 #include "GSMCommon.h"
 #include "GSMTransfer.h"
@@ -119,6 +120,7 @@ class ARFCNManager {
 	UDPSocket mDataSocket;			///< socket for data transfer
 	Mutex mControlLock;				///< lock to prevent overlapping transactions
 	UDPSocket mControlSocket;		///< socket for radio control
+	SharedMemoryLink mBurstLink;	///< shared memory burst link, replaces the data socket once attached
 
 	Thread mRxThread;				///< thread to receive data from rx
 
@@ -136,7 +138,11 @@ class ARFCNManager {
 
 	ARFCNManager(const char* wTRXAddress, int wBasePort, TransceiverManager &wTRX);
 
-	/** Start the uplink thread. */
+	/**
+		Start the uplink thread.
+		If TRX.SharedMemory is defined, the burst traffic is first moved
+		to a shared memory link, keeping the data socket if that fails.
+	*/
 	void start();
 
 	unsigned ARFCN() const { return mARFCN; }
@@ -174,6 +180,22 @@ class ARFCNManager {
         */
         bool setMaxDelay(unsigned km);
 
+	/**
+		Set how far the channel may move before the equalizer is redesigned.
+		@param channelPercent Relative change of the channel estimate, in percent.
+		@param SNRdB Change of the SNR estimate, in dB.
+		@return true on success.
+	*/
+	bool setDFEDistance(unsigned channelPercent, unsigned SNRdB);
+
+	/**
+		Select the equalizer for slots of a given channel combination.
+		@param combo Channel combination, GSM 05.02 6.4.1.
+		@param memory MLSE channel memory in symbols, 2..5, or 0 for the DFE.
+		@return true on success.
+	*/
+	bool setEqualizer(unsigned combo, unsigned memory);
+
         /**     
                 Set radio receive gain.
                 @param new desired gain in dB.
@@ -209,6 +231,13 @@ class ARFCNManager {
 	*/
 	bool setSlot(unsigned TN, unsigned combo);
 
+	/**
+		Have the transceiver write its recent raw samples to disk.
+		@param seconds How many seconds back to go, 0 for all captured.
+		@return true on success.
+	*/
+	bool dumpSamples(unsigned seconds);
+
 	//@}
 
 
@@ -225,6 +254,9 @@ class ARFCNManager {
 	/** Demultiplex and process a received burst. */
 	void receiveBurst(const GSM::RxBurst&);
 
+	/** Negotiate the shared memory burst link with the transceiver. */
+	bool openBurstLink();
+
 	/** Receiver loop. */
 	friend void* ReceiveLoopAdapter(ARFCNManager*);
 
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "FileDevice.h"
+#include "Logger.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+FileDevice::FileDevice(double rate, const std::string &rx_file,
+		       const std::string &tx_file, int flags)
+	: smpl_rt(rate), rx_path(rx_file), tx_path(tx_file), flags(flags),
+	  tx_freq(0.0), rx_freq(0.0), tx_gain(0.0), rx_gain(0.0),
+	  rx_map(NULL), rx_map_len(0), rx_smpls(NULL), rx_len(0),
+	  start_ts(0), rx_ended(false), tx_fd(-1), rx_cnt(0), tx_cnt(0)
+{
+	memset(&start_time, 0, sizeof(start_time));
+}
+
+FileDevice::~FileDevice()
+{
+	if (rx_map)
+		munmap(rx_map, rx_map_len);
+	if (tx_fd >= 0)
+		close(tx_fd);
+}
+
+/* Map the whole receive file, samples are copied straight out of the map */
+bool FileDevice::openRx()
+{
+	struct stat st;
+	int fd;
+
+	fd = ::open(rx_path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		LOG(ALARM) << "Cannot open " << rx_path << ": " << strerror(errno);
+		return false;
+	}
+
+	if (fstat(fd, &st) || (st.st_size < (off_t) (2 * sizeof(short)))) {
+		LOG(ALARM) << "Sample file " << rx_path << " is empty";
+		close(fd);
+		return false;
+	}
+
+	rx_map_len = st.st_size;
+	rx_map = mmap(NULL, rx_map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (rx_map == MAP_FAILED) {
+		LOG(ALARM) << "Cannot map " << rx_path << ": " << strerror(errno);
+		rx_map = NULL;
+		return false;
+	}
+
+	size_t offset = 0;
+	IQFileHeader *hdr = (IQFileHeader *) rx_map;
+
+	if ((rx_map_len >= sizeof(*hdr)) && (hdr->magic == IQFILE_MAGIC)) {
+		if ((hdr->version != IQFILE_VERSION) ||
+		    (hdr->headerLen < sizeof(*hdr)) ||
+		    (hdr->headerLen >= rx_map_len) || (hdr->headerLen % 4)) {
+			LOG(ALARM) << "Sample file " << rx_path
+				   << " has an unsupported header";
+			return false;
+		}
+
+		if (fabs(hdr->sampleRate - smpl_rt) > 1.0) {
+			LOG(WARN) << "Sample file " << rx_path << " was recorded at "
+				  << hdr->sampleRate << " Hz, replaying at "
+				  << smpl_rt << " Hz";
+		}
+
+		offset = hdr->headerLen;
+		start_ts = hdr->timestamp;
+	}
+
+	rx_smpls = (short *) ((char *) rx_map + offset);
+	rx_len = (rx_map_len - offset) / (2 * sizeof(short));
+
+	LOG(INFO) << "Replaying " << rx_len << " samples from " << rx_path
+		  << " starting at timestamp " << start_ts;
+
+	return true;
+}
+
+/* Start the transmit file with a header matching the receive timestamps */
+bool FileDevice::openTx()
+{
+	IQFileHeader hdr;
+
+	tx_fd = ::open(tx_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (tx_fd < 0) {
+		LOG(ALARM) << "Cannot open " << tx_path << ": " << strerror(errno);
+		return false;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = IQFILE_MAGIC;
+	hdr.version = IQFILE_VERSION;
+	hdr.headerLen = sizeof(hdr);
+	hdr.sampleRate = smpl_rt;
+	hdr.timestamp = start_ts;
+
+	if (pwrite(tx_fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) {
+		LOG(ALARM) << "Cannot write " << tx_path << ": " << strerror(errno);
+		return false;
+	}
+
+	return true;
+}
+
+bool FileDevice::open()
+{
+	LOG(INFO) << "Opening file device at " << smpl_rt << " Hz";
+
+	if (!rx_path.empty() && !openRx())
+		return false;
+
+	if (!tx_path.empty() && !openTx())
+		return false;
+
+	return true;
+}
+
+bool FileDevice::start()
+{
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	return true;
+}
+
+bool FileDevice::stop()
+{
+	return true;
+}
+
+/* Wait until the wall clock reaches the time of 'timestamp' */
+void FileDevice::pace(TIMESTAMP timestamp)
+{
+	if ((flags & REPLAY_FAST) || (timestamp <= start_ts))
+		return;
+
+	double secs = (double) (timestamp - start_ts) / smpl_rt;
+	struct timespec ts = start_time;
+
+	ts.tv_sec += (time_t) secs;
+	ts.tv_nsec += (long) ((secs - floor(secs)) * 1e9);
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+int FileDevice::readSamples(short *buf, int len, bool *overrun,
+			    TIMESTAMP timestamp, bool *underrun, unsigned *RSSI)
+{
+	/* A file never overruns or underruns */
+	*overrun = false;
+	*underrun = false;
+
+	pace(timestamp + len);
+
+	for (int i = 0; i < len; ) {
+		TIMESTAMP ts = timestamp + i;
+		uint64_t pos, num;
+
+		/* Zeros before the file starts or once it has ended */
+		if ((ts < start_ts) || !rx_len ||
+		    (!(flags & REPLAY_LOOP) && (ts - start_ts >= rx_len))) {
+			if (rx_len && (ts >= start_ts) && !rx_ended) {
+				LOG(NOTICE) << "End of sample file " << rx_path;
+				rx_ended = true;
+			}
+
+			num = len - i;
+			if (ts < start_ts && start_ts - ts < num)
+				num = start_ts - ts;
+
+			memset(&buf[2 * i], 0, num * 2 * sizeof(short));
+			i += num;
+			continue;
+		}
+
+		pos = (ts - start_ts) % rx_len;
+		num = rx_len - pos;
+		if (num > (uint64_t) (len - i))
+			num = len - i;
+
+		memcpy(&buf[2 * i], &rx_smpls[2 * pos], num * 2 * sizeof(short));
+		i += num;
+	}
+
+	rx_cnt += len;
+
+	return len;
+}
+
+int FileDevice::writeSamples(short *buf, int len, bool *underrun,
+			     TIMESTAMP timestamp, bool isControl)
+{
+	*underrun = false;
+
+	if (isControl) {
+		LOG(ERROR) << "Control packets not supported";
+		return 0;
+	}
+
+	tx_cnt += len;
+
+	if ((tx_fd < 0) || (timestamp < start_ts))
+		return len;
+
+	off_t offset = sizeof(IQFileHeader) +
+		       (off_t) (timestamp - start_ts) * 2 * sizeof(short);
+	size_t size = len * 2 * sizeof(short);
+
+	if (pwrite(tx_fd, buf, size, offset) != (ssize_t) size)
+		LOG(ERROR) << "Cannot write " << tx_path << ": " << strerror(errno);
+
+	return len;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef FILEDEVICE_H
+#define FILEDEVICE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+
+#include "radioDevice.h"
+
+/* "IQ16" read as a little endian word */
+#define IQFILE_MAGIC		0x36315149
+#define IQFILE_VERSION		1
+
+/*
+    IQ file header - Optional header of a sample file. Samples follow at
+                     'headerLen' bytes as interleaved 16-bit I and Q in host
+                     byte order. A file without the magic word is taken to
+                     be raw samples starting at timestamp 0.
+*/
+struct IQFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerLen;	/* bytes before the first sample */
+	uint32_t reserved;
+	double sampleRate;	/* samples per second */
+	uint64_t timestamp;	/* device timestamp of the first sample */
+};
+
+/*
+    FileDevice - Radio device that replays received samples from a file
+                 and writes transmitted samples to another, so the
+                 transceiver runs without hardware.
+
+                 A read returns the file samples for the requested
+                 timestamp, counted from the timestamp of the first file
+                 sample. Reads before the start of the file or past its end
+                 return zeros, or the replay wraps around if looping. Each
+                 write lands at the file position of its timestamp, so
+                 gaps are left as zeros and the output is the same from
+                 run to run. Without a transmit file, samples are
+                 discarded.
+
+                 In real time mode a read does not return before the wall
+                 clock reaches the time of its last sample, otherwise the
+                 replay runs as fast as the transceiver consumes it.
+*/
+class FileDevice : public RadioDevice {
+public:
+	enum {
+		REPLAY_LOOP = 0x01,	/* wrap around at the end of the file */
+		REPLAY_FAST = 0x02,	/* do not pace reads to the wall clock */
+	};
+
+	FileDevice(double rate, const std::string &rx_file,
+		   const std::string &tx_file, int flags = 0);
+	~FileDevice();
+
+	bool open();
+	bool start();
+	bool stop();
+	void setPriority() { }
+	enum busType getBus() { return NET; }
+
+	int readSamples(short *buf, int len, bool *overrun,
+			TIMESTAMP timestamp, bool *underrun, unsigned *RSSI);
+
+	int writeSamples(short *buf, int len, bool *underrun,
+			 TIMESTAMP timestamp, bool isControl);
+
+	bool updateAlignment(TIMESTAMP timestamp) { return true; }
+
+	bool setTxFreq(double wFreq) { tx_freq = wFreq; return true; }
+	bool setRxFreq(double wFreq) { rx_freq = wFreq; return true; }
+
+	TIMESTAMP initialWriteTimestamp() { return start_ts; }
+	TIMESTAMP initialReadTimestamp() { return start_ts; }
+
+	double fullScaleInputValue() { return 32000; }
+	double fullScaleOutputValue() { return 32000; }
+
+	/* Gains are recorded and reported but have no effect */
+	double setRxGain(double db) { rx_gain = db; return rx_gain; }
+	double getRxGain(void) { return rx_gain; }
+	double maxRxGain(void) { return 100.0; }
+	double minRxGain(void) { return 0.0; }
+
+	double setTxGain(double db) { tx_gain = db; return tx_gain; }
+	double maxTxGain(void) { return 100.0; }
+	double minTxGain(void) { return 0.0; }
+
+	double getTxFreq() { return tx_freq; }
+	double getRxFreq() { return rx_freq; }
+
+	double getSampleRate() { return smpl_rt; }
+	double numberRead() { return rx_cnt; }
+	double numberWritten() { return tx_cnt; }
+
+private:
+	double smpl_rt;
+	std::string rx_path, tx_path;
+	int flags;
+
+	double tx_freq, rx_freq;
+	double tx_gain, rx_gain;
+
+	void *rx_map;
+	size_t rx_map_len;
+	short *rx_smpls;
+	uint64_t rx_len;
+	TIMESTAMP start_ts;
+	bool rx_ended;
+
+	int tx_fd;
+
+	uint64_t rx_cnt, tx_cnt;
+	struct timespec start_time;
+
+	bool openRx();
+	bool openTx();
+	void pace(TIMESTAMP timestamp);
+};
+
+#endif /* FILEDEVICE_H */
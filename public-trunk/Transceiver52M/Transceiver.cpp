@@ -32,20 +32,31 @@
 #include "Transceiver.h"
 #include <Logger.h>
 
+/** Bursts held by the radioVector pools: every filler table entry, plus
+    room for the transmit queue and the receive FIFO */
+#define RADIOVECTOR_POOL_SIZE (102*8 + 256)
+
+/** The correlation sequences of sigProcLib are shared by the transceivers
+    of a multi-carrier interface and regenerated by control commands, so
+    demodulation holds this lock for reading and regeneration for writing */
+static pthread_rwlock_t sigProcLock = PTHREAD_RWLOCK_INITIALIZER;
 
 
 Transceiver::Transceiver(int wBasePort,
 			 const char *TRXAddress,
 			 int wSamplesPerSymbol,
 			 GSM::Time wTransmitLatency,
-			 RadioInterface *wRadioInterface)
-	:mDataSocket(wBasePort+2,TRXAddress,wBasePort+102),
-	 mControlSocket(wBasePort+1,TRXAddress,wBasePort+101),
-	 mClockSocket(wBasePort,TRXAddress,wBasePort+100)
+			 RadioInterface *wRadioInterface,
+			 int wChan)
+	:mDataSocket(wBasePort+2+2*wChan,TRXAddress,wBasePort+102+2*wChan),
+	 mControlSocket(wBasePort+1+2*wChan,TRXAddress,wBasePort+101+2*wChan),
+	 mClockSocket(wChan ? 0 : wBasePort,TRXAddress,wBasePort+100),
+	 mTxBurstBits(gSlotLen)
 {
   //GSM::Time startTime(0,0);
   //GSM::Time startTime(gHyperframe/2 - 4*216*60,0);
   GSM::Time startTime(random() % gHyperframe,0);
+  if (wChan > 0) startTime = wRadioInterface->getClock()->get();
 
   mFIFOServiceLoopThread = new Thread(32768);  ///< thread to push bursts into transmit FIFO
   mControlServiceLoopThread = new Thread(32768);       ///< thread to process control messages from GSM core
@@ -54,17 +65,26 @@ Transceiver::Transceiver(int wBasePort,
 
   mSamplesPerSymbol = wSamplesPerSymbol;
   mRadioInterface = wRadioInterface;
+  mChan = wChan;
   mTransmitLatency = wTransmitLatency;
   mTransmitDeadlineClock = startTime;
   mLastClockUpdateTime = startTime;
   mLatencyUpdateTime = startTime;
-  mRadioInterface->getClock()->set(startTime);
+  // never below the one frame and one timeslot of the old fixed floor
+  mLatencyControl = new TxLatencyController(mTransmitLatency.FN()*8 + mTransmitLatency.TN(),
+                                            9, TXLATENCY_MAX);
+  if (mChan == 0) mRadioInterface->getClock()->set(startTime);
   mMaxExpectedDelay = 0;
+  for (int i = 0; i <= LOOPBACK; i++)
+    mEqualizer[i] = 0;
+
+  radioVector::initPools(157*mSamplesPerSymbol,
+                         RADIOVECTOR_POOL_SIZE*mRadioInterface->numChans());
 
   // generate pulse and setup up signal processing library
   gsmPulse = generateGSMPulse(2,mSamplesPerSymbol);
   LOG(DEBUG) << "gsmPulse: " << *gsmPulse;
-  sigProcLibSetup(mSamplesPerSymbol);
+  if (mChan == 0) sigProcLibSetup(mSamplesPerSymbol);
 
   txFullScale = mRadioInterface->fullScaleInputValue();
   rxFullScale = mRadioInterface->fullScaleOutputValue();
@@ -77,14 +97,11 @@ Transceiver::Transceiver(int wBasePort,
     scaleVector(*modBurst,txFullScale);
     fillerModulus[i]=26;
     for (int j = 0; j < 102; j++) {
-      fillerTable[j][i] = new signalVector(*modBurst);
+      fillerTable[j][i] = new radioVector(*modBurst,startTime);
     }
     delete modBurst;
     mChanType[i] = NONE;
-    channelResponse[i] = NULL;
-    DFEForward[i] = NULL;
-    DFEFeedback[i] = NULL;
-    channelEstimateTime[i] = startTime;
+    rxBurstBits[i] = NULL;
   }
 
   mOn = false;
@@ -92,13 +109,33 @@ Transceiver::Transceiver(int wBasePort,
   mRxFreq = 0.0;
   mPower = -10;
   mEnergyThreshold = 5.0; // based on empirical data
+  memset(mRxActive,0,sizeof(mRxActive));
+  mNoiseFloor = 0.0;
   prevFalseDetectionTime = startTime;
+  mRxStatsTime = startTime;
+  mRxDropped = 0;
+  mLinkDropped = 0;
+  mRxControlShed = 0;
+  mLastDumpTime = startTime;
+  memset(&mTxStats,0,sizeof(mTxStats));
+  mNumDemodWorkers = 0;
+  mDemodStarted = 0;
+  mDemodHead = 0;
+  mDemodCount = 0;
+  mDeliveryThread = NULL;
+  mDemodCPU = -1;
+  mDeliveryCPU = -1;
+  mRxChunkDropped = 0;
+  mDeliveryDropped = 0;
 }
 
 Transceiver::~Transceiver()
 {
   delete gsmPulse;
-  sigProcLibDestroy();
+  for (int i = 0; i < 8; i++)
+    delete rxBurstBits[i];
+  if (mChan == 0) sigProcLibDestroy();
+  delete mLatencyControl;
   mTransmitPriorityQueue.clear();
 }
   
@@ -107,15 +144,16 @@ void Transceiver::addRadioVector(BitVector &burst,
 				 int RSSI,
 				 GSM::Time &wTime)
 {
-  // modulate and stick into queue 
-  signalVector* modBurst = modulateBurst(burst,*gsmPulse,
-					 8 + (wTime.TN() % 4 == 0),
-					 mSamplesPerSymbol);
-  scaleVector(*modBurst,txFullScale * pow(10,-RSSI/10));
-  radioVector *newVec = new radioVector(*modBurst,wTime);
+  // modulate directly into a pooled burst and stick into queue 
+  int guardPeriodLength = 8 + (wTime.TN() % 4 == 0);
+  radioVector *newVec = new radioVector(mSamplesPerSymbol*(burst.size()+guardPeriodLength),
+					wTime);
+  modulateBurst(burst,*gsmPulse,
+		guardPeriodLength,
+		mSamplesPerSymbol,
+		newVec);
+  scaleVector(*newVec,txFullScale * pow(10,-RSSI/10));
   mTransmitPriorityQueue.write(newVec);
-
-  delete modBurst;
 }
 
 #ifdef TRANSMIT_LOGGING
@@ -162,10 +200,10 @@ void Transceiver::pushRadioVector(GSM::Time &nowTime)
   // if queue contains data at the desired timestamp, stick it into FIFO
   if (radioVector *next = (radioVector*) mTransmitPriorityQueue.getCurrentBurst(nowTime)) {
     LOG(DEBUG) << "transmitFIFO: wrote burst " << next << " at time: " << nowTime;
+    // the burst becomes the filler for this slot, no copy needed
     delete fillerTable[modFN][TN];
-    fillerTable[modFN][TN] = new signalVector(*(next));
-    mRadioInterface->driveTransmitRadio(*(next),(mChanType[TN]==NONE)); //fillerTable[modFN][TN]));
-    delete next;
+    fillerTable[modFN][TN] = next;
+    mRadioInterface->driveTransmitRadio(*(next),(mChanType[TN]==NONE),nowTime,mChan); //fillerTable[modFN][TN]));
 #ifdef TRANSMIT_LOGGING
     if (nowTime.TN()==TRANSMIT_LOGGING) { 
       unModulateVector(*(fillerTable[modFN][TN]));
@@ -175,7 +213,7 @@ void Transceiver::pushRadioVector(GSM::Time &nowTime)
   }
 
   // otherwise, pull filler data, and push to radio FIFO
-  mRadioInterface->driveTransmitRadio(*(fillerTable[modFN][TN]),(mChanType[TN]==NONE));
+  mRadioInterface->driveTransmitRadio(*(fillerTable[modFN][TN]),(mChanType[TN]==NONE),nowTime,mChan);
 #ifdef TRANSMIT_LOGGING
   if (nowTime.TN()==TRANSMIT_LOGGING) 
     unModulateVector(*fillerTable[modFN][TN]);
@@ -207,6 +245,52 @@ void Transceiver::setModulus(int timeslot)
   }
 }
 
+void Transceiver::setRxActive(int timeslot)
+{
+  // the uplink patterns of all combinations repeat within 102 frames
+  for (int fn = 0; fn < 102; fn++) {
+    CorrType corrType = expectedCorrType(GSM::Time(fn,timeslot));
+    if ((corrType == OFF) || (corrType == IDLE))
+      mRxActive[fn] &= ~(1 << timeslot);
+    else
+      mRxActive[fn] |= (1 << timeslot);
+  }
+}
+
+bool Transceiver::wantBurst(const GSM::Time &wTime)
+{
+  if (mRxActive[wTime.FN() % 102] & (1 << wTime.TN()))
+    return true;
+
+  // a few idle bursts are still built, for the noise floor
+  return (wTime.FN() % NOISE_SAMPLE_FRAMES == 0);
+}
+
+bool BurstFilterAdapter(const GSM::Time &wTime, void *arg)
+{
+  return ((Transceiver *) arg)->wantBurst(wTime);
+}
+
+void Transceiver::updateNoiseFloor(radioVector *rxBurst)
+{
+  float avgPwr;
+#ifdef FIXED_POINT
+  energyDetect(rxBurst->fixed(),rxBurst->size(),20*mSamplesPerSymbol,0.0,&avgPwr);
+#else
+  energyDetect(*rxBurst,20*mSamplesPerSymbol,0.0,&avgPwr);
+#endif
+
+  // follow the floor down quickly, but rise only slowly with interference
+  mThresholdLock.lock();
+  if (mNoiseFloor == 0.0)
+    mNoiseFloor = avgPwr;
+  else if (avgPwr < mNoiseFloor)
+    mNoiseFloor += (avgPwr - mNoiseFloor)/8.0;
+  else
+    mNoiseFloor += (avgPwr - mNoiseFloor)/32.0;
+  mThresholdLock.unlock();
+}
+
 
 Transceiver::CorrType Transceiver::expectedCorrType(GSM::Time currTime)
 {
@@ -271,35 +355,172 @@ Transceiver::CorrType Transceiver::expectedCorrType(GSM::Time currTime)
   }
 
 }
+
+enum burstPriority Transceiver::classifyBurst(const GSM::Time &wTime)
+{
+  switch (expectedCorrType(wTime)) {
+  case OFF:
+  case IDLE:
+    return IDLE_BURST;
+  case RACH:
+    return CONTROL_BURST;
+  default:
+    break;
+  }
+
+  switch (mChanType[wTime.TN()]) {
+  case I:
+  case II:
+    // SACCH/T is frame 12 of the 26-multiframe
+    return (wTime.FN() % 26 == 12) ? CONTROL_BURST : TRAFFIC_BURST;
+  case III:
+    // SACCH/T of the two subchannels, frames 12 and 25
+    return (wTime.FN() % 13 == 12) ? CONTROL_BURST : TRAFFIC_BURST;
+  default:
+    return CONTROL_BURST;
+  }
+}
+
+enum burstPriority BurstPriorityAdapter(const GSM::Time &wTime, void *arg)
+{
+  return ((Transceiver *) arg)->classifyBurst(wTime);
+}
+
+void Transceiver::receiveFIFO(VectorFIFO *wFIFO)
+{
+  mReceiveFIFO = wFIFO;
+  mReceiveFIFO->setClassifier(BurstPriorityAdapter,this);
+  mReceiveFIFO->setFilter(BurstFilterAdapter,this);
+}
+
+void Transceiver::logReceiveStats()
+{
+  VectorFIFOStats stats = mReceiveFIFO->stats(true);
+
+  LOG(INFO) << "receive FIFO depth " << stats.depth
+            << ", max depth " << stats.maxDepth
+            << ", mean age " << (stats.dequeued ? stats.totalAge/stats.dequeued : 0)
+            << ", max age " << stats.maxAge << " slots";
+
+  unsigned long dropped = stats.stale;
+  for (int i = 0; i < NUM_BURST_PRIORITIES; i++)
+    dropped += stats.shed[i];
+
+  // losing control bursts is worth a look at the samples
+  if (stats.shed[CONTROL_BURST] != mRxControlShed) {
+    mRxControlShed = stats.shed[CONTROL_BURST];
+    dumpSamples("shed",0);
+  }
+
+  if (dropped != mRxDropped) {
+    LOG(NOTICE) << "receive FIFO has shed " << stats.shed[IDLE_BURST] << " idle, "
+                << stats.shed[TRAFFIC_BURST] << " traffic and "
+                << stats.shed[CONTROL_BURST] << " control bursts, and dropped "
+                << stats.stale << " stale bursts";
+    mRxDropped = dropped;
+  }
+
+  if (mBurstLink.dropped() != mLinkDropped) {
+    mLinkDropped = mBurstLink.dropped();
+    LOG(NOTICE) << "burst link to GSM core was full for " << mLinkDropped << " bursts";
+  }
+
+  // the device stage is shared by all channels, channel zero reports it
+  if ((mChan == 0) && mRadioInterface->pipelined())
+    logStageStats("conversion",mRadioInterface->rxChunkStats(true),&mRxChunkDropped);
+  if (mDeliveryThread)
+    logStageStats("delivery",mDeliveryQueue.stats(true),&mDeliveryDropped);
+}
+
+bool Transceiver::dumpSamples(const char *reason, int seconds)
+{
+  GSM::Time now = mRadioInterface->getClock()->get();
+
+  // automatic dumps at most once a minute
+  if (strcmp(reason,"request") && (now < mLastDumpTime + GSM::Time(216*60,0)))
+    return false;
+
+  char prefix[64];
+  sprintf(prefix,"iqdump-%d-%s-%d",mDataSocket.port(),reason,now.FN());
+  if (!mRadioInterface->dumpCapture(prefix,seconds)) return false;
+
+  LOG(NOTICE) << "dumping captured samples to " << prefix;
+  mLastDumpTime = now;
+  return true;
+}
+
+void Transceiver::logTransmitStats()
+{
+  VectorQueueStats stats = mTransmitPriorityQueue.stats();
+
+  if ((stats.late != mTxStats.late) || (stats.dropped != mTxStats.dropped)) {
+    LOG(NOTICE) << "transmit queue has had " << stats.late << " late, "
+                << stats.dropped << " dropped and " << stats.stale << " stale bursts";
+  }
+  mTxStats = stats;
+}
     
+radioVector *Transceiver::nextRadioVector(CorrType &corrType)
+{
+  radioVector *rxBurst;
+
+  while ((rxBurst = (radioVector *) mReceiveFIFO->get())) {
+    LOG(DEBUG) << "receiveFIFO: read radio vector at time: " << rxBurst->getTime() << ", new size: " << mReceiveFIFO->size();
+
+    corrType = expectedCorrType(rxBurst->getTime());
+    if ((corrType!=OFF) && (corrType!=IDLE)) break;
+
+    updateNoiseFloor(rxBurst);
+    delete rxBurst;
+  }
+
+  return rxBurst;
+}
+
 SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
 				      int &RSSI,
 				      int &timingOffset)
 {
-  bool needDFE = (mMaxExpectedDelay > 1);
-
-  radioVector *rxBurst = (radioVector *) mReceiveFIFO->get();
+  CorrType corrType;
+  radioVector *rxBurst = nextRadioVector(corrType);
 
   if (!rxBurst) return NULL;
 
-  LOG(DEBUG) << "receiveFIFO: read radio vector at time: " << rxBurst->getTime() << ", new size: " << mReceiveFIFO->size();
+  return demodRadioVector(rxBurst,corrType,wTime,RSSI,timingOffset);
+}
+
+SoftVector *Transceiver::demodRadioVector(radioVector *rxBurst,
+					  CorrType corrType,
+					  GSM::Time &wTime,
+					  int &RSSI,
+					  int &timingOffset)
+{
+  bool needDFE = (mMaxExpectedDelay > 1);
 
   int timeslot = rxBurst->getTime().TN();
 
-  CorrType corrType = expectedCorrType(rxBurst->getTime());
+  // the threshold adapts to the bursts of all timeslots, which may be
+  // demodulated by different threads
+  mThresholdLock.lock();
+  double energyThreshold = mEnergyThreshold;
+  mThresholdLock.unlock();
 
-  if ((corrType==OFF) || (corrType==IDLE)) {
-    delete rxBurst;
-    return NULL;
-  }
- 
   // check to see if received burst has sufficient 
   signalVector *vectorBurst = rxBurst;
   complex amplitude = 0.0;
   float TOA = 0.0;
   float avgPwr = 0.0;
-  if (!energyDetect(*vectorBurst,20*mSamplesPerSymbol,mEnergyThreshold,&avgPwr)) {
+#ifdef FIXED_POINT
+  // detection runs on the device samples, the floating point burst is
+  // only filled in for the equalizers
+  const short *fixedBurst = rxBurst->fixed();
+  unsigned burstLength = rxBurst->size();
+  if (!energyDetect(fixedBurst,burstLength,20*mSamplesPerSymbol,energyThreshold,&avgPwr)) {
+#else
+  if (!energyDetect(*vectorBurst,20*mSamplesPerSymbol,energyThreshold,&avgPwr)) {
+#endif
      LOG(DEBUG) << "Estimated Energy: " << sqrt(avgPwr) << ", at time " << rxBurst->getTime();
+     mThresholdLock.lock();
      double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime;
      if (framesElapsed > 50) {  // if we haven't had any false detections for a while, lower threshold
 	mEnergyThreshold -= 10.0/10.0;
@@ -308,6 +529,7 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
 
         prevFalseDetectionTime = rxBurst->getTime();
      }
+     mThresholdLock.unlock();
      delete rxBurst;
      return NULL;
   }
@@ -315,93 +537,135 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
 
   // run the proper correlator
   bool success = false;
+  int mlseMemory = mEqualizer[mChanType[timeslot]];
+  signalVector *channelResp = NULL;
+  float chanOffset = 0.0;
   if (corrType==TSC) {
     LOG(DEBUG) << "looking for TSC at time: " << rxBurst->getTime();
-    signalVector *channelResp;
-    double framesElapsed = rxBurst->getTime()-channelEstimateTime[timeslot];
-    bool estimateChannel = false;
-    if ((framesElapsed > 50) || (channelResponse[timeslot]==NULL)) {
-	if (channelResponse[timeslot]) delete channelResponse[timeslot];
-        if (DFEForward[timeslot]) delete DFEForward[timeslot];
-        if (DFEFeedback[timeslot]) delete DFEFeedback[timeslot];
-        channelResponse[timeslot] = NULL;
-        DFEForward[timeslot] = NULL;
-        DFEFeedback[timeslot] = NULL;
-	estimateChannel = true;
-    }
-    if (!needDFE) estimateChannel = false;
-    float chanOffset;
+    // the channel is estimated on every burst, but the equalizer
+    // is only redesigned when the estimate has moved
+#ifdef FIXED_POINT
+    success = analyzeTrafficBurst(fixedBurst,
+				  burstLength,
+				  mTSC,
+#else
     success = analyzeTrafficBurst(*vectorBurst,
 				  mTSC,
+#endif
 				  3.0,
 				  mSamplesPerSymbol,
 				  &amplitude,
 				  &TOA,
 				  mMaxExpectedDelay, 
-				  estimateChannel,
+				  needDFE || mlseMemory,
 				  &channelResp,
 				  &chanOffset);
     if (success) {
       LOG(DEBUG) << "FOUND TSC!!!!!! " << amplitude << " " << TOA;
+      mThresholdLock.lock();
       mEnergyThreshold -= 1.0F/10.0F;
       if (mEnergyThreshold < 0.0) mEnergyThreshold = 0.0;
       SNRestimate[timeslot] = amplitude.norm2()/(mEnergyThreshold*mEnergyThreshold+1.0); // this is not highly accurate
-      if (estimateChannel) {
-         LOG(DEBUG) << "estimating channel...";
-         channelResponse[timeslot] = channelResp;
-       	 chanRespOffset[timeslot] = chanOffset;
-         chanRespAmplitude[timeslot] = amplitude;
-	 scaleVector(*channelResp, complex(1.0,0.0)/amplitude);
-         designDFE(*channelResp, SNRestimate[timeslot], 7, &DFEForward[timeslot], &DFEFeedback[timeslot]);
-         channelEstimateTime[timeslot] = rxBurst->getTime();  
-         LOG(DEBUG) << "SNR: " << SNRestimate[timeslot] << ", DFE forward: " << *DFEForward[timeslot] << ", DFE backward: " << *DFEFeedback[timeslot];
+      mThresholdLock.unlock();
+      if (channelResp) {
+        scaleVector(*channelResp, complex(1.0,0.0)/amplitude);
+        if (!mlseMemory && mDFE[timeslot].update(*channelResp, SNRestimate[timeslot], chanOffset))
+          LOG(DEBUG) << "SNR: " << SNRestimate[timeslot] << ", DFE forward: " << mDFE[timeslot].forward() << ", DFE backward: " << mDFE[timeslot].feedback();
       }
     }
     else {
+      mThresholdLock.lock();
       double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime; 
       LOG(DEBUG) << "wTime: " << rxBurst->getTime() << ", pTime: " << prevFalseDetectionTime << ", fElapsed: " << framesElapsed;
       mEnergyThreshold += 10.0F/10.0F*exp(-framesElapsed);
       prevFalseDetectionTime = rxBurst->getTime();
-      channelResponse[timeslot] = NULL;
+      mThresholdLock.unlock();
     }
   }
   else {
     // RACH burst
+#ifdef FIXED_POINT
+    success = detectRACHBurst(fixedBurst,
+			      burstLength,
+#else
     success = detectRACHBurst(*vectorBurst,
+#endif
 			      5.0,  // detection threshold
 			      mSamplesPerSymbol,
 			      &amplitude,
 			      &TOA);
     if (success) {
       LOG(DEBUG) << "FOUND RACH!!!!!! " << amplitude << " " << TOA;
+      mThresholdLock.lock();
       mEnergyThreshold -= (1.0F/10.0F);
       if (mEnergyThreshold < 0.0) mEnergyThreshold = 0.0;
-      channelResponse[timeslot] = NULL; 
+      mThresholdLock.unlock();
+      mDFE[timeslot].reset();
     }
     else {
+      mThresholdLock.lock();
       double framesElapsed = rxBurst->getTime()-prevFalseDetectionTime;
       mEnergyThreshold += (1.0F/10.0F)*exp(-framesElapsed);
       prevFalseDetectionTime = rxBurst->getTime();
+      mThresholdLock.unlock();
     }
   }
-  LOG(DEBUG) << "energy Threshold = " << mEnergyThreshold; 
+  LOG(DEBUG) << "energy Threshold = " << energyThreshold; 
 
   // demodulate burst
   SoftVector *burst = NULL;
   if ((rxBurst) && (success)) {
-    if ((corrType==RACH) || (!needDFE)) {
+    // bits go into the timeslot's vector, which is only reallocated
+    // when the burst length changes
+    bool useMLSE = (corrType!=RACH) && mlseMemory && channelResp;
+    bool useDFE = !useMLSE && (corrType!=RACH) && needDFE && mDFE[timeslot].valid();
+    unsigned numBits = vectorBurst->size();
+    if (!useDFE && !useMLSE) numBits /= mSamplesPerSymbol;
+    if (rxBurstBits[timeslot] && (rxBurstBits[timeslot]->size()!=numBits)) {
+      delete rxBurstBits[timeslot];
+      rxBurstBits[timeslot] = NULL;
+    }
+    if (!rxBurstBits[timeslot])
+      rxBurstBits[timeslot] = new SoftVector(numBits);
+
+#ifdef FIXED_POINT
+    if (useMLSE || useDFE) rxBurst->unpack();
+#endif
+
+    if (useMLSE) {
+      scaleVector(*vectorBurst,complex(1.0,0.0)/amplitude);
+      burst = mlseEqualizeBurst(*vectorBurst,
+				TOA,
+				mSamplesPerSymbol,
+				*channelResp,
+				chanOffset,
+				SNRestimate[timeslot],
+				mlseMemory,
+				rxBurstBits[timeslot]);
+    }
+    else if (!useDFE) {
+#ifdef FIXED_POINT
+      burst = demodulateBurst(fixedBurst,
+			      burstLength,
+			      mSamplesPerSymbol,
+			      amplitude,TOA,
+			      rxBurstBits[timeslot]);
+#else
       burst = demodulateBurst(*vectorBurst,
 			      *gsmPulse,
 			      mSamplesPerSymbol,
-			      amplitude,TOA);
+			      amplitude,TOA,
+			      rxBurstBits[timeslot]);
+#endif
     }
     else { // TSC
       scaleVector(*vectorBurst,complex(1.0,0.0)/amplitude);
       burst = equalizeBurst(*vectorBurst,
-			    TOA-chanRespOffset[timeslot],
+			    TOA-mDFE[timeslot].offset(),
 			    mSamplesPerSymbol,
-			    *DFEForward[timeslot],
-			    *DFEFeedback[timeslot]);
+			    mDFE[timeslot].forward(),
+			    mDFE[timeslot].feedback(),
+			    rxBurstBits[timeslot]);
     }
     wTime = rxBurst->getTime();
     RSSI = (int) floor(20.0*log10(rxFullScale/amplitude.abs()));
@@ -411,6 +675,7 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime,
 
   //if (burst) LOG(DEEPDEBUG) << "burst: " << *burst << '\n';
 
+  delete channelResp;
   delete rxBurst;
 
   return burst;
@@ -447,7 +712,7 @@ void Transceiver::driveControl()
 
   char cmdcheck[4];
   char command[MAX_PACKET_LENGTH];
-  char response[MAX_PACKET_LENGTH];
+  char response[MAX_UDP_LENGTH];   // room for the slack histogram
 
   sscanf(buffer,"%3s %s",cmdcheck,command);
  
@@ -472,11 +737,22 @@ void Transceiver::driveControl()
       if (!mOn) {
         // Prepare for thread start
         mPower = -20;
-        mRadioInterface->start();
+        // join the running clock if another channel started the radio
+        mTransmitDeadlineClock = mRadioInterface->getClock()->get();
+        mLastClockUpdateTime = mTransmitDeadlineClock;
+        mLatencyUpdateTime = mTransmitDeadlineClock;
+        mTransmitPriorityQueue.reset(mTransmitDeadlineClock);
+        mRadioInterface->start(mChan);
+        pthread_rwlock_wrlock(&sigProcLock);
         generateRACHSequence(*gsmPulse,mSamplesPerSymbol);
+        pthread_rwlock_unlock(&sigProcLock);
 
         // Start radio interface threads.
         mFIFOServiceLoopThread->start((void * (*)(void*))FIFOServiceLoopAdapter,(void*) this);
+        for (int i = 0; i < mNumDemodWorkers; i++)
+          mDemodThreads[i]->start((void * (*)(void*))DemodServiceLoopAdapter,(void*) this);
+        if (mDeliveryThread)
+          mDeliveryThread->start((void * (*)(void*))DeliveryServiceLoopAdapter,(void*) this);
         mTransmitPriorityQueueServiceLoopThread->start((void * (*)(void*))TransmitPriorityQueueServiceLoopAdapter,(void*) this);
         writeClockInterface();
 
@@ -484,6 +760,26 @@ void Transceiver::driveControl()
       }
     }
   }
+  else if (strcmp(command,"SHMOPEN")==0) {
+    // move the burst traffic to a shared memory link named after the data port
+    char name[32];
+    sprintf(name,"/openbts-trx-%d",mDataSocket.port());
+    if (mOn || !mBurstLink.create(name))
+      sprintf(response,"RSP SHMOPEN 1");
+    else {
+      LOG(NOTICE) << "burst link to GSM core is " << name;
+      sprintf(response,"RSP SHMOPEN 0");
+    }
+  }
+  else if (strcmp(command,"IQDUMP")==0) {
+    // write the recently captured samples to disk
+    int seconds = 0;  // the whole ring unless given
+    sscanf(buffer,"%3s %s %d",cmdcheck,command,&seconds);
+    if (dumpSamples("request",seconds))
+      sprintf(response,"RSP IQDUMP 0 %d",seconds);
+    else
+      sprintf(response,"RSP IQDUMP 1 %d",seconds);
+  }
   else if (strcmp(command,"SETMAXDLY")==0) {
     //set expected maximum time-of-arrival
     int maxDelay;
@@ -491,6 +787,55 @@ void Transceiver::driveControl()
     mMaxExpectedDelay = maxDelay; // 1 GSM symbol is approx. 1 km
     sprintf(response,"RSP SETMAXDLY 0 %d",maxDelay);
   }
+  else if (strcmp(command,"TXLATENCY")==0) {
+    // report the transmit latency, optionally setting the percentile target
+    int percentile;
+    if (sscanf(buffer,"%3s %s %d",cmdcheck,command,&percentile) == 3)
+      mLatencyControl->setPercentile(percentile);
+    TxLatencyStats stats = mLatencyControl->stats();
+    sprintf(response,"RSP TXLATENCY 0 %d %d %d %lu %lu %lu",
+            stats.latency,stats.percentile,stats.guard,
+            stats.underruns,stats.raised,stats.lowered);
+  }
+  else if (strcmp(command,"TXSLACK")==0) {
+    // report transmit loop wakeups by timeslots of slack, from none up
+    TxLatencyStats stats = mLatencyControl->stats();
+    int len = sprintf(response,"RSP TXSLACK 0");
+    for (int i = 0; i < TXSLACK_BINS; i++)
+      len += sprintf(response+len," %lu",stats.slack[i]);
+  }
+  else if (strcmp(command,"SETDFE")==0) {
+    // set how far the channel (in percent) and SNR (in dB) may move
+    // before the equalizer is redesigned
+    int channelPct, SNRdB;
+    if ((sscanf(buffer,"%3s %s %d %d",cmdcheck,command,&channelPct,&SNRdB) != 4) ||
+        (channelPct < 0) || (SNRdB < 0))
+      sprintf(response,"RSP SETDFE 1");
+    else {
+      // the demodulators read the equalizer state under the read lock
+      pthread_rwlock_wrlock(&sigProcLock);
+      for (int i = 0; i < 8; i++)
+        mDFE[i].distances(channelPct/100.0,SNRdB);
+      pthread_rwlock_unlock(&sigProcLock);
+      sprintf(response,"RSP SETDFE 0 %d %d",channelPct,SNRdB);
+    }
+  }
+  else if (strcmp(command,"SETEQ")==0) {
+    // select the equalizer of a channel combination,
+    // 0 for the DFE, otherwise the MLSE channel memory
+    int combination, memory;
+    if ((sscanf(buffer,"%3s %s %d %d",cmdcheck,command,&combination,&memory) != 4) ||
+        (combination < 0) || (combination > LOOPBACK) ||
+        ((memory != 0) && ((memory < MLSE_MIN_MEMORY) || (memory > MLSE_MAX_MEMORY))) ||
+        ((memory != 0) && (mSamplesPerSymbol != 1)))
+      sprintf(response,"RSP SETEQ 1");
+    else {
+      pthread_rwlock_wrlock(&sigProcLock);
+      mEqualizer[combination] = memory;
+      pthread_rwlock_unlock(&sigProcLock);
+      sprintf(response,"RSP SETEQ 0 %d %d",combination,memory);
+    }
+  }
   else if (strcmp(command,"SETRXGAIN")==0) {
     //set expected maximum time-of-arrival
     int newGain;
@@ -500,13 +845,28 @@ void Transceiver::driveControl()
   }
   else if (strcmp(command,"NOISELEV")==0) {
     if (mOn) {
+      mThresholdLock.lock();
       sprintf(response,"RSP NOISELEV 0 %d",
               (int) round(20.0*log10(rxFullScale/mEnergyThreshold)));
+      mThresholdLock.unlock();
     }
     else {
       sprintf(response,"RSP NOISELEV 1  0");
     }
   }   
+  else if (strcmp(command,"NOISEFLOOR")==0) {
+    // noise floor of the idle timeslots, in dB below full scale
+    mThresholdLock.lock();
+    double noiseFloor = mNoiseFloor;
+    mThresholdLock.unlock();
+    if (mOn && (noiseFloor > 0.0)) {
+      sprintf(response,"RSP NOISEFLOOR 0 %d",
+              (int) round(10.0*log10(rxFullScale*rxFullScale/noiseFloor)));
+    }
+    else {
+      sprintf(response,"RSP NOISEFLOOR 1 0");
+    }
+  }
   else if (strcmp(command,"SETPOWER")==0) {
     // set output power in dB
     int dbPwr;
@@ -515,7 +875,7 @@ void Transceiver::driveControl()
       sprintf(response,"RSP SETPOWER 1 %d",dbPwr);
     else {
       mPower = dbPwr;
-      mRadioInterface->setPowerAttenuation(dbPwr);
+      mRadioInterface->setPowerAttenuation(dbPwr,mChan);
       sprintf(response,"RSP SETPOWER 0 %d",dbPwr);
     }
   }
@@ -536,7 +896,7 @@ void Transceiver::driveControl()
     int freqKhz;
     sscanf(buffer,"%3s %s %d",cmdcheck,command,&freqKhz);
     mRxFreq = freqKhz*1.0e3+FREQOFFSET;
-    if (!mRadioInterface->tuneRx(mRxFreq)) {
+    if (!mRadioInterface->tuneRx(mRxFreq,mChan)) {
        LOG(ALARM) << "RX failed to tune";
        sprintf(response,"RSP RXTUNE 1 %d",freqKhz);
     }
@@ -549,7 +909,7 @@ void Transceiver::driveControl()
     sscanf(buffer,"%3s %s %d",cmdcheck,command,&freqKhz);
     //freqKhz = 890e3;
     mTxFreq = freqKhz*1.0e3+FREQOFFSET;
-    if (!mRadioInterface->tuneTx(mTxFreq)) {
+    if (!mRadioInterface->tuneTx(mTxFreq,mChan)) {
        LOG(ALARM) << "TX failed to tune";
        sprintf(response,"RSP TXTUNE 1 %d",freqKhz);
     }
@@ -564,7 +924,9 @@ void Transceiver::driveControl()
       sprintf(response,"RSP SETTSC 1 %d",TSC);
     else {
       mTSC = TSC;
+      pthread_rwlock_wrlock(&sigProcLock);
       generateMidamble(*gsmPulse,mSamplesPerSymbol,TSC);
+      pthread_rwlock_unlock(&sigProcLock);
       sprintf(response,"RSP SETTSC 0 %d",TSC);
     }
   }
@@ -580,6 +942,7 @@ void Transceiver::driveControl()
     }     
     mChanType[timeslot] = (ChannelCombination) corrCode;
     setModulus(timeslot);
+    setRxActive(timeslot);
     sprintf(response,"RSP SETSLOT 0 %d %d",timeslot,corrCode);
 
   }
@@ -594,10 +957,18 @@ void Transceiver::driveControl()
 bool Transceiver::driveTransmitPriorityQueue() 
 {
 
-  char buffer[gSlotLen+50];
+  char buffer[MAX_UDP_LENGTH];
+  size_t msgLen;
 
-  // check data socket
-  size_t msgLen = mDataSocket.read(buffer);
+  if (mBurstLink.active()) {
+    // wait in short steps so the thread can still be cancelled
+    while (!(msgLen = mBurstLink.read(SharedMemoryLink::DOWNLINK,buffer,100)))
+      pthread_testcancel();
+  }
+  else {
+    // check data socket
+    msgLen = mDataSocket.read(buffer);
+  }
 
   if (msgLen!=gSlotLen+1+4+1) {
     LOG(ERROR) << "badly formatted packet on GSM->TRX interface";
@@ -635,15 +1006,14 @@ bool Transceiver::driveTransmitPriorityQueue()
   LOG(DEEPDEBUG) << "rcvd. burst at: " << GSM::Time(frameNum,timeSlot);
   
   int RSSI = (int) buffer[5];
-  static BitVector newBurst(gSlotLen);
-  BitVector::iterator itr = newBurst.begin();
+  BitVector::iterator itr = mTxBurstBits.begin();
   char *bufferItr = buffer+6;
-  while (itr < newBurst.end()) 
+  while (itr < mTxBurstBits.end()) 
     *itr++ = *bufferItr++;
   
   GSM::Time currTime = GSM::Time(frameNum,timeSlot);
   
-  addRadioVector(newBurst,RSSI,currTime);
+  addRadioVector(mTxBurstBits,RSSI,currTime);
   
   LOG(DEEPDEBUG) "added burst - time: " << currTime << ", RSSI: " << RSSI; // << ", data: " << newBurst; 
 
@@ -652,6 +1022,53 @@ bool Transceiver::driveTransmitPriorityQueue()
 
 }
  
+void Transceiver::formatBurst(char *burstString,
+			      const SoftVector *rxBurst,
+			      const GSM::Time &burstTime,
+			      int RSSI,
+			      int TOA)
+{
+  LOG(DEBUG) << "burst parameters: "
+	<< " time: " << burstTime
+	<< " RSSI: " << RSSI
+	<< " TOA: "  << TOA
+	<< " bits: " << *rxBurst;
+
+  burstString[0] = burstTime.TN();
+  for (int i = 0; i < 4; i++)
+    burstString[1+i] = (burstTime.FN() >> ((3-i)*8)) & 0x0ff;
+  burstString[5] = RSSI;
+  burstString[6] = (TOA >> 8) & 0x0ff;
+  burstString[7] = TOA & 0x0ff;
+  SoftVector::const_iterator burstItr = rxBurst->begin();
+
+  for (unsigned int i = 0; i < gSlotLen; i++) {
+    burstString[8+i] =(char) round((*burstItr++)*255.0);
+  }
+  burstString[gSlotLen+9] = '\0';
+}
+
+void Transceiver::writeBurst(const char *burstString)
+{
+  // a full queue loses the burst, as a full burst link does
+  if (mDeliveryThread) {
+    BurstMessage msg;
+    memcpy(msg.data,burstString,gSlotLen+10);
+    mDeliveryQueue.put(msg);
+    return;
+  }
+
+  sendBurst(burstString);
+}
+
+void Transceiver::sendBurst(const char *burstString)
+{
+  if (mBurstLink.active())
+    mBurstLink.write(SharedMemoryLink::UPLINK,burstString,gSlotLen+10);
+  else
+    mDataSocket.write(burstString,gSlotLen+10);
+}
+
 void Transceiver::driveReceiveFIFO() 
 {
 
@@ -660,36 +1077,136 @@ void Transceiver::driveReceiveFIFO()
   int TOA;  // in 1/256 of a symbol
   GSM::Time burstTime;
 
-  mRadioInterface->driveReceiveRadio();
+  mRadioInterface->driveReceiveRadio(mChan);
+
+  // report queue counters about once a second
+  GSM::Time radioTime = mRadioInterface->getClock()->get();
+  if (radioTime > mRxStatsTime + GSM::Time(216,0)) {
+    logReceiveStats();
+    logTransmitStats();
+    mRxStatsTime = radioTime;
+  }
+
+  if (mNumDemodWorkers) {
+    dispatchRadioVectors();
+    return;
+  }
 
+  pthread_rwlock_rdlock(&sigProcLock);
   rxBurst = pullRadioVector(burstTime,RSSI,TOA);
+  pthread_rwlock_unlock(&sigProcLock);
 
   if (rxBurst) { 
-
-    LOG(DEBUG) << "burst parameters: "
-	  << " time: " << burstTime
-	  << " RSSI: " << RSSI
-	  << " TOA: "  << TOA
-	  << " bits: " << *rxBurst;
-    
     char burstString[gSlotLen+10];
-    burstString[0] = burstTime.TN();
-    for (int i = 0; i < 4; i++)
-      burstString[1+i] = (burstTime.FN() >> ((3-i)*8)) & 0x0ff;
-    burstString[5] = RSSI;
-    burstString[6] = (TOA >> 8) & 0x0ff;
-    burstString[7] = TOA & 0x0ff;
-    SoftVector::iterator burstItr = rxBurst->begin();
-
-    for (unsigned int i = 0; i < gSlotLen; i++) {
-      burstString[8+i] =(char) round((*burstItr++)*255.0);
-    }
-    burstString[gSlotLen+9] = '\0';
-    delete rxBurst;
+    formatBurst(burstString,rxBurst,burstTime,RSSI,TOA);
+    writeBurst(burstString);
+  }
 
-    mDataSocket.write(burstString,gSlotLen+10);
+}
+
+void Transceiver::demodWorkers(int num)
+{
+  if (num < 0) num = 0;
+  if (num > DEMOD_WORKERS_MAX) num = DEMOD_WORKERS_MAX;
+
+  for (int i = mNumDemodWorkers; i < num; i++)
+    mDemodThreads[i] = new Thread(65536);
+  mNumDemodWorkers = num;
+}
+
+void Transceiver::pipeline(int demodCPU, int deliveryCPU)
+{
+  if (!mDeliveryThread) mDeliveryThread = new Thread(32768);
+  mDemodCPU = demodCPU;
+  mDeliveryCPU = deliveryCPU;
+}
+
+void Transceiver::driveDelivery()
+{
+  BurstMessage msg;
+
+  if (mDeliveryQueue.get(msg,100))
+    sendBurst(msg.data);
+}
+
+void Transceiver::dispatchRadioVectors()
+{
+  // Stop taking bursts when the pool is full, so that they back up in
+  // the receive FIFO, which sheds them by priority.
+  mDemodLock.lock();
+  while (mDemodCount < DEMOD_QUEUE_LEN) {
+    CorrType corrType;
+    radioVector *rxBurst = nextRadioVector(corrType);
+    if (!rxBurst) break;
+
+    DemodJob &job = mDemodJobs[(mDemodHead+mDemodCount) % DEMOD_QUEUE_LEN];
+    job.burst = rxBurst;
+    job.corrType = corrType;
+    job.done = false;
+    job.found = false;
+    mDemodCount++;
+
+    mDemodSignal[rxBurst->getTime().TN() % mNumDemodWorkers].signal();
   }
+  mDemodLock.unlock();
+}
+
+void Transceiver::driveDemodulation(int worker)
+{
+  // Each worker takes the bursts of its own timeslots in order, so the
+  // equalizer and bits of a timeslot only ever have one writer.
+  mDemodLock.lock();
+  DemodJob *job = NULL;
+  while (!job) {
+    for (unsigned i = 0; i < mDemodCount; i++) {
+      DemodJob &next = mDemodJobs[(mDemodHead+i) % DEMOD_QUEUE_LEN];
+      if (next.burst &&
+          ((int) next.burst->getTime().TN() % mNumDemodWorkers == worker)) {
+        job = &next;
+        break;
+      }
+    }
+    if (!job) mDemodSignal[worker].wait(mDemodLock);
+  }
+  radioVector *rxBurst = job->burst;
+  job->burst = NULL;
+  mDemodLock.unlock();
 
+  GSM::Time burstTime;
+  int RSSI, TOA;
+  pthread_rwlock_rdlock(&sigProcLock);
+  SoftVector *bits = demodRadioVector(rxBurst,job->corrType,burstTime,RSSI,TOA);
+  pthread_rwlock_unlock(&sigProcLock);
+  if (bits) formatBurst(job->burstString,bits,burstTime,RSSI,TOA);
+
+  mDemodLock.lock();
+  job->found = (bits!=NULL);
+  job->done = true;
+  mDemodLock.unlock();
+
+  // Bursts go up in the order they were received, so whichever worker
+  // finishes the oldest burst sends it and any finished after it.  The
+  // send lock keeps that order, so the ring is not held across a send
+  // and dispatch and the other workers never wait on the socket.
+  char burstString[gSlotLen+10];
+  mDemodSendLock.lock();
+  while (1) {
+    mDemodLock.lock();
+    if (!mDemodCount || !mDemodJobs[mDemodHead].done) {
+      mDemodLock.unlock();
+      break;
+    }
+    DemodJob &head = mDemodJobs[mDemodHead];
+    bool found = head.found;
+    if (found) memcpy(burstString,head.burstString,sizeof(burstString));
+    head.done = false;
+    mDemodHead = (mDemodHead+1) % DEMOD_QUEUE_LEN;
+    mDemodCount--;
+    mDemodLock.unlock();
+
+    if (found) writeBurst(burstString);
+  }
+  mDemodSendLock.unlock();
 }
 
 void Transceiver::driveTransmitFIFO() 
@@ -711,30 +1228,22 @@ void Transceiver::driveTransmitFIFO()
   if (mOn) {
     //radioClock->wait(); // wait until clock updates
     LOG(DEBUG) << "radio clock " << radioClock->get();
+    GSM::Time now = radioClock->get();
+    // nothing is queued yet on the first step after POWERON
+    bool started = !(mTransmitDeadlineClock == mLatencyUpdateTime);
+    if (!(now == mLatencyUpdateTime) && started) {
+      // once per clock step, record how many timeslots are still queued
+      //   ahead of the radio.  Latency is only adapted on USB devices,
+      //   whose underruns come from the host not keeping up.
+      int slack = (mTransmitDeadlineClock - now)*8
+                  + (int) mTransmitDeadlineClock.TN() - (int) now.TN();
+      int latency = mLatencyControl->update(now.FN(),slack,
+                                            mRadioInterface->isUnderrun(),
+                                            mRadioInterface->getBus() == RadioDevice::USB);
+      mTransmitLatency = GSM::Time(latency/8,latency%8);
+      mLatencyUpdateTime = now;
+    }
     while (radioClock->get() + mTransmitLatency > mTransmitDeadlineClock) {
-      // if underrun, then we're not providing bursts to radio/USRP fast
-      //   enough.  Need to increase latency by one GSM frame.
-      if (mRadioInterface->getBus() == RadioDevice::USB) {
-        if (mRadioInterface->isUnderrun()) {
-          // only do latency update every 10 frames, so we don't over update
-          if (radioClock->get() > mLatencyUpdateTime + GSM::Time(10,0)) {
-            mTransmitLatency = mTransmitLatency + GSM::Time(1,0);
-            LOG(INFO) << "new latency: " << mTransmitLatency;
-            mLatencyUpdateTime = radioClock->get();
-          }
-        }
-        else {
-          // if underrun hasn't occurred in the last sec (216 frames) drop
-          //    transmit latency by a timeslot
-          if (mTransmitLatency > GSM::Time(1,1)) {
-              if (radioClock->get() > mLatencyUpdateTime + GSM::Time(216,0)) {
-              mTransmitLatency.decTN();
-              LOG(INFO) << "reduced latency: " << mTransmitLatency;
-              mLatencyUpdateTime = radioClock->get();
-            }
-          }
-        }
-      }
       // time to push burst to transmit FIFO
       pushRadioVector(mTransmitDeadlineClock);
       mTransmitDeadlineClock.incTN();
@@ -751,6 +1260,13 @@ void Transceiver::driveTransmitFIFO()
 void Transceiver::writeClockInterface()
 {
   char command[50];
+
+  // channel zero keeps the GSM core clock for all channels
+  if (mChan > 0) {
+    mLastClockUpdateTime = mTransmitDeadlineClock;
+    return;
+  }
+
   // FIXME -- This should be adaptive.
   sprintf(command,"IND CLOCK %llu",(unsigned long long) (mTransmitDeadlineClock.FN()+2));
 
@@ -768,6 +1284,7 @@ void Transceiver::writeClockInterface()
 void *FIFOServiceLoopAdapter(Transceiver *transceiver)
 {
   transceiver->setPriority();
+  pinThread(transceiver->mDemodCPU);
 
   while (1) {
     transceiver->driveReceiveFIFO();
@@ -777,6 +1294,33 @@ void *FIFOServiceLoopAdapter(Transceiver *transceiver)
   return NULL;
 }
 
+void *DemodServiceLoopAdapter(Transceiver *transceiver)
+{
+  transceiver->setPriority();
+
+  transceiver->mDemodLock.lock();
+  int worker = transceiver->mDemodStarted++;
+  transceiver->mDemodLock.unlock();
+
+  while (1) {
+    transceiver->driveDemodulation(worker);
+    pthread_testcancel();
+  }
+  return NULL;
+}
+
+void *DeliveryServiceLoopAdapter(Transceiver *transceiver)
+{
+  transceiver->setPriority();
+  pinThread(transceiver->mDeliveryCPU);
+
+  while (1) {
+    transceiver->driveDelivery();
+    pthread_testcancel();
+  }
+  return NULL;
+}
+
 void *ControlServiceLoopAdapter(Transceiver *transceiver)
 {
   while (1) {
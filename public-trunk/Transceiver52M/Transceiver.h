@@ -33,6 +33,8 @@
 #include "Interthread.h"
 #include "GSMCommon.h"
 #include "Sockets.h"
+#include "SharedMemoryLink.h"
+#include "txLatency.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -40,6 +42,19 @@
 /** Define this to be the slot number to be logged. */
 //#define TRANSMIT_LOGGING 1
 
+/** Maximum number of demodulation worker threads */
+#define DEMOD_WORKERS_MAX 8
+
+/** Number of bursts that can be in demodulation at once */
+#define DEMOD_QUEUE_LEN 16
+
+/** Number of bursts that can wait for delivery to the GSM core */
+#define DELIVERY_QUEUE_LEN 64
+
+/** Frames between idle timeslot bursts sampled for the noise floor,
+    prime so that it meets the idle frames of every combination */
+#define NOISE_SAMPLE_FRAMES 13
+
 /** The Transceiver class, responsible for physical layer of basestation */
 class Transceiver {
   
@@ -47,23 +62,30 @@ private:
 
   GSM::Time mTransmitLatency;     ///< latency between basestation clock and transmit deadline clock
   GSM::Time mLatencyUpdateTime;   ///< last time latency was updated
+  TxLatencyController *mLatencyControl; ///< transmit latency from the measured slack
 
   UDPSocket mDataSocket;	  ///< socket for writing to/reading from GSM core
   UDPSocket mControlSocket;	  ///< socket for writing/reading control commands from GSM core
   UDPSocket mClockSocket;	  ///< socket for writing clock updates to GSM core
+  SharedMemoryLink mBurstLink;    ///< burst link to GSM core, replaces the data socket once opened
 
-  VectorQueue  mTransmitPriorityQueue;   ///< priority queue of transmit bursts received from GSM core
+  BitVector mTxBurstBits;         ///< bits of the transmit burst being modulated
+
+  VectorQueue  mTransmitPriorityQueue;   ///< calendar of transmit bursts received from GSM core
   VectorFIFO*  mTransmitFIFO;     ///< radioInterface FIFO of transmit bursts 
   VectorFIFO*  mReceiveFIFO;      ///< radioInterface FIFO of receive bursts 
 
   Thread *mFIFOServiceLoopThread;  ///< thread to push/pull bursts into transmit/receive FIFO
   Thread *mControlServiceLoopThread;       ///< thread to process control messages from GSM core
   Thread *mTransmitPriorityQueueServiceLoopThread;///< thread to process transmit bursts from GSM core
+  Thread *mDemodThreads[DEMOD_WORKERS_MAX];       ///< threads to demodulate receive bursts, if any
+  Thread *mDeliveryThread;                        ///< thread to write receive bursts to GSM core, if any
 
   GSM::Time mTransmitDeadlineClock;       ///< deadline for pushing bursts into transmit FIFO 
   GSM::Time mLastClockUpdateTime;         ///< last time clock update was sent up to core
 
   RadioInterface *mRadioInterface;	  ///< associated radioInterface object
+  int mChan;                              ///< channel of the radioInterface served by this transceiver
   double txFullScale;                     ///< full scale input to radio
   double rxFullScale;                     ///< full scale output to radio
 
@@ -75,6 +97,20 @@ private:
     IDLE	       ///< timeslot is an idle (or dummy) burst
   } CorrType;
 
+  /** A receive burst handed to the demodulation workers, in order of arrival */
+  struct DemodJob {
+    radioVector *burst;                ///< burst still to be demodulated, NULL once taken
+    CorrType corrType;                 ///< expected burst type
+    bool done;                         ///< demodulation is finished
+    bool found;                        ///< a burst was found, burstString holds it
+    char burstString[gSlotLen+10];     ///< burst message for the GSM core
+  };
+
+  /** A burst message waiting for delivery to the GSM core */
+  struct BurstMessage {
+    char data[gSlotLen+10];
+  };
+
 
   /** Codes for channel combinations */
   typedef enum {
@@ -104,10 +140,39 @@ private:
   /** Push modulated burst into transmit FIFO corresponding to a particular timestamp */
   void pushRadioVector(GSM::Time &nowTime);
 
-  /** Pull and demodulate a burst from the receive FIFO */ 
+  /** Pull and demodulate a burst from the receive FIFO, the returned
+      bits are valid until the next burst on the same timeslot */ 
   SoftVector *pullRadioVector(GSM::Time &wTime,
 			   int &RSSI,
 			   int &timingOffset);
+
+  /** Pull the next burst to demodulate from the receive FIFO, bursts of
+      timeslots that are off or idle are discarded */
+  radioVector *nextRadioVector(CorrType &corrType);
+
+  /** Demodulate a burst and delete it, returns NULL if none was found */
+  SoftVector *demodRadioVector(radioVector *rxBurst,
+			       CorrType corrType,
+			       GSM::Time &wTime,
+			       int &RSSI,
+			       int &timingOffset);
+
+  /** format a demodulated burst as a message for the GSM core */
+  void formatBurst(char *burstString,
+		   const SoftVector *rxBurst,
+		   const GSM::Time &burstTime,
+		   int RSSI,
+		   int TOA);
+
+  /** send a burst message to the GSM core, through the delivery
+      thread if there is one */
+  void writeBurst(const char *burstString);
+
+  /** write a burst message to the burst link or data socket */
+  void sendBurst(const char *burstString);
+
+  /** hand receive bursts to the demodulation workers while there is room */
+  void dispatchRadioVectors();
    
   /** Set modulus for specific timeslot */
   void setModulus(int timeslot);
@@ -115,6 +180,27 @@ private:
   /** return the expected burst type for the specified timestamp */
   CorrType expectedCorrType(GSM::Time currTime);
 
+  /** return the receive load shedding priority for the specified timestamp */
+  enum burstPriority classifyBurst(const GSM::Time &wTime);
+
+  /** Update the uplink activity map of a timeslot from its channel combination */
+  void setRxActive(int timeslot);
+
+  /** whether the burst at the specified timestamp is worth building */
+  bool wantBurst(const GSM::Time &wTime);
+
+  /** feed an idle timeslot burst to the noise floor estimate */
+  void updateNoiseFloor(radioVector *rxBurst);
+
+  /** log receive FIFO depth, age and drop counters, and those of the pipeline queues */
+  void logReceiveStats(void);
+
+  /** dump samples captured by the radio interface, automatic dumps are rate limited */
+  bool dumpSamples(const char *reason, int seconds);
+
+  /** log transmit queue late and dropped bursts, if there are new ones */
+  void logTransmitStats(void);
+
   /** send messages over the clock socket */
   void writeClockInterface(void);
 
@@ -130,32 +216,59 @@ private:
   unsigned mTSC;                       ///< the midamble sequence code
   double mEnergyThreshold;             ///< threshold to determine if received data is potentially a GSM burst
   GSM::Time prevFalseDetectionTime;    ///< last timestamp of a false energy detection
+  Mutex mThresholdLock;                ///< guards the energy threshold, shared by all timeslots
   int fillerModulus[8];                ///< modulus values of all timeslots, in frames
-  signalVector *fillerTable[102][8];   ///< table of modulated filler waveforms for all timeslots
+  unsigned char mRxActive[102];        ///< timeslots with uplink bursts, a bit each, by frame of the 102-multiframe
+  double mNoiseFloor;                  ///< running power of idle timeslots, guarded by the threshold lock
+  radioVector *fillerTable[102][8];    ///< table of modulated filler waveforms for all timeslots
   unsigned mMaxExpectedDelay;            ///< maximum expected time-of-arrival offset in GSM symbols
 
-  GSM::Time    channelEstimateTime[8]; ///< last timestamp of each timeslot's channel estimate
-  signalVector *channelResponse[8];    ///< most recent channel estimate of all timeslots
   float        SNRestimate[8];         ///< most recent SNR estimate of all timeslots
-  signalVector *DFEForward[8];         ///< most recent DFE feedforward filter of all timeslots
-  signalVector *DFEFeedback[8];        ///< most recent DFE feedback filter of all timeslots
-  float        chanRespOffset[8];      ///< most recent timing offset, e.g. TOA, of all timeslots
-  complex      chanRespAmplitude[8];   ///< most recent channel amplitude of all timeslots
+  DFEState     mDFE[8];                ///< equalizer filters of all timeslots, kept until the channel moves
+  int          mEqualizer[LOOPBACK+1]; ///< MLSE channel memory of each channel combination, 0 for the DFE
+  SoftVector   *rxBurstBits[8];        ///< demodulated bits of the most recent burst of all timeslots
+
+  GSM::Time mRxStatsTime;              ///< last time receive FIFO counters were logged
+  unsigned long mRxDropped;            ///< receive FIFO drops at the last log
+  unsigned long mLinkDropped;          ///< burst link drops at the last log
+  unsigned long mRxControlShed;        ///< control bursts shed at the last log
+  GSM::Time mLastDumpTime;             ///< last time captured samples were dumped
+  VectorQueueStats mTxStats;           ///< transmit queue counters at the last log
+
+  int mNumDemodWorkers;                ///< number of demodulation workers, 0 to demodulate on the FIFO thread
+  int mDemodStarted;                   ///< number of workers that have claimed an index
+  DemodJob mDemodJobs[DEMOD_QUEUE_LEN];///< ring of bursts in demodulation
+  unsigned mDemodHead;                 ///< oldest burst of the ring
+  unsigned mDemodCount;                ///< number of bursts in the ring
+  Mutex mDemodLock;                    ///< guards the ring
+  Mutex mDemodSendLock;                ///< lets one worker at a time send finished bursts, in order
+  Signal mDemodSignal[DEMOD_WORKERS_MAX]; ///< wakes a worker when one of its bursts arrives
+
+  int mDemodCPU;                       ///< CPU of the FIFO thread, negative if not pinned
+  int mDeliveryCPU;                    ///< CPU of the delivery thread, negative if not pinned
+  StageQueue<BurstMessage,DELIVERY_QUEUE_LEN> mDeliveryQueue; ///< bursts waiting for delivery
+  unsigned long mRxChunkDropped;       ///< device reads lost by the receive pipeline at the last log
+  unsigned long mDeliveryDropped;      ///< bursts lost by the delivery queue at the last log
 
 public:
 
   /** Transceiver constructor 
-      @param wBasePort base port number of UDP sockets
+      @param wBasePort base port number of UDP sockets, channel i uses
+             control and data ports wBasePort+1+2*i and wBasePort+2+2*i
       @param TRXAddress IP address of the TRX manager, as a string
       @param wSamplesPerSymbol number of samples per GSM symbol
       @param wTransmitLatency initial setting of transmit latency
       @param radioInterface associated radioInterface object
+      @param wChan radioInterface channel, channels above zero share the
+             clock and signal processing tables of channel zero and
+             must be constructed after it
   */
   Transceiver(int wBasePort,
 	      const char *TRXAddress,
 	      int wSamplesPerSymbol,
 	      GSM::Time wTransmitLatency,
-	      RadioInterface *wRadioInterface);
+	      RadioInterface *wRadioInterface,
+	      int wChan = 0);
    
   /** Destructor */
   ~Transceiver();
@@ -164,11 +277,21 @@ public:
   void start();
 
   /** attach the radioInterface receive FIFO */
-  void receiveFIFO(VectorFIFO *wFIFO) { mReceiveFIFO = wFIFO;}
+  void receiveFIFO(VectorFIFO *wFIFO);
 
   /** attach the radioInterface transmit FIFO */
   void transmitFIFO(VectorFIFO *wFIFO) { mTransmitFIFO = wFIFO;}
 
+  /** demodulate on 'num' worker threads, timeslot TN going to worker
+      TN % num; zero keeps demodulation on the FIFO thread. Call before
+      the transceiver is powered on. */
+  void demodWorkers(int num);
+
+  /** deliver bursts to the GSM core from a thread of its own, and pin
+      the FIFO and delivery threads to the given CPUs if not negative.
+      Call before the transceiver is powered on. */
+  void pipeline(int demodCPU, int deliveryCPU);
+
 protected:
 
   /** drive reception and demodulation of GSM bursts */ 
@@ -180,6 +303,12 @@ protected:
   /** drive handling of control messages from GSM core */
   void driveControl();
 
+  /** drive demodulation of the bursts of one worker */
+  void driveDemodulation(int worker);
+
+  /** drive delivery of receive bursts to the GSM core */
+  void driveDelivery();
+
   /**
     drive modulation and sorting of GSM bursts from GSM core
     @return true if a burst was transferred successfully
@@ -188,10 +317,18 @@ protected:
 
   friend void *FIFOServiceLoopAdapter(Transceiver *);
 
+  friend void *DemodServiceLoopAdapter(Transceiver *);
+
+  friend void *DeliveryServiceLoopAdapter(Transceiver *);
+
   friend void *ControlServiceLoopAdapter(Transceiver *);
 
   friend void *TransmitPriorityQueueServiceLoopAdapter(Transceiver *);
 
+  friend burstPriority BurstPriorityAdapter(const GSM::Time &, void *);
+
+  friend bool BurstFilterAdapter(const GSM::Time &, void *);
+
   void reset();
 
   /** set priority on current thread */
@@ -202,9 +339,21 @@ protected:
 /** FIFO thread loop */
 void *FIFOServiceLoopAdapter(Transceiver *);
 
+/** demodulation worker thread loop */
+void *DemodServiceLoopAdapter(Transceiver *);
+
+/** receive burst delivery thread loop */
+void *DeliveryServiceLoopAdapter(Transceiver *);
+
 /** control message handler thread loop */
 void *ControlServiceLoopAdapter(Transceiver *);
 
 /** transmit queueing thread loop */
 void *TransmitPriorityQueueServiceLoopAdapter(Transceiver *);
 
+/** receive FIFO classifier */
+enum burstPriority BurstPriorityAdapter(const GSM::Time &, void *);
+
+/** receive FIFO filter */
+bool BurstFilterAdapter(const GSM::Time &, void *);
+
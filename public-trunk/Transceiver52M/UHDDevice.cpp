@@ -22,6 +22,11 @@
 #include "radioDevice.h"
 #include "Threads.h"
 #include "Logger.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <uhd/property_tree.hpp>
 #include <uhd/usrp/single_usrp.hpp>
 #include <uhd/utils/thread_priority.hpp>
@@ -75,17 +80,28 @@ TIMESTAMP convert_time(uhd::time_spec_t ts, double rate)
     Sample Buffer - Allows reading and writing of timed samples using OpenBTS
                     or UHD style timestamps. Time conversions are handled
                     internally or accessable through the static convert calls.
+
+                    Each sample is kept at its timestamp modulo the buffer
+                    length. The same pages are mapped twice back to back,
+                    so any run of up to the buffer length is contiguous
+                    across the wrap. The device receives straight into the
+                    tail and reads are handed a pointer into the buffer.
 */
 class smpl_buf {
 public:
 	/** Sample buffer constructor
-	    @param len number of 32-bit samples the buffer should hold
+	    @param len number of 32-bit samples the buffer should hold, rounded
+	           up to whole pages
 	    @param rate sample clockrate 
-	    @param timestamp 
 	*/
 	smpl_buf(size_t len, double rate);
 	~smpl_buf();
 
+	/** Check that the buffer could be mapped
+	    @return true if the buffer is usable
+	*/
+	bool mapped() const { return data != NULL; }
+
 	/** Query number of samples available for reading
 	    @param timestamp time of first sample
 	    @return number of available samples or error
@@ -94,15 +110,29 @@ public:
 	ssize_t avail_smpls(uhd::time_spec_t timestamp) const;
 
 	/** Read and write
-	    @param buf pointer to buffer
+	    @param buf pointer to buffer, on read set to the first sample, which
+	           stays valid until the next write
 	    @param len number of samples desired to read or write
 	    @param timestamp time of first stample
 	    @return number of actual samples read or written or error
 	*/
-	ssize_t read(void *buf, size_t len, TIMESTAMP timestamp);
-	ssize_t read(void *buf, size_t len, uhd::time_spec_t timestamp);
-	ssize_t write(void *buf, size_t len, TIMESTAMP timestamp);
-	ssize_t write(void *buf, size_t len, uhd::time_spec_t timestamp);
+	ssize_t read(const void **buf, size_t len, TIMESTAMP timestamp);
+	ssize_t read(const void **buf, size_t len, uhd::time_spec_t timestamp);
+	ssize_t write(const void *buf, size_t len, TIMESTAMP timestamp);
+	ssize_t write(const void *buf, size_t len, uhd::time_spec_t timestamp);
+
+	/** Space following the newest sample, to receive into in place
+	    @return room for up to the buffer length of samples
+	*/
+	void *tail() { return at(time_end); }
+
+	/** Add samples received into the tail
+	    @param len number of samples received
+	    @param timestamp time of first sample
+	    @return number of samples added or error
+	*/
+	ssize_t commit(size_t len, TIMESTAMP timestamp);
+	ssize_t commit(size_t len, uhd::time_spec_t timestamp);
 
 	/** Buffer status string
 	    @return a formatted string describing internal buffer state
@@ -131,8 +161,13 @@ private:
 	TIMESTAMP time_start;
 	TIMESTAMP time_end;
 
-	size_t data_start;
-	size_t data_end;
+	uint32_t *at(TIMESTAMP timestamp) const
+	{
+		return data + timestamp % buf_len;
+	}
+
+	void zero_gap(size_t len, TIMESTAMP timestamp);
+	ssize_t advance(size_t len, TIMESTAMP timestamp);
 };
 
 /*
@@ -439,6 +474,8 @@ bool uhd_device::open()
 	// Create receive buffer
 	size_t buf_len = smpl_buf_sz / sizeof(uint32_t);
 	rx_smpl_buf = new smpl_buf(buf_len, actual_smpl_rt);
+	if (!rx_smpl_buf->mapped())
+		return false;
 
 	// Set receive chain sample offset 
 	ts_offset = (TIMESTAMP)(rx_smpl_offset * actual_smpl_rt);
@@ -590,7 +627,7 @@ int uhd_device::readSamples(short *buf, int len, bool *overrun,
 	ssize_t rc;
 	uhd::time_spec_t ts;
 	uhd::rx_metadata_t metadata;
-	uint32_t pkt_buf[rx_spp];
+	const void *smpls;
 
 	if (skip_rx)
 		return 0;
@@ -601,18 +638,18 @@ int uhd_device::readSamples(short *buf, int len, bool *overrun,
 	ts = convert_time(timestamp, actual_smpl_rt);
 	LOG(DEEPDEBUG) << "Requested timestamp = " << ts.get_real_secs();
 
-	// Check that timestamp is valid
-	rc = rx_smpl_buf->avail_smpls(timestamp);
-	if (rc < 0) {
-		LOG(ERROR) << rx_smpl_buf->str_code(rc);
-		LOG(ERROR) << rx_smpl_buf->str_status();
-		return 0;
-	}
+	// Receive samples from the usrp until we have enough, straight into
+	// the buffer. Check that the timestamp is valid on every pass, since
+	// an overrun can make room by dropping the samples still wanted.
+	while ((rc = rx_smpl_buf->avail_smpls(timestamp)) < len) {
+		if (rc < 0) {
+			LOG(ERROR) << rx_smpl_buf->str_code(rc);
+			LOG(ERROR) << rx_smpl_buf->str_status();
+			return 0;
+		}
 
-	// Receive samples from the usrp until we have enough
-	while (rx_smpl_buf->avail_smpls(timestamp) < len) {
 		size_t num_smpls = usrp_dev->get_device()->recv(
-					(void*)pkt_buf,
+					rx_smpl_buf->tail(),
 					rx_spp,
 					metadata,
 					uhd::io_type_t::COMPLEX_INT16,
@@ -636,9 +673,7 @@ int uhd_device::readSamples(short *buf, int len, bool *overrun,
 		ts = metadata.time_spec;
 		LOG(DEEPDEBUG) << "Received timestamp = " << ts.get_real_secs();
 
-		rc = rx_smpl_buf->write(pkt_buf,
-					num_smpls,
-					metadata.time_spec);
+		rc = rx_smpl_buf->commit(num_smpls, metadata.time_spec);
 
 		// Continue on local overrun, exit on other errors
 		if ((rc < 0)) {
@@ -650,13 +685,15 @@ int uhd_device::readSamples(short *buf, int len, bool *overrun,
 	}
 
 	// We have enough samples
-	rc = rx_smpl_buf->read(buf, len, timestamp);
+	rc = rx_smpl_buf->read(&smpls, len, timestamp);
 	if ((rc < 0) || (rc != len)) {
 		LOG(ERROR) << rx_smpl_buf->str_code(rc);
 		LOG(ERROR) << rx_smpl_buf->str_status();
 		return 0;
 	}
 
+	memcpy(buf, smpls, len * 2 * sizeof(short));
+
 	return len;
 }
 
@@ -812,15 +849,45 @@ std::string uhd_device::str_code(uhd::async_metadata_t metadata)
 }
 
 smpl_buf::smpl_buf(size_t len, double rate)
-	: buf_len(len), clk_rt(rate),
-	  time_start(0), time_end(0), data_start(0), data_end(0)
+	: data(NULL), clk_rt(rate), time_start(0), time_end(0)
 {
-	data = new uint32_t[len];
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t size = (len * sizeof(uint32_t) + page - 1) / page * page;
+	buf_len = size / sizeof(uint32_t);
+
+	char name[64];
+	snprintf(name, sizeof(name), "/openbts-smpl-buf-%d", getpid());
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) {
+		LOG(ERROR) << "Sample buffer: shm_open() failed, " << strerror(errno);
+		return;
+	}
+	shm_unlink(name);
+
+	// Reserve twice the size, then map the pages over both halves
+	char *base = (char *) mmap(NULL, 2 * size, PROT_NONE,
+				   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ((ftruncate(fd, size) < 0) || (base == MAP_FAILED) ||
+	    (mmap(base, size, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) ||
+	    (mmap(base + size, size, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+		LOG(ERROR) << "Sample buffer: mapping failed, " << strerror(errno);
+		if (base != MAP_FAILED)
+			munmap(base, 2 * size);
+		close(fd);
+		return;
+	}
+	close(fd);
+
+	data = (uint32_t *) base;
+	memset(data, 0, size);
 }
 
 smpl_buf::~smpl_buf()
 {
-	delete[] data;
+	if (data)
+		munmap(data, 2 * buf_len * sizeof(uint32_t));
 }
 
 ssize_t smpl_buf::avail_smpls(TIMESTAMP timestamp) const
@@ -838,10 +905,8 @@ ssize_t smpl_buf::avail_smpls(uhd::time_spec_t timespec) const
 	return avail_smpls(convert_time(timespec, clk_rt));
 }
 
-ssize_t smpl_buf::read(void *buf, size_t len, TIMESTAMP timestamp)
+ssize_t smpl_buf::read(const void **buf, size_t len, TIMESTAMP timestamp)
 {
-	int type_sz = 2 * sizeof(short);
-
 	// Check for valid read
 	if (timestamp < time_start)
 		return ERROR_TIMESTAMP;
@@ -850,79 +915,98 @@ ssize_t smpl_buf::read(void *buf, size_t len, TIMESTAMP timestamp)
 	if (len >= buf_len)
 		return ERROR_READ;
 
-	// How many samples should be copied
+	// How many samples can be read
 	size_t num_smpls = time_end - timestamp;
-	if (num_smpls > len);
+	if (num_smpls > len)
 		num_smpls = len;
 
-	// Starting index
-	size_t read_start = data_start + (timestamp - time_start);
+	*buf = at(timestamp);
+	time_start = timestamp + num_smpls;
 
-	// Read it
-	if (read_start + num_smpls < buf_len) {
-		size_t numBytes = len * type_sz;
-		memcpy(buf, data + read_start, numBytes);
-	} else {
-		size_t first_cp = (buf_len - read_start) * type_sz;
-		size_t second_cp = len * type_sz - first_cp;
+	return num_smpls;
+}
 
-		memcpy(buf, data + read_start, first_cp);
-		memcpy((char*) buf + first_cp, data, second_cp);
-	}
+ssize_t smpl_buf::read(const void **buf, size_t len, uhd::time_spec_t ts)
+{
+	return read(buf, len, convert_time(ts, clk_rt));
+}
 
-	data_start = (read_start + len) % buf_len;
-	time_start = timestamp + len;
+ssize_t smpl_buf::write(const void *buf, size_t len, TIMESTAMP timestamp)
+{
+	// Check for valid write
+	if ((len == 0) || (len >= buf_len))
+		return ERROR_WRITE;
+	if ((timestamp + len) <= time_end)
+		return ERROR_TIMESTAMP;
 
-	if (time_start > time_end)
-		return ERROR_READ;
-	else
-		return num_smpls;
+	zero_gap(len, timestamp);
+	memcpy(at(timestamp), buf, len * sizeof(uint32_t));
+
+	return advance(len, timestamp);
 }
 
-ssize_t smpl_buf::read(void *buf, size_t len, uhd::time_spec_t ts)
+ssize_t smpl_buf::write(const void *buf, size_t len, uhd::time_spec_t ts)
 {
-	return read(buf, len, convert_time(ts, clk_rt));
+	return write(buf, len, convert_time(ts, clk_rt));
 }
 
-ssize_t smpl_buf::write(void *buf, size_t len, TIMESTAMP timestamp)
+ssize_t smpl_buf::commit(size_t len, TIMESTAMP timestamp)
 {
-	int type_sz = 2 * sizeof(short);
-
 	// Check for valid write
 	if ((len == 0) || (len >= buf_len))
 		return ERROR_WRITE;
 	if ((timestamp + len) <= time_end)
 		return ERROR_TIMESTAMP;
 
-	// Starting index
-	size_t write_start = (data_start + (timestamp - time_start)) % buf_len;
+	// Samples that do not follow on from the newest are moved into place,
+	// which only happens after lost packets or a restart
+	if (timestamp != time_end) {
+		uint32_t *pkt = new uint32_t[len];
+		memcpy(pkt, tail(), len * sizeof(uint32_t));
+		ssize_t rc = write(pkt, len, timestamp);
+		delete[] pkt;
+		return rc;
+	}
 
-	// Write it
-	if ((write_start + len) < buf_len) {
-		size_t numBytes = len * type_sz;
-		memcpy(data + write_start, buf, numBytes);
-	} else {
-		size_t first_cp = (buf_len - write_start) * type_sz;
-		size_t second_cp = len * type_sz - first_cp;
+	return advance(len, timestamp);
+}
 
-		memcpy(data + write_start, buf, first_cp);
-		memcpy(data, (char*) buf + first_cp, second_cp);
-	}
+ssize_t smpl_buf::commit(size_t len, uhd::time_spec_t ts)
+{
+	return commit(len, convert_time(ts, clk_rt));
+}
 
-	data_end = (write_start + len) % buf_len;
-	time_end = timestamp + len;
+/*
+ * Zero the samples lost between the newest and the 'len' samples at
+ * 'timestamp', never touching the pages of those through the other mapping
+ */
+void smpl_buf::zero_gap(size_t len, TIMESTAMP timestamp)
+{
+	if (timestamp <= time_end)
+		return;
 
-	if (((write_start + len) > buf_len) && (data_end > data_start))
-		return ERROR_OVERFLOW;
-	else if (time_end <= time_start)
-		return ERROR_WRITE;
+	TIMESTAMP gap = timestamp - time_end;
+	if (gap > buf_len - len)
+		memset(at(timestamp + len), 0, (buf_len - len) * sizeof(uint32_t));
 	else
-		return len;
+		memset(at(time_end), 0, gap * sizeof(uint32_t));
 }
 
-ssize_t smpl_buf::write(void *buf, size_t len, uhd::time_spec_t ts)
+ssize_t smpl_buf::advance(size_t len, TIMESTAMP timestamp)
 {
-	return write(buf, len, convert_time(ts, clk_rt));
+	TIMESTAMP prev_end = time_end;
+	time_end = timestamp + len;
+
+	// The oldest samples make room, an overrun if any were still unread
+	if (time_end - time_start > buf_len) {
+		TIMESTAMP oldest = time_end - buf_len;
+		bool lost = (prev_end < oldest ? prev_end : oldest) > time_start;
+		time_start = oldest;
+		if (lost)
+			return ERROR_OVERFLOW;
+	}
+
+	return len;
 }
 
 std::string smpl_buf::str_status() const
@@ -932,8 +1016,6 @@ std::string smpl_buf::str_status() const
 	ost << "length = " << buf_len;
 	ost << ", time_start = " << time_start;
 	ost << ", time_end = " << time_end;
-	ost << ", data_start = " << data_start;
-	ost << ", data_end = " << data_end;
 
 	return ost.str();
 }
@@ -0,0 +1,204 @@
+/*
+ * Polyphase filterbank channelizer and synthesizer
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "channelizer.h"
+#include "convolve.h"
+
+/* Prototype filter taps per filterbank path, a multiple of four */
+#define CHAN_BRANCH_LEN		16
+
+/* Alignment of the filter bank and path buffers in bytes */
+#define CHAN_ALIGN		32
+
+static float *alloc_aligned(size_t num_floats)
+{
+	void *ptr;
+
+	if (posix_memalign(&ptr, CHAN_ALIGN, num_floats * sizeof(float)))
+		return NULL;
+
+	memset(ptr, 0, num_floats * sizeof(float));
+	return (float *) ptr;
+}
+
+ChannelizerBase::ChannelizerBase(int wM, int chunkLen)
+	: M(wM), chunk_len(chunkLen), branch_len(CHAN_BRANCH_LEN)
+{
+	fft = new FFT(M);
+	fft_buf = new complex[M];
+
+	initBank();
+
+	paths = new float *[M];
+	for (int i = 0; i < M; i++)
+		paths[i] = alloc_aligned(2 * (branch_len + chunk_len));
+}
+
+ChannelizerBase::~ChannelizerBase()
+{
+	for (int i = 0; i < M; i++)
+		free(paths[i]);
+
+	delete[] paths;
+	delete[] fft_buf;
+	delete fft;
+	free(bank);
+}
+
+int ChannelizerBase::offset(int chan) const
+{
+	return (chan < M / 2) ? chan : chan - M;
+}
+
+/*
+ * The prototype is a Blackman windowed sinc with unity DC gain and its
+ * cutoff at half the channel rate. Path p takes every M'th tap starting at
+ * tap p. As in the resampler, path taps are stored in reverse so that each
+ * output is a dot product over ascending samples, and every tap is
+ * duplicated to match interleaved complex samples.
+ */
+void ChannelizerBase::initBank()
+{
+	int len = M * branch_len;
+	float *proto = new float[len];
+	double sum = 0.0;
+
+	for (int i = 0; i < len; i++) {
+		double t = (i - (len - 1) / 2.0) / M;
+		double w = 2.0 * M_PI * i / (len - 1);
+		double sinc = (fabs(t) < 1e-9) ? 1.0 : sin(M_PI * t) / (M_PI * t);
+
+		proto[i] = sinc * (0.42 - 0.5 * cos(w) + 0.08 * cos(2.0 * w));
+		sum += proto[i];
+	}
+
+	bank = alloc_aligned(2 * len);
+
+	for (int p = 0; p < M; p++) {
+		float *branch = bank + 2 * p * branch_len;
+
+		for (int k = 0; k < branch_len; k++) {
+			int i = branch_len - 1 - k;
+
+			branch[2 * i + 0] = proto[p + k * M] / sum;
+			branch[2 * i + 1] = proto[p + k * M] / sum;
+		}
+	}
+
+	delete[] proto;
+}
+
+/* Keep the newest path samples as history for the next chunk */
+void ChannelizerBase::updateHistory(int len)
+{
+	for (int p = 0; p < M; p++) {
+		memmove(paths[p], paths[p] + 2 * len,
+			2 * branch_len * sizeof(float));
+	}
+}
+
+Channelizer::Channelizer(int M, int chunkLen)
+	: ChannelizerBase(M, chunkLen)
+{
+}
+
+/*
+ * Path p is fed wideband samples n * M + M - 1 - p, i.e. the commutator
+ * runs backwards through each block of M samples. The inverse transform
+ * across the path outputs then mixes each channel down to baseband.
+ */
+bool Channelizer::rotate(const float *in, int len, float **out)
+{
+	float sum[2];
+
+	if (len > chunk_len)
+		return false;
+
+	for (int p = 0; p < M; p++) {
+		float *path = paths[p] + 2 * branch_len;
+
+		for (int n = 0; n < len; n++) {
+			path[2 * n + 0] = in[2 * (n * M + M - 1 - p) + 0];
+			path[2 * n + 1] = in[2 * (n * M + M - 1 - p) + 1];
+		}
+	}
+
+	for (int n = 0; n < len; n++) {
+		for (int p = 0; p < M; p++) {
+			convolveDotReal(sum, paths[p] + 2 * (n + 1),
+					bank + 2 * p * branch_len, branch_len);
+			fft_buf[p] = complex(sum[0], sum[1]);
+		}
+
+		fft->inverse(fft_buf);
+
+		for (int k = 0; k < M; k++) {
+			out[k][2 * n + 0] = fft_buf[k].real();
+			out[k][2 * n + 1] = fft_buf[k].imag();
+		}
+	}
+
+	updateHistory(len);
+	return true;
+}
+
+Synthesizer::Synthesizer(int M, int chunkLen)
+	: ChannelizerBase(M, chunkLen)
+{
+}
+
+/*
+ * The inverse transform across channels mixes each channel up to its
+ * offset. Path q then interpolates wideband samples n * M + q.
+ */
+bool Synthesizer::rotate(float **in, int len, float *out)
+{
+	if (len > chunk_len)
+		return false;
+
+	for (int n = 0; n < len; n++) {
+		for (int k = 0; k < M; k++)
+			fft_buf[k] = complex(in[k][2 * n + 0], in[k][2 * n + 1]);
+
+		fft->inverse(fft_buf);
+
+		for (int q = 0; q < M; q++) {
+			float *path = paths[q] + 2 * branch_len;
+			path[2 * n + 0] = fft_buf[q].real();
+			path[2 * n + 1] = fft_buf[q].imag();
+		}
+	}
+
+	for (int q = 0; q < M; q++) {
+		for (int n = 0; n < len; n++) {
+			convolveDotReal(out + 2 * (n * M + q),
+					paths[q] + 2 * (n + 1),
+					bank + 2 * q * branch_len, branch_len);
+		}
+	}
+
+	updateHistory(len);
+	return true;
+}
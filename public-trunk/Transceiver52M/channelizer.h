@@ -0,0 +1,104 @@
+/*
+ * Polyphase filterbank channelizer and synthesizer
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef CHANNELIZER_H
+#define CHANNELIZER_H
+
+#include "fft.h"
+
+/*
+    ChannelizerBase - Shared state of the critically sampled M-path
+                      filterbanks. The wideband rate is M times the channel
+                      rate and channel k is centred at k times the channel
+                      rate, so channels M/2 and up lie below the wideband
+                      centre frequency. Samples are interleaved complex
+                      floats and are processed 'chunkLen' channel samples
+                      at a time.
+*/
+class ChannelizerBase {
+public:
+	/** Number of channels, i.e. the number of filterbank paths */
+	int size() const { return M; }
+
+	/** Channel index to frequency offset in units of the channel rate */
+	int offset(int chan) const;
+
+protected:
+	ChannelizerBase(int M, int chunkLen);
+	~ChannelizerBase();
+
+	int M;
+	int chunk_len;
+
+	/* One reversed, duplicated branch of 'branch_len' taps per path */
+	float *bank;
+	int branch_len;
+
+	/* Per path history followed by a chunk of path samples */
+	float **paths;
+
+	FFT *fft;
+	complex *fft_buf;
+
+	void initBank();
+	void updateHistory(int len);
+};
+
+/*
+    Channelizer - Split a wideband stream into M channel streams.
+*/
+class Channelizer : public ChannelizerBase {
+public:
+	/** Channelizer constructor
+	    @param M number of channels, a power of two
+	    @param chunkLen largest number of channel samples per call
+	*/
+	Channelizer(int M, int chunkLen);
+
+	/** Split wideband samples
+	    @param in M * len wideband samples
+	    @param len number of samples per channel, at most chunkLen
+	    @param out M channel buffers of len samples each
+	*/
+	bool rotate(const float *in, int len, float **out);
+};
+
+/*
+    Synthesizer - Combine M channel streams into a wideband stream. Each
+                  channel appears at 1/M of its input amplitude, so that
+                  the sum of M full scale channels stays within full scale.
+*/
+class Synthesizer : public ChannelizerBase {
+public:
+	/** Synthesizer constructor
+	    @param M number of channels, a power of two
+	    @param chunkLen largest number of channel samples per call
+	*/
+	Synthesizer(int M, int chunkLen);
+
+	/** Combine channel samples
+	    @param in M channel buffers of len samples each
+	    @param len number of samples per channel, at most chunkLen
+	    @param out M * len wideband samples
+	*/
+	bool rotate(float **in, int len, float *out);
+};
+
+#endif /* CHANNELIZER_H */
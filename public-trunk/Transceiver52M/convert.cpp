@@ -0,0 +1,236 @@
+/*
+ * Sample format conversion kernels
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include "convert.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define HAVE_X86_KERNELS
+  #include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+  #define HAVE_NEON_KERNELS
+  #include <arm_neon.h>
+#endif
+
+#define SHORT_MAX	32767.0f
+#define SHORT_MIN	-32768.0f
+
+typedef void (*flt_short_func)(short *out, const float *in, float scale, int len);
+typedef void (*short_flt_func)(float *out, const short *in, float scale, int len);
+
+/*
+ * Generic kernels
+ *
+ * The float is clamped before the conversion, which then truncates, as
+ * the vector conversions below do.
+ */
+static void flt_short_generic(short *out, const float *in, float scale, int len)
+{
+	for (int i = 0; i < 2 * len; i++) {
+		float val = in[i] * scale;
+
+		if (val > SHORT_MAX)
+			val = SHORT_MAX;
+		else if (val < SHORT_MIN)
+			val = SHORT_MIN;
+
+		out[i] = (short) val;
+	}
+}
+
+static void short_flt_generic(float *out, const short *in, float scale, int len)
+{
+	for (int i = 0; i < 2 * len; i++)
+		out[i] = (float) in[i] * scale;
+}
+
+#ifdef HAVE_X86_KERNELS
+/* SSE2 kernels - four complex samples per iteration */
+__attribute__((target("sse2")))
+static inline __m128i flt_int_sse2(const float *in, __m128 scale)
+{
+	__m128 v = _mm_mul_ps(_mm_loadu_ps(in), scale);
+	v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(SHORT_MIN)),
+		       _mm_set1_ps(SHORT_MAX));
+	return _mm_cvttps_epi32(v);
+}
+
+__attribute__((target("sse2")))
+static void flt_short_sse2(short *out, const float *in, float scale, int len)
+{
+	int i;
+	__m128 s = _mm_set1_ps(scale);
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m128i a = flt_int_sse2(in + 2 * i, s);
+		__m128i b = flt_int_sse2(in + 2 * i + 4, s);
+		_mm_storeu_si128((__m128i *) (out + 2 * i),
+				 _mm_packs_epi32(a, b));
+	}
+
+	flt_short_generic(out + 2 * i, in + 2 * i, scale, len - i);
+}
+
+__attribute__((target("sse2")))
+static void short_flt_sse2(float *out, const short *in, float scale, int len)
+{
+	int i;
+	__m128 s = _mm_set1_ps(scale);
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (in + 2 * i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		_mm_storeu_ps(out + 2 * i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+		_mm_storeu_ps(out + 2 * i + 4,
+			      _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+	}
+
+	short_flt_generic(out + 2 * i, in + 2 * i, scale, len - i);
+}
+
+/* AVX2 kernels - eight complex samples per iteration */
+__attribute__((target("avx2")))
+static inline __m256i flt_int_avx2(const float *in, __m256 scale)
+{
+	__m256 v = _mm256_mul_ps(_mm256_loadu_ps(in), scale);
+	v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(SHORT_MIN)),
+			  _mm256_set1_ps(SHORT_MAX));
+	return _mm256_cvttps_epi32(v);
+}
+
+__attribute__((target("avx2")))
+static void flt_short_avx2(short *out, const float *in, float scale, int len)
+{
+	int i;
+	__m256 s = _mm256_set1_ps(scale);
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		__m256i a = flt_int_avx2(in + 2 * i, s);
+		__m256i b = flt_int_avx2(in + 2 * i + 8, s);
+
+		/* Packing works within 128-bit lanes, so put them back in order */
+		__m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b),
+						     _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i *) (out + 2 * i), v);
+	}
+
+	flt_short_generic(out + 2 * i, in + 2 * i, scale, len - i);
+}
+
+__attribute__((target("avx2")))
+static void short_flt_avx2(float *out, const short *in, float scale, int len)
+{
+	int i;
+	__m256 s = _mm256_set1_ps(scale);
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (in + 2 * i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (in + 2 * i + 8));
+		__m256 fa = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a));
+		__m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b));
+		_mm256_storeu_ps(out + 2 * i, _mm256_mul_ps(fa, s));
+		_mm256_storeu_ps(out + 2 * i + 8, _mm256_mul_ps(fb, s));
+	}
+
+	short_flt_generic(out + 2 * i, in + 2 * i, scale, len - i);
+}
+#endif /* HAVE_X86_KERNELS */
+
+#ifdef HAVE_NEON_KERNELS
+/* NEON kernels - four complex samples per iteration */
+static inline int32x4_t flt_int_neon(const float *in, float scale)
+{
+	float32x4_t v = vmulq_n_f32(vld1q_f32(in), scale);
+	v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(SHORT_MIN)),
+		      vdupq_n_f32(SHORT_MAX));
+	return vcvtq_s32_f32(v);
+}
+
+static void flt_short_neon(short *out, const float *in, float scale, int len)
+{
+	int i;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		int16x4_t a = vqmovn_s32(flt_int_neon(in + 2 * i, scale));
+		int16x4_t b = vqmovn_s32(flt_int_neon(in + 2 * i + 4, scale));
+		vst1q_s16(out + 2 * i, vcombine_s16(a, b));
+	}
+
+	flt_short_generic(out + 2 * i, in + 2 * i, scale, len - i);
+}
+
+static void short_flt_neon(float *out, const short *in, float scale, int len)
+{
+	int i;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		int16x8_t v = vld1q_s16(in + 2 * i);
+		float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+		float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+		vst1q_f32(out + 2 * i, vmulq_n_f32(lo, scale));
+		vst1q_f32(out + 2 * i + 4, vmulq_n_f32(hi, scale));
+	}
+
+	short_flt_generic(out + 2 * i, in + 2 * i, scale, len - i);
+}
+#endif /* HAVE_NEON_KERNELS */
+
+/* Selected kernels, default to generic until convertInit() runs */
+static flt_short_func flt_short = flt_short_generic;
+static short_flt_func short_flt = short_flt_generic;
+static const char *convert_impl = "generic";
+
+void convertInit()
+{
+#if defined(HAVE_NEON_KERNELS)
+	flt_short = flt_short_neon;
+	short_flt = short_flt_neon;
+	convert_impl = "neon";
+#elif defined(HAVE_X86_KERNELS)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		flt_short = flt_short_avx2;
+		short_flt = short_flt_avx2;
+		convert_impl = "avx2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		flt_short = flt_short_sse2;
+		short_flt = short_flt_sse2;
+		convert_impl = "sse2";
+	}
+#endif
+}
+
+const char *convertImpl()
+{
+	return convert_impl;
+}
+
+void convertFloatToShort(short *out, const float *in, float scale, int len)
+{
+	flt_short(out, in, scale, len);
+}
+
+void convertShortToFloat(float *out, const short *in, float scale, int len)
+{
+	short_flt(out, in, scale, len);
+}
@@ -0,0 +1,47 @@
+/*
+ * Sample format conversion kernels
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+/*
+ * Conversion between interleaved complex floats, the layout of
+ * signalVector data, and the interleaved 16-bit integers of the device.
+ * 'len' is the number of complex samples.
+ *
+ * Scaling is applied on the way through, so a burst goes from a
+ * signalVector to the device buffer, or back, in a single pass. Floats
+ * are scaled, clamped to the 16-bit range and truncated towards zero;
+ * every implementation gives identical results.
+ */
+
+/** Select kernels for the running CPU; safe to call more than once */
+void convertInit();
+
+/** Return the name of the selected kernel set */
+const char *convertImpl();
+
+/** out = saturate(in * scale) */
+void convertFloatToShort(short *out, const float *in, float scale, int len);
+
+/** out = in * scale */
+void convertShortToFloat(float *out, const short *in, float scale, int len);
+
+#endif /* CONVERT_H */
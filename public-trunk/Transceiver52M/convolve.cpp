@@ -0,0 +1,343 @@
+/*
+ * Convolution kernels with runtime CPU dispatch
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include "convolve.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define HAVE_X86_KERNELS
+  #include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+  #define HAVE_NEON_KERNELS
+  #include <arm_neon.h>
+#endif
+
+typedef void (*mac_func)(float *y, const float *x, const float *h, int len);
+
+/*
+ * Generic kernels
+ *
+ * Operation order matches the complex arithmetic in Complex.h so that the
+ * vector versions below can be checked against these bit for bit.
+ */
+static void mac_real_generic(float *y, const float *x, const float *h, int len)
+{
+	for (int i = 0; i < len; i++) {
+		y[2 * i + 0] += h[0] * x[2 * i];
+		y[2 * i + 1] += h[1] * x[2 * i];
+	}
+}
+
+static void mac_real_tap_generic(float *y, const float *x, const float *h, int len)
+{
+	for (int i = 0; i < 2 * len; i++)
+		y[i] += x[i] * h[0];
+}
+
+static void mac_cplx_generic(float *y, const float *x, const float *h, int len)
+{
+	for (int i = 0; i < len; i++) {
+		y[2 * i + 0] += x[2 * i + 0] * h[0] - x[2 * i + 1] * h[1];
+		y[2 * i + 1] += x[2 * i + 0] * h[1] + x[2 * i + 1] * h[0];
+	}
+}
+
+static void dot_real_generic(float *y, const float *x, const float *h, int len)
+{
+	float sum_r = 0.0f, sum_i = 0.0f;
+
+	for (int i = 0; i < len; i++) {
+		sum_r += x[2 * i + 0] * h[2 * i + 0];
+		sum_i += x[2 * i + 1] * h[2 * i + 1];
+	}
+
+	y[0] = sum_r;
+	y[1] = sum_i;
+}
+
+#ifdef HAVE_X86_KERNELS
+/* SSE3 kernels - two complex samples per iteration */
+__attribute__((target("sse3")))
+static void mac_real_sse3(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	__m128 hv = _mm_setr_ps(h[0], h[1], h[0], h[1]);
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		__m128 xr = _mm_moveldup_ps(_mm_loadu_ps(x + 2 * i));
+		__m128 yv = _mm_loadu_ps(y + 2 * i);
+		_mm_storeu_ps(y + 2 * i, _mm_add_ps(yv, _mm_mul_ps(hv, xr)));
+	}
+
+	mac_real_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+
+__attribute__((target("sse3")))
+static void mac_real_tap_sse3(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	__m128 hv = _mm_set1_ps(h[0]);
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		__m128 xv = _mm_loadu_ps(x + 2 * i);
+		__m128 yv = _mm_loadu_ps(y + 2 * i);
+		_mm_storeu_ps(y + 2 * i, _mm_add_ps(yv, _mm_mul_ps(xv, hv)));
+	}
+
+	mac_real_tap_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+
+__attribute__((target("sse3")))
+static void mac_cplx_sse3(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	__m128 hr = _mm_set1_ps(h[0]);
+	__m128 hi = _mm_set1_ps(h[1]);
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		__m128 xv = _mm_loadu_ps(x + 2 * i);
+		__m128 xs = _mm_shuffle_ps(xv, xv, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 p = _mm_addsub_ps(_mm_mul_ps(xv, hr), _mm_mul_ps(xs, hi));
+		__m128 yv = _mm_loadu_ps(y + 2 * i);
+		_mm_storeu_ps(y + 2 * i, _mm_add_ps(yv, p));
+	}
+
+	mac_cplx_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+
+__attribute__((target("sse3")))
+static void dot_real_sse3(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	float tail[2], sum[4];
+	__m128 acc = _mm_setzero_ps();
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		__m128 xv = _mm_loadu_ps(x + 2 * i);
+		__m128 hv = _mm_loadu_ps(h + 2 * i);
+		acc = _mm_add_ps(acc, _mm_mul_ps(xv, hv));
+	}
+
+	_mm_storeu_ps(sum, acc);
+	dot_real_generic(tail, x + 2 * i, h + 2 * i, len - i);
+
+	y[0] = sum[0] + sum[2] + tail[0];
+	y[1] = sum[1] + sum[3] + tail[1];
+}
+
+/* AVX kernels - four complex samples per iteration */
+__attribute__((target("avx")))
+static void mac_real_avx(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	__m256 hv = _mm256_setr_ps(h[0], h[1], h[0], h[1],
+				   h[0], h[1], h[0], h[1]);
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m256 xr = _mm256_moveldup_ps(_mm256_loadu_ps(x + 2 * i));
+		__m256 yv = _mm256_loadu_ps(y + 2 * i);
+		_mm256_storeu_ps(y + 2 * i, _mm256_add_ps(yv, _mm256_mul_ps(hv, xr)));
+	}
+
+	mac_real_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+
+__attribute__((target("avx")))
+static void mac_real_tap_avx(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	__m256 hv = _mm256_set1_ps(h[0]);
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m256 xv = _mm256_loadu_ps(x + 2 * i);
+		__m256 yv = _mm256_loadu_ps(y + 2 * i);
+		_mm256_storeu_ps(y + 2 * i, _mm256_add_ps(yv, _mm256_mul_ps(xv, hv)));
+	}
+
+	mac_real_tap_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+
+__attribute__((target("avx")))
+static void mac_cplx_avx(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	__m256 hr = _mm256_set1_ps(h[0]);
+	__m256 hi = _mm256_set1_ps(h[1]);
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m256 xv = _mm256_loadu_ps(x + 2 * i);
+		__m256 xs = _mm256_permute_ps(xv, _MM_SHUFFLE(2, 3, 0, 1));
+		__m256 p = _mm256_addsub_ps(_mm256_mul_ps(xv, hr),
+					    _mm256_mul_ps(xs, hi));
+		__m256 yv = _mm256_loadu_ps(y + 2 * i);
+		_mm256_storeu_ps(y + 2 * i, _mm256_add_ps(yv, p));
+	}
+
+	mac_cplx_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+
+__attribute__((target("avx")))
+static void dot_real_avx(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	float tail[2], sum[8];
+	__m256 acc = _mm256_setzero_ps();
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m256 xv = _mm256_loadu_ps(x + 2 * i);
+		__m256 hv = _mm256_loadu_ps(h + 2 * i);
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(xv, hv));
+	}
+
+	_mm256_storeu_ps(sum, acc);
+	dot_real_generic(tail, x + 2 * i, h + 2 * i, len - i);
+
+	y[0] = (sum[0] + sum[4]) + (sum[2] + sum[6]) + tail[0];
+	y[1] = (sum[1] + sum[5]) + (sum[3] + sum[7]) + tail[1];
+}
+#endif /* HAVE_X86_KERNELS */
+
+#ifdef HAVE_NEON_KERNELS
+/* NEON kernels - four complex samples per iteration, deinterleaved */
+static void mac_real_neon(float *y, const float *x, const float *h, int len)
+{
+	int i;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		float32x4x2_t xv = vld2q_f32(x + 2 * i);
+		float32x4x2_t yv = vld2q_f32(y + 2 * i);
+		yv.val[0] = vaddq_f32(yv.val[0], vmulq_n_f32(xv.val[0], h[0]));
+		yv.val[1] = vaddq_f32(yv.val[1], vmulq_n_f32(xv.val[0], h[1]));
+		vst2q_f32(y + 2 * i, yv);
+	}
+
+	mac_real_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+
+static void mac_real_tap_neon(float *y, const float *x, const float *h, int len)
+{
+	int i;
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		float32x4_t xv = vld1q_f32(x + 2 * i);
+		float32x4_t yv = vld1q_f32(y + 2 * i);
+		vst1q_f32(y + 2 * i, vaddq_f32(yv, vmulq_n_f32(xv, h[0])));
+	}
+
+	mac_real_tap_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+
+static void mac_cplx_neon(float *y, const float *x, const float *h, int len)
+{
+	int i;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		float32x4x2_t xv = vld2q_f32(x + 2 * i);
+		float32x4x2_t yv = vld2q_f32(y + 2 * i);
+		float32x4_t re = vsubq_f32(vmulq_n_f32(xv.val[0], h[0]),
+					   vmulq_n_f32(xv.val[1], h[1]));
+		float32x4_t im = vaddq_f32(vmulq_n_f32(xv.val[0], h[1]),
+					   vmulq_n_f32(xv.val[1], h[0]));
+		yv.val[0] = vaddq_f32(yv.val[0], re);
+		yv.val[1] = vaddq_f32(yv.val[1], im);
+		vst2q_f32(y + 2 * i, yv);
+	}
+
+	mac_cplx_generic(y + 2 * i, x + 2 * i, h, len - i);
+}
+static void dot_real_neon(float *y, const float *x, const float *h, int len)
+{
+	int i;
+	float tail[2], sum[4];
+	float32x4_t acc = vdupq_n_f32(0.0f);
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		float32x4_t xv = vld1q_f32(x + 2 * i);
+		float32x4_t hv = vld1q_f32(h + 2 * i);
+		acc = vaddq_f32(acc, vmulq_f32(xv, hv));
+	}
+
+	vst1q_f32(sum, acc);
+	dot_real_generic(tail, x + 2 * i, h + 2 * i, len - i);
+
+	y[0] = sum[0] + sum[2] + tail[0];
+	y[1] = sum[1] + sum[3] + tail[1];
+}
+#endif /* HAVE_NEON_KERNELS */
+
+/* Selected kernels, default to generic until convolveInit() runs */
+static mac_func mac_real = mac_real_generic;
+static mac_func mac_real_tap = mac_real_tap_generic;
+static mac_func mac_cplx = mac_cplx_generic;
+static mac_func dot_real = dot_real_generic;
+static const char *mac_impl = "generic";
+
+void convolveInit()
+{
+#if defined(HAVE_NEON_KERNELS)
+	mac_real = mac_real_neon;
+	mac_real_tap = mac_real_tap_neon;
+	mac_cplx = mac_cplx_neon;
+	dot_real = dot_real_neon;
+	mac_impl = "neon";
+#elif defined(HAVE_X86_KERNELS)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx")) {
+		mac_real = mac_real_avx;
+		mac_real_tap = mac_real_tap_avx;
+		mac_cplx = mac_cplx_avx;
+		dot_real = dot_real_avx;
+		mac_impl = "avx";
+	} else if (__builtin_cpu_supports("sse3")) {
+		mac_real = mac_real_sse3;
+		mac_real_tap = mac_real_tap_sse3;
+		mac_cplx = mac_cplx_sse3;
+		dot_real = dot_real_sse3;
+		mac_impl = "sse3";
+	}
+#endif
+}
+
+const char *convolveImpl()
+{
+	return mac_impl;
+}
+
+void convolveMacReal(float *y, const float *x, const float *h, int len)
+{
+	mac_real(y, x, h, len);
+}
+
+void convolveMacRealTap(float *y, const float *x, const float *h, int len)
+{
+	mac_real_tap(y, x, h, len);
+}
+
+void convolveMacComplex(float *y, const float *x, const float *h, int len)
+{
+	mac_cplx(y, x, h, len);
+}
+
+void convolveDotReal(float *y, const float *x, const float *h, int len)
+{
+	dot_real(y, x, h, len);
+}
@@ -0,0 +1,64 @@
+/*
+ * Convolution kernels with runtime CPU dispatch
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+/*
+ * Multiply-accumulate kernels
+ *
+ * All vectors are interleaved complex floats, i.e. the layout of
+ * signalVector data, and 'len' is the number of complex samples. The tap
+ * 'h' is a single complex value that is applied to every input sample.
+ * Kernels accumulate into the output so that convolve() can build each
+ * output by walking the filter one tap at a time over contiguous input.
+ *
+ * The selected implementations produce results identical to the scalar
+ * versions; no fused multiply-add is used, so results do not depend on
+ * the host that happens to run the transceiver.
+ *
+ * The dot product kernel is the exception. Vector versions accumulate in
+ * parallel lanes, so the summation order, and the last bits of the
+ * result, differ from the scalar version.
+ */
+
+/** Select kernels for the running CPU; safe to call more than once */
+void convolveInit();
+
+/** Return the name of the selected kernel set */
+const char *convolveImpl();
+
+/** y += h * Re{x}, real-valued input vector */
+void convolveMacReal(float *y, const float *x, const float *h, int len);
+
+/** y += Re{h} * x, real-valued filter tap */
+void convolveMacRealTap(float *y, const float *x, const float *h, int len);
+
+/** y += h * x, complex input vector and filter tap */
+void convolveMacComplex(float *y, const float *x, const float *h, int len);
+
+/**
+ * y = sum(x & h), the component-wise product of Complex.h. Real-valued
+ * filters are stored with each tap duplicated, i.e. (h, h), so that this
+ * gives the filtered output of a complex input vector.
+ */
+void convolveDotReal(float *y, const float *x, const float *h, int len);
+
+#endif /* CONVOLVE_H */
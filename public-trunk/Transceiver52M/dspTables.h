@@ -0,0 +1,408 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+/* Generated by genTables, do not edit */
+
+#ifndef DSPTABLES_H
+#define DSPTABLES_H
+
+#define DSPTABLES_TABLESIZE		1024
+#define DSPTABLES_FARROW_LEN		21
+#define DSPTABLES_FARROW_ORDER		6
+
+/* cos and sin of 2 pi i / TABLESIZE, with one entry for wrap around */
+static const float cosTable[1025] = {
+	1, 0.999981165, 0.999924719, 0.999830604, 0.999698818, 0.999529421,
+	0.999322355, 0.999077737, 0.99879545, 0.998475552, 0.998118103, 0.997723043,
+	0.997290432, 0.996820271, 0.996312618, 0.995767415, 0.99518472, 0.994564593,
+	0.993906975, 0.993211925, 0.992479563, 0.991709769, 0.990902662, 0.990058184,
+	0.989176512, 0.988257587, 0.987301409, 0.986308098, 0.985277653, 0.984210074,
+	0.983105481, 0.981963873, 0.980785251, 0.979569793, 0.97831738, 0.977028131,
+	0.975702107, 0.974339366, 0.972939968, 0.971503913, 0.970031261, 0.968522072,
+	0.966976464, 0.965394437, 0.963776052, 0.962121427, 0.960430503, 0.958703458,
+	0.956940353, 0.955141187, 0.953306019, 0.95143503, 0.949528158, 0.947585583,
+	0.945607305, 0.943593442, 0.941544056, 0.939459205, 0.937339008, 0.935183525,
+	0.932992816, 0.93076694, 0.928506076, 0.926210225, 0.923879504, 0.921514034,
+	0.919113874, 0.916679084, 0.914209783, 0.91170603, 0.909168005, 0.906595707,
+	0.903989315, 0.901348829, 0.898674488, 0.895966232, 0.893224299, 0.890448749,
+	0.887639642, 0.884797096, 0.881921291, 0.879012227, 0.876070082, 0.873094976,
+	0.870086968, 0.867046237, 0.863972843, 0.860866964, 0.857728601, 0.854557991,
+	0.851355195, 0.848120332, 0.84485358, 0.841554999, 0.838224709, 0.834862888,
+	0.831469595, 0.82804507, 0.824589312, 0.8211025, 0.817584813, 0.81403631,
+	0.81045717, 0.806847572, 0.803207517, 0.799537241, 0.795836926, 0.792106569,
+	0.78834641, 0.784556568, 0.780737221, 0.77688849, 0.773010433, 0.769103348,
+	0.765167236, 0.761202395, 0.757208824, 0.753186822, 0.749136388, 0.745057762,
+	0.740951121, 0.736816585, 0.732654274, 0.728464365, 0.724247098, 0.720002532,
+	0.715730846, 0.711432219, 0.707106769, 0.702754736, 0.698376238, 0.693971455,
+	0.689540565, 0.685083687, 0.680601001, 0.676092684, 0.671558976, 0.666999936,
+	0.662415802, 0.657806695, 0.653172851, 0.64851439, 0.643831551, 0.639124453,
+	0.634393275, 0.629638255, 0.624859512, 0.620057225, 0.615231574, 0.610382795,
+	0.605511069, 0.600616455, 0.59569931, 0.590759695, 0.585797846, 0.580813944,
+	0.575808167, 0.570780754, 0.565731823, 0.560661554, 0.555570245, 0.550457954,
+	0.545324981, 0.540171444, 0.534997642, 0.529803634, 0.524589658, 0.519356012,
+	0.514102757, 0.50883013, 0.50353837, 0.498227656, 0.492898196, 0.487550169,
+	0.482183784, 0.47679922, 0.471396744, 0.465976506, 0.460538715, 0.455083579,
+	0.449611336, 0.444122136, 0.438616246, 0.433093816, 0.427555084, 0.422000259,
+	0.416429549, 0.410843164, 0.405241311, 0.399624199, 0.393992037, 0.388345033,
+	0.382683426, 0.377007425, 0.371317208, 0.365612984, 0.359895051, 0.354163527,
+	0.348418683, 0.342660725, 0.336889863, 0.331106305, 0.32531029, 0.319502026,
+	0.313681751, 0.307849646, 0.302005947, 0.296150893, 0.290284663, 0.284407526,
+	0.27851969, 0.272621363, 0.266712755, 0.260794103, 0.254865646, 0.248927608,
+	0.242980182, 0.237023607, 0.231058106, 0.225083917, 0.219101235, 0.213110313,
+	0.207111374, 0.201104641, 0.195090324, 0.18906866, 0.183039889, 0.177004218,
+	0.170961887, 0.164913118, 0.15885815, 0.152797192, 0.146730468, 0.140658244,
+	0.134580702, 0.128498107, 0.122410677, 0.116318628, 0.110222206, 0.104121633,
+	0.0980171412, 0.0919089541, 0.0857973099, 0.0796824396, 0.0735645667, 0.0674439222,
+	0.061320737, 0.0551952459, 0.0490676761, 0.0429382585, 0.0368072242, 0.030674804,
+	0.024541229, 0.0184067301, 0.0122715384, 0.00613588467, 6.12323426e-17, -0.00613588467,
+	-0.0122715384, -0.0184067301, -0.024541229, -0.030674804, -0.0368072242, -0.0429382585,
+	-0.0490676761, -0.0551952459, -0.061320737, -0.0674439222, -0.0735645667, -0.0796824396,
+	-0.0857973099, -0.0919089541, -0.0980171412, -0.104121633, -0.110222206, -0.116318628,
+	-0.122410677, -0.128498107, -0.134580702, -0.140658244, -0.146730468, -0.152797192,
+	-0.15885815, -0.164913118, -0.170961887, -0.177004218, -0.183039889, -0.18906866,
+	-0.195090324, -0.201104641, -0.207111374, -0.213110313, -0.219101235, -0.225083917,
+	-0.231058106, -0.237023607, -0.242980182, -0.248927608, -0.254865646, -0.260794103,
+	-0.266712755, -0.272621363, -0.27851969, -0.284407526, -0.290284663, -0.296150893,
+	-0.302005947, -0.307849646, -0.313681751, -0.319502026, -0.32531029, -0.331106305,
+	-0.336889863, -0.342660725, -0.348418683, -0.354163527, -0.359895051, -0.365612984,
+	-0.371317208, -0.377007425, -0.382683426, -0.388345033, -0.393992037, -0.399624199,
+	-0.405241311, -0.410843164, -0.416429549, -0.422000259, -0.427555084, -0.433093816,
+	-0.438616246, -0.444122136, -0.449611336, -0.455083579, -0.460538715, -0.465976506,
+	-0.471396744, -0.47679922, -0.482183784, -0.487550169, -0.492898196, -0.498227656,
+	-0.50353837, -0.50883013, -0.514102757, -0.519356012, -0.524589658, -0.529803634,
+	-0.534997642, -0.540171444, -0.545324981, -0.550457954, -0.555570245, -0.560661554,
+	-0.565731823, -0.570780754, -0.575808167, -0.580813944, -0.585797846, -0.590759695,
+	-0.59569931, -0.600616455, -0.605511069, -0.610382795, -0.615231574, -0.620057225,
+	-0.624859512, -0.629638255, -0.634393275, -0.639124453, -0.643831551, -0.64851439,
+	-0.653172851, -0.657806695, -0.662415802, -0.666999936, -0.671558976, -0.676092684,
+	-0.680601001, -0.685083687, -0.689540565, -0.693971455, -0.698376238, -0.702754736,
+	-0.707106769, -0.711432219, -0.715730846, -0.720002532, -0.724247098, -0.728464365,
+	-0.732654274, -0.736816585, -0.740951121, -0.745057762, -0.749136388, -0.753186822,
+	-0.757208824, -0.761202395, -0.765167236, -0.769103348, -0.773010433, -0.77688849,
+	-0.780737221, -0.784556568, -0.78834641, -0.792106569, -0.795836926, -0.799537241,
+	-0.803207517, -0.806847572, -0.81045717, -0.81403631, -0.817584813, -0.8211025,
+	-0.824589312, -0.82804507, -0.831469595, -0.834862888, -0.838224709, -0.841554999,
+	-0.84485358, -0.848120332, -0.851355195, -0.854557991, -0.857728601, -0.860866964,
+	-0.863972843, -0.867046237, -0.870086968, -0.873094976, -0.876070082, -0.879012227,
+	-0.881921291, -0.884797096, -0.887639642, -0.890448749, -0.893224299, -0.895966232,
+	-0.898674488, -0.901348829, -0.903989315, -0.906595707, -0.909168005, -0.91170603,
+	-0.914209783, -0.916679084, -0.919113874, -0.921514034, -0.923879504, -0.926210225,
+	-0.928506076, -0.93076694, -0.932992816, -0.935183525, -0.937339008, -0.939459205,
+	-0.941544056, -0.943593442, -0.945607305, -0.947585583, -0.949528158, -0.95143503,
+	-0.953306019, -0.955141187, -0.956940353, -0.958703458, -0.960430503, -0.962121427,
+	-0.963776052, -0.965394437, -0.966976464, -0.968522072, -0.970031261, -0.971503913,
+	-0.972939968, -0.974339366, -0.975702107, -0.977028131, -0.97831738, -0.979569793,
+	-0.980785251, -0.981963873, -0.983105481, -0.984210074, -0.985277653, -0.986308098,
+	-0.987301409, -0.988257587, -0.989176512, -0.990058184, -0.990902662, -0.991709769,
+	-0.992479563, -0.993211925, -0.993906975, -0.994564593, -0.99518472, -0.995767415,
+	-0.996312618, -0.996820271, -0.997290432, -0.997723043, -0.998118103, -0.998475552,
+	-0.99879545, -0.999077737, -0.999322355, -0.999529421, -0.999698818, -0.999830604,
+	-0.999924719, -0.999981165, -1, -0.999981165, -0.999924719, -0.999830604,
+	-0.999698818, -0.999529421, -0.999322355, -0.999077737, -0.99879545, -0.998475552,
+	-0.998118103, -0.997723043, -0.997290432, -0.996820271, -0.996312618, -0.995767415,
+	-0.99518472, -0.994564593, -0.993906975, -0.993211925, -0.992479563, -0.991709769,
+	-0.990902662, -0.990058184, -0.989176512, -0.988257587, -0.987301409, -0.986308098,
+	-0.985277653, -0.984210074, -0.983105481, -0.981963873, -0.980785251, -0.979569793,
+	-0.97831738, -0.977028131, -0.975702107, -0.974339366, -0.972939968, -0.971503913,
+	-0.970031261, -0.968522072, -0.966976464, -0.965394437, -0.963776052, -0.962121427,
+	-0.960430503, -0.958703458, -0.956940353, -0.955141187, -0.953306019, -0.95143503,
+	-0.949528158, -0.947585583, -0.945607305, -0.943593442, -0.941544056, -0.939459205,
+	-0.937339008, -0.935183525, -0.932992816, -0.93076694, -0.928506076, -0.926210225,
+	-0.923879504, -0.921514034, -0.919113874, -0.916679084, -0.914209783, -0.91170603,
+	-0.909168005, -0.906595707, -0.903989315, -0.901348829, -0.898674488, -0.895966232,
+	-0.893224299, -0.890448749, -0.887639642, -0.884797096, -0.881921291, -0.879012227,
+	-0.876070082, -0.873094976, -0.870086968, -0.867046237, -0.863972843, -0.860866964,
+	-0.857728601, -0.854557991, -0.851355195, -0.848120332, -0.84485358, -0.841554999,
+	-0.838224709, -0.834862888, -0.831469595, -0.82804507, -0.824589312, -0.8211025,
+	-0.817584813, -0.81403631, -0.81045717, -0.806847572, -0.803207517, -0.799537241,
+	-0.795836926, -0.792106569, -0.78834641, -0.784556568, -0.780737221, -0.77688849,
+	-0.773010433, -0.769103348, -0.765167236, -0.761202395, -0.757208824, -0.753186822,
+	-0.749136388, -0.745057762, -0.740951121, -0.736816585, -0.732654274, -0.728464365,
+	-0.724247098, -0.720002532, -0.715730846, -0.711432219, -0.707106769, -0.702754736,
+	-0.698376238, -0.693971455, -0.689540565, -0.685083687, -0.680601001, -0.676092684,
+	-0.671558976, -0.666999936, -0.662415802, -0.657806695, -0.653172851, -0.64851439,
+	-0.643831551, -0.639124453, -0.634393275, -0.629638255, -0.624859512, -0.620057225,
+	-0.615231574, -0.610382795, -0.605511069, -0.600616455, -0.59569931, -0.590759695,
+	-0.585797846, -0.580813944, -0.575808167, -0.570780754, -0.565731823, -0.560661554,
+	-0.555570245, -0.550457954, -0.545324981, -0.540171444, -0.534997642, -0.529803634,
+	-0.524589658, -0.519356012, -0.514102757, -0.50883013, -0.50353837, -0.498227656,
+	-0.492898196, -0.487550169, -0.482183784, -0.47679922, -0.471396744, -0.465976506,
+	-0.460538715, -0.455083579, -0.449611336, -0.444122136, -0.438616246, -0.433093816,
+	-0.427555084, -0.422000259, -0.416429549, -0.410843164, -0.405241311, -0.399624199,
+	-0.393992037, -0.388345033, -0.382683426, -0.377007425, -0.371317208, -0.365612984,
+	-0.359895051, -0.354163527, -0.348418683, -0.342660725, -0.336889863, -0.331106305,
+	-0.32531029, -0.319502026, -0.313681751, -0.307849646, -0.302005947, -0.296150893,
+	-0.290284663, -0.284407526, -0.27851969, -0.272621363, -0.266712755, -0.260794103,
+	-0.254865646, -0.248927608, -0.242980182, -0.237023607, -0.231058106, -0.225083917,
+	-0.219101235, -0.213110313, -0.207111374, -0.201104641, -0.195090324, -0.18906866,
+	-0.183039889, -0.177004218, -0.170961887, -0.164913118, -0.15885815, -0.152797192,
+	-0.146730468, -0.140658244, -0.134580702, -0.128498107, -0.122410677, -0.116318628,
+	-0.110222206, -0.104121633, -0.0980171412, -0.0919089541, -0.0857973099, -0.0796824396,
+	-0.0735645667, -0.0674439222, -0.061320737, -0.0551952459, -0.0490676761, -0.0429382585,
+	-0.0368072242, -0.030674804, -0.024541229, -0.0184067301, -0.0122715384, -0.00613588467,
+	-1.83697015e-16, 0.00613588467, 0.0122715384, 0.0184067301, 0.024541229, 0.030674804,
+	0.0368072242, 0.0429382585, 0.0490676761, 0.0551952459, 0.061320737, 0.0674439222,
+	0.0735645667, 0.0796824396, 0.0857973099, 0.0919089541, 0.0980171412, 0.104121633,
+	0.110222206, 0.116318628, 0.122410677, 0.128498107, 0.134580702, 0.140658244,
+	0.146730468, 0.152797192, 0.15885815, 0.164913118, 0.170961887, 0.177004218,
+	0.183039889, 0.18906866, 0.195090324, 0.201104641, 0.207111374, 0.213110313,
+	0.219101235, 0.225083917, 0.231058106, 0.237023607, 0.242980182, 0.248927608,
+	0.254865646, 0.260794103, 0.266712755, 0.272621363, 0.27851969, 0.284407526,
+	0.290284663, 0.296150893, 0.302005947, 0.307849646, 0.313681751, 0.319502026,
+	0.32531029, 0.331106305, 0.336889863, 0.342660725, 0.348418683, 0.354163527,
+	0.359895051, 0.365612984, 0.371317208, 0.377007425, 0.382683426, 0.388345033,
+	0.393992037, 0.399624199, 0.405241311, 0.410843164, 0.416429549, 0.422000259,
+	0.427555084, 0.433093816, 0.438616246, 0.444122136, 0.449611336, 0.455083579,
+	0.460538715, 0.465976506, 0.471396744, 0.47679922, 0.482183784, 0.487550169,
+	0.492898196, 0.498227656, 0.50353837, 0.50883013, 0.514102757, 0.519356012,
+	0.524589658, 0.529803634, 0.534997642, 0.540171444, 0.545324981, 0.550457954,
+	0.555570245, 0.560661554, 0.565731823, 0.570780754, 0.575808167, 0.580813944,
+	0.585797846, 0.590759695, 0.59569931, 0.600616455, 0.605511069, 0.610382795,
+	0.615231574, 0.620057225, 0.624859512, 0.629638255, 0.634393275, 0.639124453,
+	0.643831551, 0.64851439, 0.653172851, 0.657806695, 0.662415802, 0.666999936,
+	0.671558976, 0.676092684, 0.680601001, 0.685083687, 0.689540565, 0.693971455,
+	0.698376238, 0.702754736, 0.707106769, 0.711432219, 0.715730846, 0.720002532,
+	0.724247098, 0.728464365, 0.732654274, 0.736816585, 0.740951121, 0.745057762,
+	0.749136388, 0.753186822, 0.757208824, 0.761202395, 0.765167236, 0.769103348,
+	0.773010433, 0.77688849, 0.780737221, 0.784556568, 0.78834641, 0.792106569,
+	0.795836926, 0.799537241, 0.803207517, 0.806847572, 0.81045717, 0.81403631,
+	0.817584813, 0.8211025, 0.824589312, 0.82804507, 0.831469595, 0.834862888,
+	0.838224709, 0.841554999, 0.84485358, 0.848120332, 0.851355195, 0.854557991,
+	0.857728601, 0.860866964, 0.863972843, 0.867046237, 0.870086968, 0.873094976,
+	0.876070082, 0.879012227, 0.881921291, 0.884797096, 0.887639642, 0.890448749,
+	0.893224299, 0.895966232, 0.898674488, 0.901348829, 0.903989315, 0.906595707,
+	0.909168005, 0.91170603, 0.914209783, 0.916679084, 0.919113874, 0.921514034,
+	0.923879504, 0.926210225, 0.928506076, 0.93076694, 0.932992816, 0.935183525,
+	0.937339008, 0.939459205, 0.941544056, 0.943593442, 0.945607305, 0.947585583,
+	0.949528158, 0.95143503, 0.953306019, 0.955141187, 0.956940353, 0.958703458,
+	0.960430503, 0.962121427, 0.963776052, 0.965394437, 0.966976464, 0.968522072,
+	0.970031261, 0.971503913, 0.972939968, 0.974339366, 0.975702107, 0.977028131,
+	0.97831738, 0.979569793, 0.980785251, 0.981963873, 0.983105481, 0.984210074,
+	0.985277653, 0.986308098, 0.987301409, 0.988257587, 0.989176512, 0.990058184,
+	0.990902662, 0.991709769, 0.992479563, 0.993211925, 0.993906975, 0.994564593,
+	0.99518472, 0.995767415, 0.996312618, 0.996820271, 0.997290432, 0.997723043,
+	0.998118103, 0.998475552, 0.99879545, 0.999077737, 0.999322355, 0.999529421,
+	0.999698818, 0.999830604, 0.999924719, 0.999981165, 1
+};
+
+static const float sinTable[1025] = {
+	0, 0.00613588467, 0.0122715384, 0.0184067301, 0.024541229, 0.030674804,
+	0.0368072242, 0.0429382585, 0.0490676761, 0.0551952459, 0.061320737, 0.0674439222,
+	0.0735645667, 0.0796824396, 0.0857973099, 0.0919089541, 0.0980171412, 0.104121633,
+	0.110222206, 0.116318628, 0.122410677, 0.128498107, 0.134580702, 0.140658244,
+	0.146730468, 0.152797192, 0.15885815, 0.164913118, 0.170961887, 0.177004218,
+	0.183039889, 0.18906866, 0.195090324, 0.201104641, 0.207111374, 0.213110313,
+	0.219101235, 0.225083917, 0.231058106, 0.237023607, 0.242980182, 0.248927608,
+	0.254865646, 0.260794103, 0.266712755, 0.272621363, 0.27851969, 0.284407526,
+	0.290284663, 0.296150893, 0.302005947, 0.307849646, 0.313681751, 0.319502026,
+	0.32531029, 0.331106305, 0.336889863, 0.342660725, 0.348418683, 0.354163527,
+	0.359895051, 0.365612984, 0.371317208, 0.377007425, 0.382683426, 0.388345033,
+	0.393992037, 0.399624199, 0.405241311, 0.410843164, 0.416429549, 0.422000259,
+	0.427555084, 0.433093816, 0.438616246, 0.444122136, 0.449611336, 0.455083579,
+	0.460538715, 0.465976506, 0.471396744, 0.47679922, 0.482183784, 0.487550169,
+	0.492898196, 0.498227656, 0.50353837, 0.50883013, 0.514102757, 0.519356012,
+	0.524589658, 0.529803634, 0.534997642, 0.540171444, 0.545324981, 0.550457954,
+	0.555570245, 0.560661554, 0.565731823, 0.570780754, 0.575808167, 0.580813944,
+	0.585797846, 0.590759695, 0.59569931, 0.600616455, 0.605511069, 0.610382795,
+	0.615231574, 0.620057225, 0.624859512, 0.629638255, 0.634393275, 0.639124453,
+	0.643831551, 0.64851439, 0.653172851, 0.657806695, 0.662415802, 0.666999936,
+	0.671558976, 0.676092684, 0.680601001, 0.685083687, 0.689540565, 0.693971455,
+	0.698376238, 0.702754736, 0.707106769, 0.711432219, 0.715730846, 0.720002532,
+	0.724247098, 0.728464365, 0.732654274, 0.736816585, 0.740951121, 0.745057762,
+	0.749136388, 0.753186822, 0.757208824, 0.761202395, 0.765167236, 0.769103348,
+	0.773010433, 0.77688849, 0.780737221, 0.784556568, 0.78834641, 0.792106569,
+	0.795836926, 0.799537241, 0.803207517, 0.806847572, 0.81045717, 0.81403631,
+	0.817584813, 0.8211025, 0.824589312, 0.82804507, 0.831469595, 0.834862888,
+	0.838224709, 0.841554999, 0.84485358, 0.848120332, 0.851355195, 0.854557991,
+	0.857728601, 0.860866964, 0.863972843, 0.867046237, 0.870086968, 0.873094976,
+	0.876070082, 0.879012227, 0.881921291, 0.884797096, 0.887639642, 0.890448749,
+	0.893224299, 0.895966232, 0.898674488, 0.901348829, 0.903989315, 0.906595707,
+	0.909168005, 0.91170603, 0.914209783, 0.916679084, 0.919113874, 0.921514034,
+	0.923879504, 0.926210225, 0.928506076, 0.93076694, 0.932992816, 0.935183525,
+	0.937339008, 0.939459205, 0.941544056, 0.943593442, 0.945607305, 0.947585583,
+	0.949528158, 0.95143503, 0.953306019, 0.955141187, 0.956940353, 0.958703458,
+	0.960430503, 0.962121427, 0.963776052, 0.965394437, 0.966976464, 0.968522072,
+	0.970031261, 0.971503913, 0.972939968, 0.974339366, 0.975702107, 0.977028131,
+	0.97831738, 0.979569793, 0.980785251, 0.981963873, 0.983105481, 0.984210074,
+	0.985277653, 0.986308098, 0.987301409, 0.988257587, 0.989176512, 0.990058184,
+	0.990902662, 0.991709769, 0.992479563, 0.993211925, 0.993906975, 0.994564593,
+	0.99518472, 0.995767415, 0.996312618, 0.996820271, 0.997290432, 0.997723043,
+	0.998118103, 0.998475552, 0.99879545, 0.999077737, 0.999322355, 0.999529421,
+	0.999698818, 0.999830604, 0.999924719, 0.999981165, 1, 0.999981165,
+	0.999924719, 0.999830604, 0.999698818, 0.999529421, 0.999322355, 0.999077737,
+	0.99879545, 0.998475552, 0.998118103, 0.997723043, 0.997290432, 0.996820271,
+	0.996312618, 0.995767415, 0.99518472, 0.994564593, 0.993906975, 0.993211925,
+	0.992479563, 0.991709769, 0.990902662, 0.990058184, 0.989176512, 0.988257587,
+	0.987301409, 0.986308098, 0.985277653, 0.984210074, 0.983105481, 0.981963873,
+	0.980785251, 0.979569793, 0.97831738, 0.977028131, 0.975702107, 0.974339366,
+	0.972939968, 0.971503913, 0.970031261, 0.968522072, 0.966976464, 0.965394437,
+	0.963776052, 0.962121427, 0.960430503, 0.958703458, 0.956940353, 0.955141187,
+	0.953306019, 0.95143503, 0.949528158, 0.947585583, 0.945607305, 0.943593442,
+	0.941544056, 0.939459205, 0.937339008, 0.935183525, 0.932992816, 0.93076694,
+	0.928506076, 0.926210225, 0.923879504, 0.921514034, 0.919113874, 0.916679084,
+	0.914209783, 0.91170603, 0.909168005, 0.906595707, 0.903989315, 0.901348829,
+	0.898674488, 0.895966232, 0.893224299, 0.890448749, 0.887639642, 0.884797096,
+	0.881921291, 0.879012227, 0.876070082, 0.873094976, 0.870086968, 0.867046237,
+	0.863972843, 0.860866964, 0.857728601, 0.854557991, 0.851355195, 0.848120332,
+	0.84485358, 0.841554999, 0.838224709, 0.834862888, 0.831469595, 0.82804507,
+	0.824589312, 0.8211025, 0.817584813, 0.81403631, 0.81045717, 0.806847572,
+	0.803207517, 0.799537241, 0.795836926, 0.792106569, 0.78834641, 0.784556568,
+	0.780737221, 0.77688849, 0.773010433, 0.769103348, 0.765167236, 0.761202395,
+	0.757208824, 0.753186822, 0.749136388, 0.745057762, 0.740951121, 0.736816585,
+	0.732654274, 0.728464365, 0.724247098, 0.720002532, 0.715730846, 0.711432219,
+	0.707106769, 0.702754736, 0.698376238, 0.693971455, 0.689540565, 0.685083687,
+	0.680601001, 0.676092684, 0.671558976, 0.666999936, 0.662415802, 0.657806695,
+	0.653172851, 0.64851439, 0.643831551, 0.639124453, 0.634393275, 0.629638255,
+	0.624859512, 0.620057225, 0.615231574, 0.610382795, 0.605511069, 0.600616455,
+	0.59569931, 0.590759695, 0.585797846, 0.580813944, 0.575808167, 0.570780754,
+	0.565731823, 0.560661554, 0.555570245, 0.550457954, 0.545324981, 0.540171444,
+	0.534997642, 0.529803634, 0.524589658, 0.519356012, 0.514102757, 0.50883013,
+	0.50353837, 0.498227656, 0.492898196, 0.487550169, 0.482183784, 0.47679922,
+	0.471396744, 0.465976506, 0.460538715, 0.455083579, 0.449611336, 0.444122136,
+	0.438616246, 0.433093816, 0.427555084, 0.422000259, 0.416429549, 0.410843164,
+	0.405241311, 0.399624199, 0.393992037, 0.388345033, 0.382683426, 0.377007425,
+	0.371317208, 0.365612984, 0.359895051, 0.354163527, 0.348418683, 0.342660725,
+	0.336889863, 0.331106305, 0.32531029, 0.319502026, 0.313681751, 0.307849646,
+	0.302005947, 0.296150893, 0.290284663, 0.284407526, 0.27851969, 0.272621363,
+	0.266712755, 0.260794103, 0.254865646, 0.248927608, 0.242980182, 0.237023607,
+	0.231058106, 0.225083917, 0.219101235, 0.213110313, 0.207111374, 0.201104641,
+	0.195090324, 0.18906866, 0.183039889, 0.177004218, 0.170961887, 0.164913118,
+	0.15885815, 0.152797192, 0.146730468, 0.140658244, 0.134580702, 0.128498107,
+	0.122410677, 0.116318628, 0.110222206, 0.104121633, 0.0980171412, 0.0919089541,
+	0.0857973099, 0.0796824396, 0.0735645667, 0.0674439222, 0.061320737, 0.0551952459,
+	0.0490676761, 0.0429382585, 0.0368072242, 0.030674804, 0.024541229, 0.0184067301,
+	0.0122715384, 0.00613588467, 1.22464685e-16, -0.00613588467, -0.0122715384, -0.0184067301,
+	-0.024541229, -0.030674804, -0.0368072242, -0.0429382585, -0.0490676761, -0.0551952459,
+	-0.061320737, -0.0674439222, -0.0735645667, -0.0796824396, -0.0857973099, -0.0919089541,
+	-0.0980171412, -0.104121633, -0.110222206, -0.116318628, -0.122410677, -0.128498107,
+	-0.134580702, -0.140658244, -0.146730468, -0.152797192, -0.15885815, -0.164913118,
+	-0.170961887, -0.177004218, -0.183039889, -0.18906866, -0.195090324, -0.201104641,
+	-0.207111374, -0.213110313, -0.219101235, -0.225083917, -0.231058106, -0.237023607,
+	-0.242980182, -0.248927608, -0.254865646, -0.260794103, -0.266712755, -0.272621363,
+	-0.27851969, -0.284407526, -0.290284663, -0.296150893, -0.302005947, -0.307849646,
+	-0.313681751, -0.319502026, -0.32531029, -0.331106305, -0.336889863, -0.342660725,
+	-0.348418683, -0.354163527, -0.359895051, -0.365612984, -0.371317208, -0.377007425,
+	-0.382683426, -0.388345033, -0.393992037, -0.399624199, -0.405241311, -0.410843164,
+	-0.416429549, -0.422000259, -0.427555084, -0.433093816, -0.438616246, -0.444122136,
+	-0.449611336, -0.455083579, -0.460538715, -0.465976506, -0.471396744, -0.47679922,
+	-0.482183784, -0.487550169, -0.492898196, -0.498227656, -0.50353837, -0.50883013,
+	-0.514102757, -0.519356012, -0.524589658, -0.529803634, -0.534997642, -0.540171444,
+	-0.545324981, -0.550457954, -0.555570245, -0.560661554, -0.565731823, -0.570780754,
+	-0.575808167, -0.580813944, -0.585797846, -0.590759695, -0.59569931, -0.600616455,
+	-0.605511069, -0.610382795, -0.615231574, -0.620057225, -0.624859512, -0.629638255,
+	-0.634393275, -0.639124453, -0.643831551, -0.64851439, -0.653172851, -0.657806695,
+	-0.662415802, -0.666999936, -0.671558976, -0.676092684, -0.680601001, -0.685083687,
+	-0.689540565, -0.693971455, -0.698376238, -0.702754736, -0.707106769, -0.711432219,
+	-0.715730846, -0.720002532, -0.724247098, -0.728464365, -0.732654274, -0.736816585,
+	-0.740951121, -0.745057762, -0.749136388, -0.753186822, -0.757208824, -0.761202395,
+	-0.765167236, -0.769103348, -0.773010433, -0.77688849, -0.780737221, -0.784556568,
+	-0.78834641, -0.792106569, -0.795836926, -0.799537241, -0.803207517, -0.806847572,
+	-0.81045717, -0.81403631, -0.817584813, -0.8211025, -0.824589312, -0.82804507,
+	-0.831469595, -0.834862888, -0.838224709, -0.841554999, -0.84485358, -0.848120332,
+	-0.851355195, -0.854557991, -0.857728601, -0.860866964, -0.863972843, -0.867046237,
+	-0.870086968, -0.873094976, -0.876070082, -0.879012227, -0.881921291, -0.884797096,
+	-0.887639642, -0.890448749, -0.893224299, -0.895966232, -0.898674488, -0.901348829,
+	-0.903989315, -0.906595707, -0.909168005, -0.91170603, -0.914209783, -0.916679084,
+	-0.919113874, -0.921514034, -0.923879504, -0.926210225, -0.928506076, -0.93076694,
+	-0.932992816, -0.935183525, -0.937339008, -0.939459205, -0.941544056, -0.943593442,
+	-0.945607305, -0.947585583, -0.949528158, -0.95143503, -0.953306019, -0.955141187,
+	-0.956940353, -0.958703458, -0.960430503, -0.962121427, -0.963776052, -0.965394437,
+	-0.966976464, -0.968522072, -0.970031261, -0.971503913, -0.972939968, -0.974339366,
+	-0.975702107, -0.977028131, -0.97831738, -0.979569793, -0.980785251, -0.981963873,
+	-0.983105481, -0.984210074, -0.985277653, -0.986308098, -0.987301409, -0.988257587,
+	-0.989176512, -0.990058184, -0.990902662, -0.991709769, -0.992479563, -0.993211925,
+	-0.993906975, -0.994564593, -0.99518472, -0.995767415, -0.996312618, -0.996820271,
+	-0.997290432, -0.997723043, -0.998118103, -0.998475552, -0.99879545, -0.999077737,
+	-0.999322355, -0.999529421, -0.999698818, -0.999830604, -0.999924719, -0.999981165,
+	-1, -0.999981165, -0.999924719, -0.999830604, -0.999698818, -0.999529421,
+	-0.999322355, -0.999077737, -0.99879545, -0.998475552, -0.998118103, -0.997723043,
+	-0.997290432, -0.996820271, -0.996312618, -0.995767415, -0.99518472, -0.994564593,
+	-0.993906975, -0.993211925, -0.992479563, -0.991709769, -0.990902662, -0.990058184,
+	-0.989176512, -0.988257587, -0.987301409, -0.986308098, -0.985277653, -0.984210074,
+	-0.983105481, -0.981963873, -0.980785251, -0.979569793, -0.97831738, -0.977028131,
+	-0.975702107, -0.974339366, -0.972939968, -0.971503913, -0.970031261, -0.968522072,
+	-0.966976464, -0.965394437, -0.963776052, -0.962121427, -0.960430503, -0.958703458,
+	-0.956940353, -0.955141187, -0.953306019, -0.95143503, -0.949528158, -0.947585583,
+	-0.945607305, -0.943593442, -0.941544056, -0.939459205, -0.937339008, -0.935183525,
+	-0.932992816, -0.93076694, -0.928506076, -0.926210225, -0.923879504, -0.921514034,
+	-0.919113874, -0.916679084, -0.914209783, -0.91170603, -0.909168005, -0.906595707,
+	-0.903989315, -0.901348829, -0.898674488, -0.895966232, -0.893224299, -0.890448749,
+	-0.887639642, -0.884797096, -0.881921291, -0.879012227, -0.876070082, -0.873094976,
+	-0.870086968, -0.867046237, -0.863972843, -0.860866964, -0.857728601, -0.854557991,
+	-0.851355195, -0.848120332, -0.84485358, -0.841554999, -0.838224709, -0.834862888,
+	-0.831469595, -0.82804507, -0.824589312, -0.8211025, -0.817584813, -0.81403631,
+	-0.81045717, -0.806847572, -0.803207517, -0.799537241, -0.795836926, -0.792106569,
+	-0.78834641, -0.784556568, -0.780737221, -0.77688849, -0.773010433, -0.769103348,
+	-0.765167236, -0.761202395, -0.757208824, -0.753186822, -0.749136388, -0.745057762,
+	-0.740951121, -0.736816585, -0.732654274, -0.728464365, -0.724247098, -0.720002532,
+	-0.715730846, -0.711432219, -0.707106769, -0.702754736, -0.698376238, -0.693971455,
+	-0.689540565, -0.685083687, -0.680601001, -0.676092684, -0.671558976, -0.666999936,
+	-0.662415802, -0.657806695, -0.653172851, -0.64851439, -0.643831551, -0.639124453,
+	-0.634393275, -0.629638255, -0.624859512, -0.620057225, -0.615231574, -0.610382795,
+	-0.605511069, -0.600616455, -0.59569931, -0.590759695, -0.585797846, -0.580813944,
+	-0.575808167, -0.570780754, -0.565731823, -0.560661554, -0.555570245, -0.550457954,
+	-0.545324981, -0.540171444, -0.534997642, -0.529803634, -0.524589658, -0.519356012,
+	-0.514102757, -0.50883013, -0.50353837, -0.498227656, -0.492898196, -0.487550169,
+	-0.482183784, -0.47679922, -0.471396744, -0.465976506, -0.460538715, -0.455083579,
+	-0.449611336, -0.444122136, -0.438616246, -0.433093816, -0.427555084, -0.422000259,
+	-0.416429549, -0.410843164, -0.405241311, -0.399624199, -0.393992037, -0.388345033,
+	-0.382683426, -0.377007425, -0.371317208, -0.365612984, -0.359895051, -0.354163527,
+	-0.348418683, -0.342660725, -0.336889863, -0.331106305, -0.32531029, -0.319502026,
+	-0.313681751, -0.307849646, -0.302005947, -0.296150893, -0.290284663, -0.284407526,
+	-0.27851969, -0.272621363, -0.266712755, -0.260794103, -0.254865646, -0.248927608,
+	-0.242980182, -0.237023607, -0.231058106, -0.225083917, -0.219101235, -0.213110313,
+	-0.207111374, -0.201104641, -0.195090324, -0.18906866, -0.183039889, -0.177004218,
+	-0.170961887, -0.164913118, -0.15885815, -0.152797192, -0.146730468, -0.140658244,
+	-0.134580702, -0.128498107, -0.122410677, -0.116318628, -0.110222206, -0.104121633,
+	-0.0980171412, -0.0919089541, -0.0857973099, -0.0796824396, -0.0735645667, -0.0674439222,
+	-0.061320737, -0.0551952459, -0.0490676761, -0.0429382585, -0.0368072242, -0.030674804,
+	-0.024541229, -0.0184067301, -0.0122715384, -0.00613588467, -2.44929371e-16
+};
+
+/* Farrow interpolator fit and its largest tap error */
+static const double farrowError = 8.5654205669027927e-06;
+
+static const float farrowCoeffs[147] = {
+	0.0303152278, -0.033506304, 0.0374482237, -0.0424413197, 0.0489707515, -0.0578745231,
+	0.0707355291, -0.0909456834, 0.127323955, -0.212206587, 0.636619747, 0.636619747,
+	-0.212206587, 0.127323955, -0.0909456834, 0.0707355291, -0.0578745231, 0.0489707515,
+	-0.0424413197, 0.0374482237, -0.033506304, -0.00144061132, 0.00175988115, -0.00219836459,
+	0.00282374211, -0.0037595476, 0.0052512181, -0.00784511957, 0.0129706552, -0.0254315902,
+	0.0706875026, -0.63656044, 0.63656044, -0.0706875026, 0.0254315902, -0.0129706552,
+	0.00784511957, -0.0052512181, 0.0037595476, -0.00282374211, 0.00219836459, -0.00175988115,
+	-0.0373284072, 0.0412409082, -0.0460669883, 0.0521675609, -0.0601213537, 0.070916906,
+	-0.0863880068, 0.110338069, -0.151981115, 0.238216549, -0.148776725, -0.148776725,
+	0.238216549, -0.151981115, 0.110338069, -0.0863880068, 0.070916906, -0.0601213537,
+	0.0521675609, -0.0460669883, 0.0412409082, 0.00175377575, -0.00214170641, 0.0026740476,
+	-0.00343240378, 0.00456525246, -0.00636617281, 0.00948360004, -0.0155899003, 0.0301306173,
+	-0.0790213048, 0.148301989, -0.148301989, 0.0790213048, -0.0301306173, 0.0155899003,
+	-0.00948360004, 0.00636617281, -0.00456525246, 0.00343240378, -0.0026740476, 0.00214170641,
+	0.0075832135, -0.00836102944, 0.00931336544, -0.0105045903, 0.0120335389, -0.014057735,
+	0.0168352965, -0.0207730513, 0.0261741281, -0.0273266528, 0.0126992678, 0.0126992678,
+	-0.0273266528, 0.0261741281, -0.0207730513, 0.0168352965, -0.014057735, 0.0120335389,
+	-0.0105045903, 0.00931336544, -0.00836102944, -0.000313570548, 0.00038231854, -0.000476294488,
+	0.000609438925, -0.00080672279, 0.00111633935, -0.00164045475, 0.00262221671, -0.00470361393,
+	0.00834046025, -0.0117498059, 0.0117498059, -0.00834046025, 0.00470361393, -0.00262221671,
+	0.00164045475, -0.00111633935, 0.00080672279, -0.000609438925, 0.000476294488, -0.00038231854,
+	-0.000570418313, 0.000626844063, -0.000695062394, 0.000778861111, -0.00088351022, 0.00101600145,
+	-0.00118354452, 0.00138144835, -0.00151774834, 0.00131729851, -0.000542549242, -0.000542549242,
+	0.00131729851, -0.00151774834, 0.00138144835, -0.00118354452, 0.00101600145, -0.00088351022,
+	0.000778861111, -0.000695062394, 0.000626844063
+};
+
+#endif /* DSPTABLES_H */
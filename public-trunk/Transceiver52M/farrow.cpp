@@ -0,0 +1,174 @@
+/*
+ * Farrow fractional-delay interpolator
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+#include "farrow.h"
+
+/* Points per unit offset at which the fit is checked */
+#define FARROW_CHECK_POINTS	1024
+
+Farrow::Farrow(int len, int order)
+	: mLen(len), mOrder(order), mError(0.0)
+{
+	assert(len % 2);
+	assert((order >= 1) && (order <= FARROW_ORDER_MAX));
+
+	int n = order + 1;
+	mCoeffs = new float[n * len];
+
+	/* Monomial coefficients of the Chebyshev polynomials T_0 .. T_order */
+	double cheby[FARROW_ORDER_MAX + 1][FARROW_ORDER_MAX + 1] = { { 0.0 } };
+	cheby[0][0] = 1.0;
+	cheby[1][1] = 1.0;
+	for (int m = 2; m <= order; m++) {
+		for (int p = 0; p <= m; p++) {
+			double v = -cheby[m - 2][p];
+			if (p > 0)
+				v += 2.0 * cheby[m - 1][p - 1];
+			cheby[m][p] = v;
+		}
+	}
+
+	/*
+	 * Interpolate each tap at the Chebyshev nodes of t = 2 mu - 1, then
+	 * expand the Chebyshev series into powers of t for Horner evaluation
+	 */
+	for (int k = 0; k < len; k++) {
+		double series[FARROW_ORDER_MAX + 1];
+		for (int m = 0; m < n; m++) {
+			double sum = 0.0;
+			for (int i = 0; i < n; i++) {
+				double arg = M_PI * (i + 0.5) / n;
+				sum += tap(k, 0.5 * (cos(arg) + 1.0)) * cos(m * arg);
+			}
+			series[m] = (m ? 2.0 : 1.0) * sum / n;
+		}
+
+		for (int p = 0; p < n; p++) {
+			double v = 0.0;
+			for (int m = p; m < n; m++)
+				v += series[m] * cheby[m][p];
+			mCoeffs[p * len + k] = (float) v;
+		}
+	}
+
+	/* Measure the fit, with the coefficients as they will be used */
+	for (int i = 0; i <= FARROW_CHECK_POINTS; i++) {
+		double mu = (double) i / FARROW_CHECK_POINTS;
+		double t = 2.0 * mu - 1.0;
+		for (int k = 0; k < len; k++) {
+			double v = mCoeffs[order * len + k];
+			for (int p = order - 1; p >= 0; p--)
+				v = v * t + mCoeffs[p * len + k];
+			double err = fabs(v - tap(k, mu));
+			if (err > mError)
+				mError = err;
+		}
+	}
+}
+
+Farrow::Farrow(int len, int order, const float *coeffs, double error)
+	: mLen(len), mOrder(order), mError(error)
+{
+	assert(len % 2);
+	assert((order >= 1) && (order <= FARROW_ORDER_MAX));
+
+	int n = (order + 1) * len;
+	mCoeffs = new float[n];
+	memcpy(mCoeffs, coeffs, n * sizeof(float));
+}
+
+Farrow::~Farrow()
+{
+	delete[] mCoeffs;
+}
+
+double Farrow::tap(int k, double mu) const
+{
+	double x = M_PI * (k - mLen / 2 - mu);
+	if (fabs(x) < 1e-12)
+		return 1.0;
+	return sin(x) / x;
+}
+
+void Farrow::taps(float mu, float *h) const
+{
+	const float *c = mCoeffs;
+	int len = mLen;
+
+	/* Negative offsets take the taps of -mu in reverse */
+	if (mu >= 0.0f) {
+		float t = 2.0f * mu - 1.0f;
+		for (int k = 0; k < len; k++)
+			h[k] = c[mOrder * len + k];
+		for (int p = mOrder - 1; p >= 0; p--) {
+			for (int k = 0; k < len; k++)
+				h[k] = h[k] * t + c[p * len + k];
+		}
+	} else {
+		float t = -2.0f * mu - 1.0f;
+		for (int k = 0; k < len; k++)
+			h[len - 1 - k] = c[mOrder * len + k];
+		for (int p = mOrder - 1; p >= 0; p--) {
+			for (int k = 0; k < len; k++)
+				h[len - 1 - k] = h[len - 1 - k] * t + c[p * len + k];
+		}
+	}
+}
+
+void Farrow::branches(const float *x, int size, int base, bool real,
+		      float *c) const
+{
+	int len = mLen;
+	int first = base - len / 2;
+
+	/* Taps that fall inside the vector */
+	int start = first < 0 ? -first : 0;
+	int end = size - first < len ? size - first : len;
+
+	for (int p = 0; p <= mOrder; p++) {
+		const float *b = mCoeffs + p * len;
+		float re = 0.0f, im = 0.0f;
+		for (int k = start; k < end; k++) {
+			re += b[k] * x[2 * (first + k) + 0];
+			if (!real)
+				im += b[k] * x[2 * (first + k) + 1];
+		}
+		c[2 * p + 0] = re;
+		c[2 * p + 1] = im;
+	}
+}
+
+void Farrow::evaluate(const float *c, float mu, float *y) const
+{
+	float t = 2.0f * mu - 1.0f;
+	float re = c[2 * mOrder + 0];
+	float im = c[2 * mOrder + 1];
+
+	for (int p = mOrder - 1; p >= 0; p--) {
+		re = re * t + c[2 * p + 0];
+		im = im * t + c[2 * p + 1];
+	}
+
+	y[0] = re;
+	y[1] = im;
+}
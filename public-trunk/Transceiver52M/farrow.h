@@ -0,0 +1,90 @@
+/*
+ * Farrow fractional-delay interpolator
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef FARROW_H
+#define FARROW_H
+
+/*
+ * Farrow interpolator
+ *
+ * Tap j of a sinc interpolator over 'len' samples, j = -len/2 .. len/2,
+ * is sinc(pi (j - mu)) for a signal point mu samples past the base
+ * sample. Each tap is replaced by a polynomial of degree 'order' in mu,
+ * fitted at Chebyshev nodes on [0, 1], so no sinc is evaluated per
+ * burst. Offsets in [-1, 0) reuse the fit with the taps reversed,
+ * since sinc(pi (j - mu)) = sinc(pi (-j + mu)). The fit of the default
+ * size is precomputed in dspTables.h.
+ *
+ * The order sets the accuracy. Order 6 keeps the taps within 1e-5 of
+ * the exact sinc, about the error of the sine table lookups they
+ * replace; each order above gains close to a factor of ten, down to
+ * float precision at order 8.
+ *
+ * Vectors are interleaved complex floats, as in signalVector.
+ */
+#define FARROW_LEN		21
+#define FARROW_ORDER		6
+#define FARROW_ORDER_MAX	16
+
+class Farrow {
+public:
+	/** Interpolator over 'len' samples, len odd, of polynomial degree 'order' */
+	Farrow(int len = FARROW_LEN, int order = FARROW_ORDER);
+
+	/** Interpolator from a precomputed fit, as given by coeffs() and error() */
+	Farrow(int len, int order, const float *coeffs, double error);
+	~Farrow();
+
+	int len() const { return mLen; }
+	int order() const { return mOrder; }
+
+	/** Largest tap error against the exact sinc, measured when fitted */
+	double error() const { return mError; }
+
+	/** Polynomial coefficients of the fit, (order + 1) * len floats */
+	const float *coeffs() const { return mCoeffs; }
+
+	/** Taps for offset mu in [-1, 1]; tap k weighs sample base + k - len/2 */
+	void taps(float mu, float *h) const;
+
+	/**
+	 * Branch outputs at sample 'base' of x, 2 * (order + 1) floats, from
+	 * which evaluate() gives any point between base and base + 1. Samples
+	 * outside x count as zero; with 'real' set, imaginary parts are ignored.
+	 */
+	void branches(const float *x, int size, int base, bool real,
+		      float *c) const;
+
+	/** Signal at base + mu, mu in [0, 1], from the branch outputs */
+	void evaluate(const float *c, float mu, float *y) const;
+
+private:
+	int mLen;
+	int mOrder;
+	double mError;
+
+	/* Polynomial coefficients in t = 2 mu - 1, branch p of tap k
+	   at mCoeffs[p * len + k] */
+	float *mCoeffs;
+
+	double tap(int k, double mu) const;
+};
+
+#endif /* FARROW_H */
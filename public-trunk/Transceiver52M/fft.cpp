@@ -0,0 +1,115 @@
+/*
+ * Fast Fourier transform
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <math.h>
+#include <assert.h>
+
+#include "fft.h"
+
+FFT::FFT(int wLen)
+	: len(wLen)
+{
+	int bits = 0;
+
+	assert(len >= 2 && len <= (1 << FFT_MAX_LOG2));
+	assert(!(len & (len - 1)));
+
+	while ((1 << bits) < len)
+		bits++;
+
+	rev = new unsigned[len];
+	for (int i = 0; i < len; i++) {
+		unsigned r = 0;
+		for (int b = 0; b < bits; b++) {
+			if (i & (1 << b))
+				r |= 1 << (bits - 1 - b);
+		}
+		rev[i] = r;
+	}
+
+	/* Twiddles exp(-j*2*pi*k/len) for k < len / 2, computed in double */
+	twiddle = new complex[len / 2];
+	for (int k = 0; k < len / 2; k++) {
+		double arg = -2.0 * M_PI * k / len;
+		twiddle[k] = complex(cos(arg), sin(arg));
+	}
+}
+
+FFT::~FFT()
+{
+	delete[] rev;
+	delete[] twiddle;
+}
+
+int FFT::roundUp(int n)
+{
+	int len = 2;
+
+	while (len < n)
+		len <<= 1;
+
+	return len;
+}
+
+void FFT::forward(complex *data) const
+{
+	transform(data, false);
+}
+
+void FFT::inverse(complex *data) const
+{
+	transform(data, true);
+}
+
+/*
+ * Butterflies of a stage of size 'm' take every (len / m)-th twiddle. The
+ * inverse transform uses the conjugate twiddles.
+ */
+void FFT::transform(complex *data, bool inv) const
+{
+	for (int i = 0; i < len; i++) {
+		int r = rev[i];
+		if (i < r) {
+			complex tmp = data[i];
+			data[i] = data[r];
+			data[r] = tmp;
+		}
+	}
+
+	for (int m = 2; m <= len; m <<= 1) {
+		int half = m / 2;
+		int step = len / m;
+
+		for (int k = 0; k < len; k += m) {
+			for (int j = 0; j < half; j++) {
+				complex w = twiddle[j * step];
+				if (inv)
+					w = w.conj();
+
+				complex *a = data + k + j;
+				complex *b = a + half;
+				complex t = *b * w;
+
+				*b = *a - t;
+				*a = *a + t;
+			}
+		}
+	}
+}
@@ -0,0 +1,64 @@
+/*
+ * Fast Fourier transform
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include "Complex.h"
+
+/* Largest supported transform is 2^FFT_MAX_LOG2 points */
+#define FFT_MAX_LOG2	16
+
+/*
+    FFT - In-place complex transform of power-of-two length. The bit
+          reversal permutation and twiddle factors are computed once at
+          construction, so a transform does no allocation and no
+          trigonometry. Transforms are iterative radix-2 decimation
+          in time.
+*/
+class FFT {
+public:
+	/** FFT constructor
+	    @param len transform length, must be a power of two
+	*/
+	FFT(int len);
+	~FFT();
+
+	/** Transform length */
+	int size() const { return len; }
+
+	/** Forward transform, exp(-j...) kernel */
+	void forward(complex *data) const;
+
+	/** Inverse transform, unscaled */
+	void inverse(complex *data) const;
+
+	/** Smallest power of two not less than n */
+	static int roundUp(int n);
+
+private:
+	int len;
+	unsigned *rev;
+	complex *twiddle;
+
+	void transform(complex *data, bool inv) const;
+};
+
+#endif /* FFT_H */
@@ -0,0 +1,445 @@
+/*
+ * Fixed-point receive kernels
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <math.h>
+#include "fixed.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define HAVE_X86_KERNELS
+  #include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+  #define HAVE_NEON_KERNELS
+  #include <arm_neon.h>
+#endif
+
+/* Largest sum of tap magnitudes that full-scale samples can't overflow */
+#define TAP_SUM_MAX	65535
+
+typedef void (*correlate_func)(int *y, const short *x, const short *re,
+			       const short *im, int hlen, int len);
+typedef void (*filter_func)(int *y, const short *x, const short *h,
+			    int hlen, int len);
+
+/*
+ * Generic kernels
+ */
+static void dot_generic(int *y, const short *x, const short *re,
+			const short *im, int len)
+{
+	int sum_re = 0, sum_im = 0;
+
+	for (int i = 0; i < 2 * len; i++) {
+		sum_re += x[i] * re[i];
+		sum_im += x[i] * im[i];
+	}
+
+	y[0] = sum_re;
+	y[1] = sum_im;
+}
+
+static void correlate_generic(int *y, const short *x, const short *re,
+			      const short *im, int hlen, int len)
+{
+	for (int n = 0; n < len; n++)
+		dot_generic(y + 2 * n, x + 2 * n, re, im, hlen);
+}
+
+static void filter_generic(int *y, const short *x, const short *h,
+			   int hlen, int len)
+{
+	for (int n = 0; n < len; n++) {
+		int sum_re = 0, sum_im = 0;
+
+		for (int k = 0; k < hlen; k++) {
+			sum_re += h[k] * x[2 * (n + k) + 0];
+			sum_im += h[k] * x[2 * (n + k) + 1];
+		}
+
+		y[2 * n + 0] = sum_re;
+		y[2 * n + 1] = sum_im;
+	}
+}
+
+/* Taps h[k] and h[k + 1] in the low and high half of a word */
+static inline int tap_pair(const short *h, int k)
+{
+	return (unsigned short) h[k] | ((unsigned) (unsigned short) h[k + 1] << 16);
+}
+
+#ifdef HAVE_X86_KERNELS
+/*
+ * SSE2 kernels - four complex samples per iteration
+ *
+ * Correlations run across outputs rather than along taps. Each 32-bit
+ * lane holds one complex sample, so a multiply-add against the tap pair
+ * (re, -im) broadcast to all lanes gives the real part of one tap's
+ * product for four outputs, and (im, re) the imaginary part.
+ */
+__attribute__((target("sse2")))
+static void correlate_sse2(int *y, const short *x, const short *re,
+			   const short *im, int hlen, int len)
+{
+	int n;
+
+	for (n = 0; n + 4 <= len; n += 4) {
+		__m128i acc_re = _mm_setzero_si128();
+		__m128i acc_im = _mm_setzero_si128();
+
+		for (int k = 0; k < hlen; k++) {
+			__m128i xv = _mm_loadu_si128((const __m128i *)
+						     (x + 2 * (n + k)));
+			acc_re = _mm_add_epi32(acc_re, _mm_madd_epi16(xv,
+				_mm_set1_epi32(tap_pair(re, 2 * k))));
+			acc_im = _mm_add_epi32(acc_im, _mm_madd_epi16(xv,
+				_mm_set1_epi32(tap_pair(im, 2 * k))));
+		}
+
+		_mm_storeu_si128((__m128i *) (y + 2 * n),
+				 _mm_unpacklo_epi32(acc_re, acc_im));
+		_mm_storeu_si128((__m128i *) (y + 2 * n + 4),
+				 _mm_unpackhi_epi32(acc_re, acc_im));
+	}
+
+	correlate_generic(y + 2 * n, x + 2 * n, re, im, hlen, len - n);
+}
+
+/*
+ * Filters run across outputs rather than along taps. Interleaving a
+ * vector of samples with the one a sample later gives pairs of adjacent
+ * real and imaginary parts, so one multiply-add against a pair of taps
+ * advances two complex outputs by two taps.
+ */
+__attribute__((target("sse2")))
+static void filter_sse2(int *y, const short *x, const short *h,
+			int hlen, int len)
+{
+	int n;
+
+	for (n = 0; n + 4 <= len; n += 4) {
+		__m128i acc_lo = _mm_setzero_si128();
+		__m128i acc_hi = _mm_setzero_si128();
+
+		for (int k = 0; k < hlen; k += 2) {
+			const short *p = x + 2 * (n + k);
+			__m128i a = _mm_loadu_si128((const __m128i *) p);
+			__m128i b = _mm_loadu_si128((const __m128i *) (p + 2));
+			__m128i hv = _mm_set1_epi32(tap_pair(h, k));
+			acc_lo = _mm_add_epi32(acc_lo,
+				_mm_madd_epi16(_mm_unpacklo_epi16(a, b), hv));
+			acc_hi = _mm_add_epi32(acc_hi,
+				_mm_madd_epi16(_mm_unpackhi_epi16(a, b), hv));
+		}
+
+		_mm_storeu_si128((__m128i *) (y + 2 * n), acc_lo);
+		_mm_storeu_si128((__m128i *) (y + 2 * n + 4), acc_hi);
+	}
+
+	filter_generic(y + 2 * n, x + 2 * n, h, hlen, len - n);
+}
+
+/*
+ * AVX2 kernels - eight complex samples per iteration
+ *
+ * The remainder is summed here rather than by the SSE2 kernels, since
+ * calling legacy SSE code with live 256-bit registers stalls on every
+ * instruction.
+ *
+ * Interleaving works within 128-bit lanes, so the low lane holds outputs
+ * n to n + 3 and the high lane n + 4 to n + 7, put back in order on the
+ * way out.
+ */
+__attribute__((target("avx2")))
+static void filter_avx2(int *y, const short *x, const short *h,
+			int hlen, int len)
+{
+	int n;
+
+	for (n = 0; n + 8 <= len; n += 8) {
+		__m256i acc_lo = _mm256_setzero_si256();
+		__m256i acc_hi = _mm256_setzero_si256();
+
+		for (int k = 0; k < hlen; k += 2) {
+			const short *p = x + 2 * (n + k);
+			__m256i a = _mm256_loadu_si256((const __m256i *) p);
+			__m256i b = _mm256_loadu_si256((const __m256i *) (p + 2));
+			__m256i hv = _mm256_set1_epi32(tap_pair(h, k));
+			acc_lo = _mm256_add_epi32(acc_lo,
+				_mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), hv));
+			acc_hi = _mm256_add_epi32(acc_hi,
+				_mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), hv));
+		}
+
+		_mm256_storeu_si256((__m256i *) (y + 2 * n),
+			_mm256_permute2x128_si256(acc_lo, acc_hi, 0x20));
+		_mm256_storeu_si256((__m256i *) (y + 2 * n + 8),
+			_mm256_permute2x128_si256(acc_lo, acc_hi, 0x31));
+	}
+
+	for (; n + 4 <= len; n += 4) {
+		__m128i acc_lo = _mm_setzero_si128();
+		__m128i acc_hi = _mm_setzero_si128();
+
+		for (int k = 0; k < hlen; k += 2) {
+			const short *p = x + 2 * (n + k);
+			__m128i a = _mm_loadu_si128((const __m128i *) p);
+			__m128i b = _mm_loadu_si128((const __m128i *) (p + 2));
+			__m128i hv = _mm_set1_epi32(tap_pair(h, k));
+			acc_lo = _mm_add_epi32(acc_lo,
+				_mm_madd_epi16(_mm_unpacklo_epi16(a, b), hv));
+			acc_hi = _mm_add_epi32(acc_hi,
+				_mm_madd_epi16(_mm_unpackhi_epi16(a, b), hv));
+		}
+
+		_mm_storeu_si128((__m128i *) (y + 2 * n), acc_lo);
+		_mm_storeu_si128((__m128i *) (y + 2 * n + 4), acc_hi);
+	}
+
+	for (; n < len; n++) {
+		int sum_re = 0, sum_im = 0;
+
+		for (int k = 0; k < hlen; k++) {
+			sum_re += h[k] * x[2 * (n + k) + 0];
+			sum_im += h[k] * x[2 * (n + k) + 1];
+		}
+
+		y[2 * n + 0] = sum_re;
+		y[2 * n + 1] = sum_im;
+	}
+}
+
+/* Outputs are put back in order as in filter_avx2() */
+__attribute__((target("avx2")))
+static void correlate_avx2(int *y, const short *x, const short *re,
+			   const short *im, int hlen, int len)
+{
+	int n;
+
+	for (n = 0; n + 8 <= len; n += 8) {
+		__m256i acc_re = _mm256_setzero_si256();
+		__m256i acc_im = _mm256_setzero_si256();
+
+		for (int k = 0; k < hlen; k++) {
+			__m256i xv = _mm256_loadu_si256((const __m256i *)
+							(x + 2 * (n + k)));
+			acc_re = _mm256_add_epi32(acc_re, _mm256_madd_epi16(xv,
+				_mm256_set1_epi32(tap_pair(re, 2 * k))));
+			acc_im = _mm256_add_epi32(acc_im, _mm256_madd_epi16(xv,
+				_mm256_set1_epi32(tap_pair(im, 2 * k))));
+		}
+
+		__m256i lo = _mm256_unpacklo_epi32(acc_re, acc_im);
+		__m256i hi = _mm256_unpackhi_epi32(acc_re, acc_im);
+		_mm256_storeu_si256((__m256i *) (y + 2 * n),
+			_mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *) (y + 2 * n + 8),
+			_mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	for (; n + 4 <= len; n += 4) {
+		__m128i acc_re = _mm_setzero_si128();
+		__m128i acc_im = _mm_setzero_si128();
+
+		for (int k = 0; k < hlen; k++) {
+			__m128i xv = _mm_loadu_si128((const __m128i *)
+						     (x + 2 * (n + k)));
+			acc_re = _mm_add_epi32(acc_re, _mm_madd_epi16(xv,
+				_mm_set1_epi32(tap_pair(re, 2 * k))));
+			acc_im = _mm_add_epi32(acc_im, _mm_madd_epi16(xv,
+				_mm_set1_epi32(tap_pair(im, 2 * k))));
+		}
+
+		_mm_storeu_si128((__m128i *) (y + 2 * n),
+				 _mm_unpacklo_epi32(acc_re, acc_im));
+		_mm_storeu_si128((__m128i *) (y + 2 * n + 4),
+				 _mm_unpackhi_epi32(acc_re, acc_im));
+	}
+
+	for (; n < len; n++) {
+		int sum_re = 0, sum_im = 0;
+
+		for (int i = 0; i < 2 * hlen; i++) {
+			sum_re += x[2 * n + i] * re[i];
+			sum_im += x[2 * n + i] * im[i];
+		}
+
+		y[2 * n + 0] = sum_re;
+		y[2 * n + 1] = sum_im;
+	}
+}
+#endif /* HAVE_X86_KERNELS */
+
+#ifdef HAVE_NEON_KERNELS
+/* NEON kernels - four complex samples per iteration */
+/* re[2k] and im[2k] are the real and imaginary parts of tap k */
+static void correlate_neon(int *y, const short *x, const short *re,
+			   const short *im, int hlen, int len)
+{
+	int n;
+
+	for (n = 0; n + 4 <= len; n += 4) {
+		int32x4x2_t acc;
+		acc.val[0] = vdupq_n_s32(0);
+		acc.val[1] = vdupq_n_s32(0);
+
+		for (int k = 0; k < hlen; k++) {
+			int16x4x2_t v = vld2_s16(x + 2 * (n + k));
+			acc.val[0] = vmlal_n_s16(acc.val[0], v.val[0], re[2 * k]);
+			acc.val[0] = vmlsl_n_s16(acc.val[0], v.val[1], im[2 * k]);
+			acc.val[1] = vmlal_n_s16(acc.val[1], v.val[0], im[2 * k]);
+			acc.val[1] = vmlal_n_s16(acc.val[1], v.val[1], re[2 * k]);
+		}
+
+		vst2q_s32(y + 2 * n, acc);
+	}
+
+	correlate_generic(y + 2 * n, x + 2 * n, re, im, hlen, len - n);
+}
+
+static void filter_neon(int *y, const short *x, const short *h,
+			int hlen, int len)
+{
+	int n;
+
+	for (n = 0; n + 4 <= len; n += 4) {
+		int32x4x2_t acc;
+		acc.val[0] = vdupq_n_s32(0);
+		acc.val[1] = vdupq_n_s32(0);
+
+		for (int k = 0; k < hlen; k++) {
+			int16x4x2_t v = vld2_s16(x + 2 * (n + k));
+			acc.val[0] = vmlal_n_s16(acc.val[0], v.val[0], h[k]);
+			acc.val[1] = vmlal_n_s16(acc.val[1], v.val[1], h[k]);
+		}
+
+		vst2q_s32(y + 2 * n, acc);
+	}
+
+	filter_generic(y + 2 * n, x + 2 * n, h, hlen, len - n);
+}
+#endif /* HAVE_NEON_KERNELS */
+
+/* Selected kernels, default to generic until fixedInit() runs */
+static correlate_func correlate = correlate_generic;
+static filter_func filter = filter_generic;
+static const char *fixed_impl = "generic";
+
+void fixedInit()
+{
+#if defined(HAVE_NEON_KERNELS)
+	correlate = correlate_neon;
+	filter = filter_neon;
+	fixed_impl = "neon";
+#elif defined(HAVE_X86_KERNELS)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		correlate = correlate_avx2;
+		filter = filter_avx2;
+		fixed_impl = "avx2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		correlate = correlate_sse2;
+		filter = filter_sse2;
+		fixed_impl = "sse2";
+	}
+#endif
+}
+
+const char *fixedImpl()
+{
+	return fixed_impl;
+}
+
+/*
+ * Rounding adds at most half a unit to each of the 'num' magnitudes,
+ * which is taken off the budget before the scale is chosen.
+ */
+static float tap_scale(const float *taps, int num, float maxScale)
+{
+	float peak = 0.0f, sum = 0.0f;
+
+	for (int i = 0; i < num; i++) {
+		float mag = fabsf(taps[i]);
+		if (mag > peak)
+			peak = mag;
+		sum += mag;
+	}
+
+	float scale = maxScale;
+	if ((peak > 0.0f) && (32767.0f / peak < scale))
+		scale = 32767.0f / peak;
+	if ((sum > 0.0f) && ((TAP_SUM_MAX - num / 2) / sum < scale))
+		scale = (TAP_SUM_MAX - num / 2) / sum;
+
+	return scale;
+}
+
+float fixedTaps(short *re, short *im, const float *taps, int len,
+		float maxScale)
+{
+	float scale = tap_scale(taps, 2 * len, maxScale);
+
+	for (int i = 0; i < len; i++) {
+		short r = (short) lrintf(taps[2 * i + 0] * scale);
+		short m = (short) lrintf(taps[2 * i + 1] * scale);
+
+		re[2 * i + 0] = r;
+		re[2 * i + 1] = -m;
+		im[2 * i + 0] = m;
+		im[2 * i + 1] = r;
+	}
+
+	return scale;
+}
+
+float fixedRealTaps(short *h, const float *taps, int len, float maxScale)
+{
+	float scale = tap_scale(taps, len, maxScale);
+
+	for (int i = 0; i < len; i++)
+		h[i] = (short) lrintf(taps[i] * scale);
+
+	return scale;
+}
+
+void fixedCorrelate(int *y, const short *x, const short *re, const short *im,
+		    int hlen, int len)
+{
+	correlate(y, x, re, im, hlen, len);
+}
+
+void fixedFilter(int *y, const short *x, const short *h, int hlen, int len)
+{
+	filter(y, x, h, hlen, len);
+}
+
+long long fixedEnergy(const short *x, int len, int stride)
+{
+	long long energy = 0;
+
+	for (int i = 0; i < len; i++) {
+		const short *p = x + 2 * i * stride;
+		energy += p[0] * p[0];
+		energy += p[1] * p[1];
+	}
+
+	return energy;
+}
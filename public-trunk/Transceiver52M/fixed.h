@@ -0,0 +1,84 @@
+/*
+ * Fixed-point receive kernels
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef FIXED_H
+#define FIXED_H
+
+/*
+ * Kernels on received samples in the device format, interleaved 16-bit
+ * complex integers, with 'len' the number of complex samples.
+ *
+ * Filters are quantized by fixedTaps() into two vectors of 16-bit pairs,
+ * (re, -im) and (im, re), so that a complex multiply-accumulate is two
+ * pairwise multiply-adds. Sums are exact in 32 bits as long as the taps
+ * were scaled by fixedTaps(); every implementation gives identical
+ * results.
+ */
+
+/** Select kernels for the running CPU; safe to call more than once */
+void fixedInit();
+
+/** Return the name of the selected kernel set */
+const char *fixedImpl();
+
+/**
+ * Quantize complex filter taps for fixedCorrelate()
+ *
+ * The scale is the largest that keeps a dot product of the taps with
+ * full-scale samples within 32 bits, but no more than 'maxScale'.
+ *
+ * @param re output, 2 * len values
+ * @param im output, 2 * len values
+ * @param taps interleaved complex floats
+ * @param len number of taps
+ * @param maxScale upper bound of the scale
+ * @return the scale applied to the taps
+ */
+float fixedTaps(short *re, short *im, const float *taps, int len,
+		float maxScale);
+
+/**
+ * Quantize real filter taps for fixedFilter(), as fixedTaps()
+ *
+ * @param h output, len values
+ * @param taps real floats
+ * @param len number of taps
+ * @param maxScale upper bound of the scale
+ * @return the scale applied to the taps
+ */
+float fixedRealTaps(short *h, const float *taps, int len, float maxScale);
+
+/**
+ * y[n] = sum(x[n + k] * h[k]) for 'len' complex outputs, h quantized by
+ * fixedTaps(); x holds len + hlen - 1 samples
+ */
+void fixedCorrelate(int *y, const short *x, const short *re, const short *im,
+		    int hlen, int len);
+
+/**
+ * y[n] = sum(h[k] * x[n + k]) for 'len' outputs, h quantized by
+ * fixedRealTaps(); x holds len + hlen - 1 samples and hlen is even
+ */
+void fixedFilter(int *y, const short *x, const short *h, int hlen, int len);
+
+/** Sum of |x|^2 over 'len' samples taken 'stride' samples apart */
+long long fixedEnergy(const short *x, int len, int stride);
+
+#endif /* FIXED_H */
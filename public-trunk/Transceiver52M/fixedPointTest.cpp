@@ -0,0 +1,321 @@
+/*
+* Copyright 2011 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+  Accuracy of the fixed-point receive chain against the floating point one.
+
+  Normal and RACH bursts go through a two path channel with a random
+  phase and delay, then gaussian noise, and are quantized to the 16-bit
+  device format.  Both chains see the same quantized samples: the
+  floating point one after conversion to a signalVector, the fixed-point
+  one as they are.  Each chain runs energy detection, the correlator and
+  the soft-slicing demodulator on its own estimates, as the transceiver
+  would.
+
+  For every signal level and SNR the test reports how often the two
+  chains disagree on detection, the largest differences of the timing
+  and amplitude estimates, the bit error rate of each chain over the
+  data bits, and the time each chain takes per burst.  Small input
+  levels are included since they leave the fewest significant bits.
+
+  Output is CSV on stdout:
+
+    burst,level,snr_db,trials,detect_mismatch,max_toa_err,max_amp_err,ber_float,ber_fixed,ns_float,ns_fixed
+
+  The exit status is non-zero if any row is outside the tolerances below.
+
+  Usage: fixedPointTest [trials]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "sigProcLib.h"
+#include "convert.h"
+#include "GSMCommon.h"
+#include <Logger.h>
+#include <Configuration.h>
+
+using namespace std;
+
+ConfigurationTable gConfig;
+
+// tolerances, TOA in symbols, amplitude relative
+static const double maxDetectMismatch = 0.01;
+static const double maxTOAError = 0.05;
+static const double maxAmpError = 0.01;
+static const double maxExtraBER = 0.002;
+
+static const int samplesPerSymbol = 1;
+static const int TSC = 2;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static float uniform()
+{
+  return (float) rand()/(float) RAND_MAX;
+}
+
+// random bits, with the training sequence in the middle
+static BitVector *normalBits()
+{
+  BitVector data1(58), data2(58);
+  for (size_t i = 0; i < 58; i++) {
+    data1[i] = rand() & 0x01;
+    data2[i] = rand() & 0x01;
+  }
+  BitVector tail = "000";
+  return new BitVector(BitVector(BitVector(tail,data1),
+                                 BitVector(gTrainingSequence[TSC],data2)),
+                       tail);
+}
+
+// RACH synch sequence after 8 tail bits, random bits after it
+static BitVector *rachBits()
+{
+  BitVector rachStart = "01010101";
+  BitVector rachRest(99);
+  for (size_t i = 0; i < rachRest.size(); i++) rachRest[i] = rand() & 0x01;
+  return new BitVector(BitVector(rachStart,gRACHSynchSequence),rachRest);
+}
+
+// main path at a random phase, a weaker one a symbol later, random delay
+static signalVector *channelBurst(const BitVector &bits,
+                                  const signalVector &gsmPulse,
+                                  float level, float snrdB, float delay)
+{
+  signalVector *tx = modulateBurst(bits,gsmPulse,8,samplesPerSymbol);
+  float phase = 2.0*M_PI*uniform();
+  signalVector channel(samplesPerSymbol+1);
+  channel.fill(0.0);
+  channel[0] = complex(level*cos(phase),level*sin(phase));
+  channel[samplesPerSymbol] = complex(0.0,0.3)*channel[0];
+  signalVector *rx = convolve(tx,&channel,NULL,NO_DELAY);
+  delayVector(*rx,delay*samplesPerSymbol);
+  signalVector *noise = gaussianNoise(rx->size(),
+                                      level*level/pow(10.0,snrdB/10.0));
+  addVector(*rx,*noise);
+  delete noise;
+  delete tx;
+  return rx;
+}
+
+struct Row {
+  int trials;
+  int mismatch;		///< bursts detected by one chain only
+  int errFloat;		///< bit errors of the floating point chain
+  int errFixed;		///< bit errors of the fixed-point chain
+  int bits;		///< data bits counted for each chain
+  double maxTOAError;
+  double maxAmpError;
+  double nsFloat;
+  double nsFixed;
+};
+
+struct ChainResult {
+  bool found;
+  complex amplitude;
+  float TOA;
+};
+
+// data bits of a demodulated normal burst
+static int bitErrors(const BitVector &tx, const SoftVector &rx)
+{
+  int errors = 0;
+  for (size_t i = 3; i < 145; i++) {
+    if ((i >= 61) && (i < 87)) continue;
+    if ((rx[i] > 0.5) != (tx[i] == 1)) errors++;
+  }
+  return errors;
+}
+
+static const int dataBits = 116;
+
+static void runNormal(const signalVector &gsmPulse, float level, float snrdB,
+                      int trials, Row &row)
+{
+  memset(&row,0,sizeof(row));
+  row.trials = trials;
+
+  for (int n = 0; n < trials; n++) {
+    BitVector *bits = normalBits();
+    signalVector *rx = channelBurst(*bits,gsmPulse,level,snrdB,2.0*uniform());
+    int len = rx->size();
+
+    short *fixedBurst = new short[2*len];
+    convertFloatToShort(fixedBurst,(float *) rx->begin(),1.0F,len);
+    signalVector floatBurst(len);
+    convertShortToFloat((float *) floatBurst.begin(),fixedBurst,1.0F,len);
+    signalVector work(len);
+    SoftVector floatBits(len/samplesPerSymbol);
+    SoftVector fixedBits(len/samplesPerSymbol);
+
+    // floating point chain
+    ChainResult f;
+    float avgPwr;
+    double start = now();
+    floatBurst.copyTo(work);
+    energyDetect(work,20*samplesPerSymbol,0.0,&avgPwr);
+    f.found = analyzeTrafficBurst(work,TSC,3.0,samplesPerSymbol,
+                                  &f.amplitude,&f.TOA,3*samplesPerSymbol);
+    if (f.found)
+      demodulateBurst(work,gsmPulse,samplesPerSymbol,f.amplitude,f.TOA,
+                      &floatBits);
+    row.nsFloat += now() - start;
+
+    // fixed-point chain
+    ChainResult x;
+    start = now();
+    energyDetect(fixedBurst,len,20*samplesPerSymbol,0.0,&avgPwr);
+    x.found = analyzeTrafficBurst(fixedBurst,len,TSC,3.0,samplesPerSymbol,
+                                  &x.amplitude,&x.TOA,3*samplesPerSymbol);
+    if (x.found)
+      demodulateBurst(fixedBurst,len,samplesPerSymbol,x.amplitude,x.TOA,
+                      &fixedBits);
+    row.nsFixed += now() - start;
+
+    if (f.found != x.found) row.mismatch++;
+    if (f.found && x.found) {
+      double toaErr = fabs(f.TOA - x.TOA)/samplesPerSymbol;
+      double ampErr = (f.amplitude - x.amplitude).abs()/f.amplitude.abs();
+      if (toaErr > row.maxTOAError) row.maxTOAError = toaErr;
+      if (ampErr > row.maxAmpError) row.maxAmpError = ampErr;
+      row.errFloat += bitErrors(*bits,floatBits);
+      row.errFixed += bitErrors(*bits,fixedBits);
+      row.bits += dataBits;
+    }
+
+    delete[] fixedBurst;
+    delete rx;
+    delete bits;
+  }
+
+  row.nsFloat /= trials;
+  row.nsFixed /= trials;
+}
+
+static void runRACH(const signalVector &gsmPulse, float level, float snrdB,
+                    int trials, Row &row)
+{
+  memset(&row,0,sizeof(row));
+  row.trials = trials;
+
+  for (int n = 0; n < trials; n++) {
+    BitVector *bits = rachBits();
+    signalVector *rx = channelBurst(*bits,gsmPulse,level,snrdB,2.0*uniform());
+    int len = rx->size();
+
+    short *fixedBurst = new short[2*len];
+    convertFloatToShort(fixedBurst,(float *) rx->begin(),1.0F,len);
+    signalVector floatBurst(len);
+    convertShortToFloat((float *) floatBurst.begin(),fixedBurst,1.0F,len);
+
+    ChainResult f, x;
+    double start = now();
+    f.found = detectRACHBurst(floatBurst,5.0,samplesPerSymbol,
+                              &f.amplitude,&f.TOA);
+    row.nsFloat += now() - start;
+
+    start = now();
+    x.found = detectRACHBurst(fixedBurst,len,5.0,samplesPerSymbol,
+                              &x.amplitude,&x.TOA);
+    row.nsFixed += now() - start;
+
+    if (f.found != x.found) row.mismatch++;
+    if (f.found && x.found) {
+      double toaErr = fabs(f.TOA - x.TOA)/samplesPerSymbol;
+      double ampErr = (f.amplitude - x.amplitude).abs()/f.amplitude.abs();
+      if (toaErr > row.maxTOAError) row.maxTOAError = toaErr;
+      if (ampErr > row.maxAmpError) row.maxAmpError = ampErr;
+    }
+
+    delete[] fixedBurst;
+    delete rx;
+    delete bits;
+  }
+
+  row.nsFloat /= trials;
+  row.nsFixed /= trials;
+}
+
+static bool report(const char *burst, float level, float snrdB, const Row &row)
+{
+  double berFloat = row.bits ? (double) row.errFloat/row.bits : 0.0;
+  double berFixed = row.bits ? (double) row.errFixed/row.bits : 0.0;
+
+  printf("%s,%g,%g,%d,%d,%.4f,%.4f,%.5f,%.5f,%.0f,%.0f\n",
+         burst,level,snrdB,row.trials,row.mismatch,row.maxTOAError,
+         row.maxAmpError,berFloat,berFixed,row.nsFloat,row.nsFixed);
+
+  return (row.mismatch <= maxDetectMismatch*row.trials) &&
+         (row.maxTOAError <= maxTOAError) &&
+         (row.maxAmpError <= maxAmpError) &&
+         (berFixed <= berFloat + maxExtraBER);
+}
+
+int main(int argc, char **argv)
+{
+  gLogInit("ERROR");
+
+  int trials = (argc > 1) ? atoi(argv[1]) : 500;
+  if (trials <= 0) {
+    fprintf(stderr,"usage: %s [trials]\n",argv[0]);
+    return 1;
+  }
+
+  sigProcLibSetup(samplesPerSymbol);
+  convertInit();
+  signalVector *gsmPulse = generateGSMPulse(2,samplesPerSymbol);
+  generateMidamble(*gsmPulse,samplesPerSymbol,TSC);
+  generateRACHSequence(*gsmPulse,samplesPerSymbol);
+
+  srand(1);
+
+  printf("# fixed-point kernels: %s\n",fixedImpl());
+  printf("burst,level,snr_db,trials,detect_mismatch,max_toa_err,max_amp_err,ber_float,ber_fixed,ns_float,ns_fixed\n");
+
+  static const float levels[] = { 30.0, 300.0, 3000.0 };
+  static const float snrs[] = { 6.0, 12.0, 20.0, 30.0 };
+  int failures = 0;
+
+  for (unsigned l = 0; l < sizeof(levels)/sizeof(levels[0]); l++) {
+    for (unsigned s = 0; s < sizeof(snrs)/sizeof(snrs[0]); s++) {
+      Row row;
+      runNormal(*gsmPulse,levels[l],snrs[s],trials,row);
+      if (!report("normal",levels[l],snrs[s],row)) failures++;
+      runRACH(*gsmPulse,levels[l],snrs[s],trials,row);
+      if (!report("rach",levels[l],snrs[s],row)) failures++;
+    }
+  }
+
+  delete gsmPulse;
+  sigProcLibDestroy();
+
+  return failures ? 2 : 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+/*
+ * Writes dspTables.h, the signal processing tables that depend only on
+ * compile-time constants. Run it again after changing TABLESIZE,
+ * FARROW_LEN or FARROW_ORDER:
+ *
+ *	./genTables > dspTables.h
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "farrow.h"
+
+/* Must match sigProcLib.cpp */
+#define TABLESIZE		1024
+
+static void printTable(const char *name, const float *data, int len)
+{
+	printf("static const float %s[%d] = {", name, len);
+	for (int i = 0; i < len; i++) {
+		if (i % 6)
+			printf(", ");
+		else
+			printf("%s\n\t", i ? "," : "");
+		printf("%.9g", data[i]);
+	}
+	printf("\n};\n\n");
+}
+
+int main()
+{
+	static float cosTable[TABLESIZE + 1];
+	static float sinTable[TABLESIZE + 1];
+
+	for (int i = 0; i < TABLESIZE + 1; i++) {
+		cosTable[i] = cos(2.0 * M_PI * i / TABLESIZE);
+		sinTable[i] = sin(2.0 * M_PI * i / TABLESIZE);
+	}
+
+	Farrow farrow(FARROW_LEN, FARROW_ORDER);
+
+	printf("/*\n"
+	       " * Copyright 2011 Free Software Foundation, Inc.\n"
+	       " *\n"
+	       " * This program is free software: you can redistribute it and/or modify\n"
+	       " * it under the terms of the GNU Affero General Public License as published by\n"
+	       " * the Free Software Foundation, either version 3 of the License, or\n"
+	       " * (at your option) any later version.\n"
+	       " *\n"
+	       " * This program is distributed in the hope that it will be useful,\n"
+	       " * but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+	       " * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+	       " * GNU Affero General Public License for more details.\n"
+	       " *\n"
+	       " * You should have received a copy of the GNU Affero General Public License\n"
+	       " * along with this program.  If not, see <http://www.gnu.org/licenses/>.\n"
+	       " * See the COPYING file in the main directory for details.\n"
+	       " */\n"
+	       "\n");
+	printf("/* Generated by genTables, do not edit */\n\n");
+	printf("#ifndef DSPTABLES_H\n#define DSPTABLES_H\n\n");
+	printf("#define DSPTABLES_TABLESIZE\t\t%d\n", TABLESIZE);
+	printf("#define DSPTABLES_FARROW_LEN\t\t%d\n", FARROW_LEN);
+	printf("#define DSPTABLES_FARROW_ORDER\t\t%d\n\n", FARROW_ORDER);
+
+	printf("/* cos and sin of 2 pi i / TABLESIZE, with one entry for wrap around */\n");
+	printTable("cosTable", cosTable, TABLESIZE + 1);
+	printTable("sinTable", sinTable, TABLESIZE + 1);
+
+	printf("/* Farrow interpolator fit and its largest tap error */\n");
+	printf("static const double farrowError = %.17g;\n\n", farrow.error());
+	printTable("farrowCoeffs", farrow.coeffs(),
+		   (FARROW_ORDER + 1) * FARROW_LEN);
+
+	printf("#endif /* DSPTABLES_H */\n");
+
+	return 0;
+}
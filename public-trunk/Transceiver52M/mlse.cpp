@@ -0,0 +1,476 @@
+/*
+ * Maximum likelihood sequence estimation with soft output
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "mlse.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define HAVE_X86_KERNELS
+  #include <immintrin.h>
+#endif
+
+#define MLSE_MAX_STATES		(1 << MLSE_MAX_MEMORY)
+
+/*
+ * Path costs only grow, rescale them now and then. Doing it on every
+ * step would put a load of the previous result into each recursion.
+ */
+#define MLSE_NORM_INTERVAL	16
+
+/*
+ * Soft output table, the logistic function of the log likelihood ratio
+ * over +/-MLSE_LLR_MAX. The L1 decoders treat anything closer than 0.01
+ * to a hard decision as certain, so the range and the linear
+ * interpolation between entries lose nothing.
+ */
+#define MLSE_LLR_MAX		8
+#define MLSE_LLR_STEPS		16
+#define MLSE_LLR_LEN		(2 * MLSE_LLR_MAX * MLSE_LLR_STEPS)
+
+/*
+ * Trellis layout
+ *
+ * State bit k holds symbol a[n-1-k]. Taking symbol b from state s is
+ * transition t = (s << 1) | b, which ends in state t & (S - 1). New state
+ * 2j + b is reached from the old states j and j + S/2, so one butterfly
+ * handles the pair of old states and both new states.
+ *
+ * Branch metrics are stored in butterfly order, four rows of S/2 values:
+ * row 0 is t = 2j, row 1 is t = 2j + 1, row 2 is t = 2j + S and row 3 is
+ * t = 2j + S + 1. The metric drops |z|^2, which is common to all branches.
+ * Flipping every symbol negates the expected value, and in this order the
+ * complement of entry i is entry 2S - 1 - i, so only half the products
+ * are needed.
+ */
+/*
+ * Working state of a burst. Each thread gets its own on first use, so
+ * that bursts of several timeslots can be equalized at once; it is too
+ * large for the stacks of the transceiver threads.
+ */
+struct mlse_state {
+	/* Expected symbols, real and imaginary parts doubled, and energies */
+	float exp_re[2 * MLSE_MAX_STATES] __attribute__((aligned(16)));
+	float exp_im[2 * MLSE_MAX_STATES] __attribute__((aligned(16)));
+	float exp_nrg[2 * MLSE_MAX_STATES] __attribute__((aligned(16)));
+
+	/* Metrics, forward and backward costs of the whole burst */
+	float metrics[MLSE_MAX_SYMBOLS * 2 * MLSE_MAX_STATES]
+		__attribute__((aligned(16)));
+	float forward[MLSE_MAX_SYMBOLS + 1][MLSE_MAX_STATES]
+		__attribute__((aligned(16)));
+	float backward[MLSE_MAX_SYMBOLS + 1][MLSE_MAX_STATES]
+		__attribute__((aligned(16)));
+};
+
+typedef void (*metric_func)(struct mlse_state *st, const float *rx, int len,
+			    int num);
+typedef void (*trellis_func)(struct mlse_state *st, int len, int half);
+typedef void (*decide_func)(const struct mlse_state *st, float *diff, int len,
+			    int num_states);
+
+static float logistic[MLSE_LLR_LEN + 2];
+
+static pthread_key_t state_key;
+static pthread_once_t state_once = PTHREAD_ONCE_INIT;
+
+static void state_key_init()
+{
+	pthread_key_create(&state_key, free);
+}
+
+/* Working state of the calling thread, freed when the thread exits */
+static struct mlse_state *thread_state()
+{
+	pthread_once(&state_once, state_key_init);
+
+	void *st = pthread_getspecific(state_key);
+	if (!st) {
+		if (posix_memalign(&st, 16, sizeof(struct mlse_state)))
+			return NULL;
+		pthread_setspecific(state_key, st);
+	}
+
+	return (struct mlse_state *) st;
+}
+
+static void normalize(float *cost, int num_states)
+{
+	float norm = cost[0];
+
+	for (int s = 0; s < num_states; s++)
+		cost[s] -= norm;
+}
+
+/*
+ * Generic kernels
+ */
+static void metric_generic(struct mlse_state *st, const float *rx, int len,
+			   int num)
+{
+	const float *exp_re = st->exp_re;
+	const float *exp_im = st->exp_im;
+	const float *exp_nrg = st->exp_nrg;
+	float *bm = st->metrics;
+
+	for (int n = 0; n < len; n++, bm += num) {
+		const float *z = &rx[2 * n];
+
+		for (int i = 0; i < num / 2; i++) {
+			float x = z[0] * exp_re[i] + z[1] * exp_im[i];
+			bm[i] = exp_nrg[i] - x;
+			bm[num - 1 - i] = exp_nrg[num - 1 - i] + x;
+		}
+	}
+}
+
+static inline void acs_fwd_generic(float *out, const float *in,
+				   const float *bm, int half)
+{
+	for (int j = 0; j < half; j++) {
+		for (int b = 0; b < 2; b++) {
+			float p = in[j] + bm[b * half + j];
+			float q = in[j + half] + bm[(2 + b) * half + j];
+			out[2 * j + b] = q < p ? q : p;
+		}
+	}
+}
+
+static inline void acs_bwd_generic(float *out, const float *in,
+				   const float *bm, int half)
+{
+	for (int j = 0; j < half; j++) {
+		float p0 = bm[j] + in[2 * j];
+		float p1 = bm[half + j] + in[2 * j + 1];
+		float q0 = bm[2 * half + j] + in[2 * j];
+		float q1 = bm[3 * half + j] + in[2 * j + 1];
+
+		out[j] = p1 < p0 ? p1 : p0;
+		out[j + half] = q1 < q0 ? q1 : q0;
+	}
+}
+
+/*
+ * The forward and backward recursions are independent, so both run in
+ * the same loop where their add-compare-select chains overlap.
+ */
+static void trellis_generic(struct mlse_state *st, int len, int half)
+{
+	int num_states = 2 * half;
+	float (*forward)[MLSE_MAX_STATES] = st->forward;
+	float (*backward)[MLSE_MAX_STATES] = st->backward;
+	const float *metrics = st->metrics;
+
+	for (int n = 0; n < len; n++) {
+		int m = len - 1 - n;
+
+		acs_fwd_generic(forward[n + 1], forward[n],
+				&metrics[n * 2 * num_states], half);
+		acs_bwd_generic(backward[m], backward[m + 1],
+				&metrics[m * 2 * num_states], half);
+
+		if (!((n + 1) % MLSE_NORM_INTERVAL)) {
+			normalize(forward[n + 1], num_states);
+			normalize(backward[m], num_states);
+		}
+	}
+}
+
+/*
+ * Best path through each symbol value, cost of -1 less cost of +1. The
+ * costs at symbol n are those of state bit 0 at time n + 1.
+ */
+static void decide_generic(const struct mlse_state *st, float *diff, int len,
+			   int num_states)
+{
+	const float (*forward)[MLSE_MAX_STATES] = st->forward;
+	const float (*backward)[MLSE_MAX_STATES] = st->backward;
+
+	for (int n = 0; n < len; n++) {
+		const float *a = forward[n + 1];
+		const float *b = backward[n + 1];
+		float cost0 = a[0] + b[0];
+		float cost1 = a[1] + b[1];
+
+		for (int s = 2; s < num_states; s += 2) {
+			float c0 = a[s] + b[s];
+			float c1 = a[s + 1] + b[s + 1];
+			if (c0 < cost0) cost0 = c0;
+			if (c1 < cost1) cost1 = c1;
+		}
+
+		diff[n] = cost0 - cost1;
+	}
+}
+
+#ifdef HAVE_X86_KERNELS
+/*
+ * SSE kernels, four states per instruction. minps returns its second
+ * operand on equal inputs, the same choice as the generic kernels.
+ */
+__attribute__((target("sse")))
+static void metric_sse(struct mlse_state *st, const float *rx, int len, int num)
+{
+	const float *exp_re = st->exp_re;
+	const float *exp_im = st->exp_im;
+	const float *exp_nrg = st->exp_nrg;
+	float *bm = st->metrics;
+
+	for (int n = 0; n < len; n++, bm += num) {
+		__m128 zr = _mm_set1_ps(rx[2 * n + 0]);
+		__m128 zi = _mm_set1_ps(rx[2 * n + 1]);
+
+		for (int i = 0; i < num / 2; i += 4) {
+			int k = num - 4 - i;
+			__m128 re = _mm_mul_ps(zr, _mm_load_ps(&exp_re[i]));
+			__m128 im = _mm_mul_ps(zi, _mm_load_ps(&exp_im[i]));
+			__m128 x = _mm_add_ps(re, im);
+			__m128 xr = _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 1, 2, 3));
+
+			_mm_store_ps(&bm[i], _mm_sub_ps(_mm_load_ps(&exp_nrg[i]), x));
+			_mm_store_ps(&bm[k], _mm_add_ps(_mm_load_ps(&exp_nrg[k]), xr));
+		}
+	}
+}
+
+/*
+ * Trellis with the path costs held in registers, HALF butterflies of
+ * four states per vector. Costs are stored for the soft output pass but
+ * never loaded back. Normalization subtracts state zero from every
+ * state, the same arithmetic as the generic version.
+ */
+template <int HALF>
+__attribute__((target("sse")))
+static void trellis_sse_n(struct mlse_state *st, int len)
+{
+	const int V = HALF / 4;
+	float (*forward)[MLSE_MAX_STATES] = st->forward;
+	float (*backward)[MLSE_MAX_STATES] = st->backward;
+	const float *metrics = st->metrics;
+	__m128 a[2 * V], b[2 * V], na[2 * V], nb[2 * V];
+
+	for (int v = 0; v < 2 * V; v++) {
+		a[v] = _mm_load_ps(&forward[0][4 * v]);
+		b[v] = _mm_load_ps(&backward[len][4 * v]);
+	}
+
+	for (int n = 0; n < len; n++) {
+		int m = len - 1 - n;
+		const float *fm = &metrics[n * 4 * HALF];
+		const float *bm = &metrics[m * 4 * HALF];
+
+		for (int v = 0; v < V; v++) {
+			int j = 4 * v;
+
+			__m128 p0 = _mm_add_ps(a[v], _mm_load_ps(&fm[j]));
+			__m128 p1 = _mm_add_ps(a[v], _mm_load_ps(&fm[HALF + j]));
+			__m128 q0 = _mm_add_ps(a[v + V],
+					       _mm_load_ps(&fm[2 * HALF + j]));
+			__m128 q1 = _mm_add_ps(a[v + V],
+					       _mm_load_ps(&fm[3 * HALF + j]));
+
+			__m128 n0 = _mm_min_ps(q0, p0);
+			__m128 n1 = _mm_min_ps(q1, p1);
+			na[2 * v] = _mm_unpacklo_ps(n0, n1);
+			na[2 * v + 1] = _mm_unpackhi_ps(n0, n1);
+		}
+
+		for (int v = 0; v < V; v++) {
+			int j = 4 * v;
+			__m128 even = _mm_shuffle_ps(b[2 * v], b[2 * v + 1],
+						     _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 odd = _mm_shuffle_ps(b[2 * v], b[2 * v + 1],
+						    _MM_SHUFFLE(3, 1, 3, 1));
+
+			__m128 p0 = _mm_add_ps(_mm_load_ps(&bm[j]), even);
+			__m128 p1 = _mm_add_ps(_mm_load_ps(&bm[HALF + j]), odd);
+			__m128 q0 = _mm_add_ps(_mm_load_ps(&bm[2 * HALF + j]), even);
+			__m128 q1 = _mm_add_ps(_mm_load_ps(&bm[3 * HALF + j]), odd);
+
+			nb[v] = _mm_min_ps(p1, p0);
+			nb[v + V] = _mm_min_ps(q1, q0);
+		}
+
+		if (!((n + 1) % MLSE_NORM_INTERVAL)) {
+			__m128 fnorm = _mm_shuffle_ps(na[0], na[0], 0);
+			__m128 bnorm = _mm_shuffle_ps(nb[0], nb[0], 0);
+			for (int v = 0; v < 2 * V; v++) {
+				na[v] = _mm_sub_ps(na[v], fnorm);
+				nb[v] = _mm_sub_ps(nb[v], bnorm);
+			}
+		}
+
+		for (int v = 0; v < 2 * V; v++) {
+			a[v] = na[v];
+			b[v] = nb[v];
+			_mm_store_ps(&forward[n + 1][4 * v], a[v]);
+			_mm_store_ps(&backward[m][4 * v], b[v]);
+		}
+	}
+}
+
+/* Needs four butterflies, i.e. a channel memory of three or more */
+__attribute__((target("sse")))
+static void trellis_sse(struct mlse_state *st, int len, int half)
+{
+	switch (half) {
+	case 4:
+		trellis_sse_n<4>(st, len);
+		break;
+	case 8:
+		trellis_sse_n<8>(st, len);
+		break;
+	case 16:
+		trellis_sse_n<16>(st, len);
+		break;
+	default:
+		trellis_generic(st, len, half);
+	}
+}
+/* Minimums are exact, so the order of the reduction does not matter */
+__attribute__((target("sse")))
+static void decide_sse(const struct mlse_state *st, float *diff, int len,
+		       int num_states)
+{
+	const float (*forward)[MLSE_MAX_STATES] = st->forward;
+	const float (*backward)[MLSE_MAX_STATES] = st->backward;
+
+	for (int n = 0; n < len; n++) {
+		const float *a = forward[n + 1];
+		const float *b = backward[n + 1];
+		__m128 c = _mm_add_ps(_mm_load_ps(&a[0]), _mm_load_ps(&b[0]));
+
+		for (int s = 4; s < num_states; s += 4)
+			c = _mm_min_ps(c, _mm_add_ps(_mm_load_ps(&a[s]),
+						     _mm_load_ps(&b[s])));
+
+		c = _mm_min_ps(c, _mm_movehl_ps(c, c));
+		c = _mm_sub_ss(c, _mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1)));
+		_mm_store_ss(&diff[n], c);
+	}
+}
+#endif /* HAVE_X86_KERNELS */
+
+/* Selected kernels, default to generic until mlseInit() runs */
+static metric_func metric = metric_generic;
+static trellis_func trellis = trellis_generic;
+static decide_func decide = decide_generic;
+static const char *mlse_impl = "generic";
+
+void mlseInit()
+{
+	for (int i = 0; i <= MLSE_LLR_LEN; i++) {
+		float llr = (float) i / MLSE_LLR_STEPS - MLSE_LLR_MAX;
+		logistic[i] = 1.0f / (1.0f + expf(-llr));
+	}
+	logistic[MLSE_LLR_LEN + 1] = logistic[MLSE_LLR_LEN];
+
+#ifdef HAVE_X86_KERNELS
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse")) {
+		metric = metric_sse;
+		trellis = trellis_sse;
+		decide = decide_sse;
+		mlse_impl = "sse";
+	}
+#endif
+}
+
+const char *mlseImpl()
+{
+	return mlse_impl;
+}
+
+/*
+ * Fill the expected symbol tables in butterfly order. The real and
+ * imaginary parts are doubled so that the metric is a single
+ * multiply-add per component.
+ */
+static void init_expected(struct mlse_state *st, const float *chan, int memory)
+{
+	int num_states = 1 << memory;
+	int half = num_states / 2;
+
+	for (int row = 0; row < 4; row++) {
+		for (int j = 0; j < half; j++) {
+			int t = 2 * j + (row & 1) + (row >> 1) * num_states;
+			float re = 0.0f, im = 0.0f;
+
+			for (int k = 0; k <= memory; k++) {
+				float a = ((t >> k) & 1) ? 1.0f : -1.0f;
+				re += a * chan[2 * k + 0];
+				im += a * chan[2 * k + 1];
+			}
+
+			st->exp_re[row * half + j] = 2.0f * re;
+			st->exp_im[row * half + j] = 2.0f * im;
+			st->exp_nrg[row * half + j] = re * re + im * im;
+		}
+	}
+}
+
+int mlseSoft(const float *rx, int len, const float *chan, int memory,
+	     float noise_var, float *soft)
+{
+	if ((memory < MLSE_MIN_MEMORY) || (memory > MLSE_MAX_MEMORY) ||
+	    (len < 1) || (len > MLSE_MAX_SYMBOLS) || (noise_var <= 0.0f))
+		return -1;
+
+	struct mlse_state *st = thread_state();
+	if (!st)
+		return -1;
+
+	int num_states = 1 << memory;
+	int half = num_states / 2;
+
+	init_expected(st, chan, memory);
+	metric(st, rx, len, 2 * num_states);
+
+	/* Both ends are open, every state starts at zero cost */
+	for (int s = 0; s < num_states; s++) {
+		st->forward[0][s] = 0.0f;
+		st->backward[len][s] = 0.0f;
+	}
+
+	if (half < 4)
+		trellis_generic(st, len, half);
+	else
+		trellis(st, len, half);
+
+	float diff[MLSE_MAX_SYMBOLS];
+	decide(st, diff, len, num_states);
+
+	float scale = MLSE_LLR_STEPS / noise_var;
+	for (int n = 0; n < len; n++) {
+		float x = diff[n] * scale + MLSE_LLR_MAX * MLSE_LLR_STEPS;
+		if (x < 0.0f)
+			x = 0.0f;
+		else if (x > MLSE_LLR_LEN)
+			x = MLSE_LLR_LEN;
+
+		int i = (int) x;
+		float frac = x - i;
+		soft[n] = logistic[i] + frac * (logistic[i + 1] - logistic[i]);
+	}
+
+	return 0;
+}
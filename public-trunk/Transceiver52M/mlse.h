@@ -0,0 +1,67 @@
+/*
+ * Maximum likelihood sequence estimation with soft output
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef MLSE_H
+#define MLSE_H
+
+/*
+ * Max-log-MAP equalizer
+ *
+ * The received symbols are modelled as z[n] = sum(g[k] * a[n-k]) plus
+ * white noise, k = 0..memory, with antipodal symbols a = +/-1. The trellis
+ * has 2^memory states; a forward and a backward add-compare-select pass
+ * over it give, for every symbol, the best path cost with the symbol at +1
+ * and at -1. Their difference scaled by the noise variance is the max-log
+ * approximation of the log likelihood ratio, which is mapped back to a
+ * probability for the soft output.
+ *
+ * Symbols before the start of the burst are unknown and every state is
+ * equally likely at both ends of the trellis.
+ *
+ * All vectors are interleaved complex floats, the layout of signalVector
+ * data. The vector kernels only reorder independent adds and minimums, so
+ * every implementation gives identical results.
+ */
+
+#define MLSE_MIN_MEMORY		2
+#define MLSE_MAX_MEMORY		5
+#define MLSE_MAX_SYMBOLS	300
+
+/** Select kernels and build tables before mlseSoft(); safe to call again */
+void mlseInit();
+
+/** Return the name of the selected kernel set */
+const char *mlseImpl();
+
+/**
+ * Equalize a burst of symbols
+ *
+ * @param rx received symbols, 'len' complex values
+ * @param len number of symbols, at most MLSE_MAX_SYMBOLS
+ * @param chan channel taps g[0..memory], complex
+ * @param memory channel memory, MLSE_MIN_MEMORY to MLSE_MAX_MEMORY
+ * @param noise_var noise variance relative to the channel taps
+ * @param soft output, probability of each symbol being +1
+ * @return 0 on success, -1 on bad arguments
+ */
+int mlseSoft(const float *rx, int len, const float *chan, int memory,
+	     float noise_var, float *soft);
+
+#endif /* MLSE_H */
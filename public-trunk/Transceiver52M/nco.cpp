@@ -0,0 +1,245 @@
+/*
+ * Numerically controlled oscillator and complex mixing kernels
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <math.h>
+#include "nco.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define HAVE_X86_KERNELS
+  #include <immintrin.h>
+#endif
+
+typedef void (*mix_func)(float *y, const float *x, const float *r, int len);
+typedef void (*gen_func)(float *y, float *lanes, const float *step, int len);
+
+/*
+ * Generic kernels
+ */
+static void mix_cplx_generic(float *y, const float *x, const float *r, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float re = x[2 * i + 0] * r[2 * i + 0] - x[2 * i + 1] * r[2 * i + 1];
+		float im = x[2 * i + 1] * r[2 * i + 0] + x[2 * i + 0] * r[2 * i + 1];
+		y[2 * i + 0] = re;
+		y[2 * i + 1] = im;
+	}
+}
+
+static void mix_real_generic(float *y, const float *x, const float *r, int len)
+{
+	for (int i = 0; i < len; i++) {
+		float re = x[2 * i];
+		y[2 * i + 0] = re * r[2 * i + 0];
+		y[2 * i + 1] = re * r[2 * i + 1];
+	}
+}
+
+/*
+ * Write len phasors, len a multiple of four, from the four lanes and
+ * step every lane by four samples.
+ */
+static void gen_generic(float *y, float *lanes, const float *step, int len)
+{
+	for (int i = 0; i < len; i += 4) {
+		for (int k = 0; k < 8; k++)
+			y[2 * i + k] = lanes[k];
+		mix_cplx_generic(lanes, lanes, step, 4);
+	}
+}
+
+#ifdef HAVE_X86_KERNELS
+/* SSE3 kernels - two complex samples per vector */
+__attribute__((target("sse3")))
+static inline __m128 cmul_sse3(__m128 x, __m128 r)
+{
+	__m128 rr = _mm_moveldup_ps(r);
+	__m128 ri = _mm_movehdup_ps(r);
+	__m128 xs = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_addsub_ps(_mm_mul_ps(x, rr), _mm_mul_ps(xs, ri));
+}
+
+__attribute__((target("sse3")))
+static void mix_cplx_sse3(float *y, const float *x, const float *r, int len)
+{
+	int i;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		__m128 a = cmul_sse3(_mm_loadu_ps(x + 2 * i),
+				     _mm_loadu_ps(r + 2 * i));
+		__m128 b = cmul_sse3(_mm_loadu_ps(x + 2 * i + 4),
+				     _mm_loadu_ps(r + 2 * i + 4));
+		_mm_storeu_ps(y + 2 * i, a);
+		_mm_storeu_ps(y + 2 * i + 4, b);
+	}
+
+	mix_cplx_generic(y + 2 * i, x + 2 * i, r + 2 * i, len - i);
+}
+
+__attribute__((target("sse3")))
+static void mix_real_sse3(float *y, const float *x, const float *r, int len)
+{
+	int i;
+
+	for (i = 0; i + 2 <= len; i += 2) {
+		__m128 xr = _mm_moveldup_ps(_mm_loadu_ps(x + 2 * i));
+		_mm_storeu_ps(y + 2 * i, _mm_mul_ps(xr, _mm_loadu_ps(r + 2 * i)));
+	}
+
+	mix_real_generic(y + 2 * i, x + 2 * i, r + 2 * i, len - i);
+}
+
+__attribute__((target("sse3")))
+static void gen_sse3(float *y, float *lanes, const float *step, int len)
+{
+	__m128 p0 = _mm_loadu_ps(lanes);
+	__m128 p1 = _mm_loadu_ps(lanes + 4);
+	__m128 w = _mm_loadu_ps(step);
+
+	for (int i = 0; i < len; i += 4) {
+		_mm_storeu_ps(y + 2 * i, p0);
+		_mm_storeu_ps(y + 2 * i + 4, p1);
+		p0 = cmul_sse3(p0, w);
+		p1 = cmul_sse3(p1, w);
+	}
+
+	_mm_storeu_ps(lanes, p0);
+	_mm_storeu_ps(lanes + 4, p1);
+}
+#endif /* HAVE_X86_KERNELS */
+
+/* Selected kernels, default to generic until ncoInit() runs */
+static mix_func mix_cplx = mix_cplx_generic;
+static mix_func mix_real = mix_real_generic;
+static gen_func gen = gen_generic;
+static const char *nco_impl = "generic";
+
+void ncoInit()
+{
+#ifdef HAVE_X86_KERNELS
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse3")) {
+		mix_cplx = mix_cplx_sse3;
+		mix_real = mix_real_sse3;
+		gen = gen_sse3;
+		nco_impl = "sse3";
+	}
+#endif
+}
+
+const char *ncoImpl()
+{
+	return nco_impl;
+}
+
+void mixComplex(float *y, const float *x, const float *r, int len)
+{
+	mix_cplx(y, x, r, len);
+}
+
+void mixReal(float *y, const float *x, const float *r, int len)
+{
+	mix_real(y, x, r, len);
+}
+
+NCO::NCO(float freq, float phase)
+	: mFreq(0.0), mPhase(0.0), mSinceSync(0)
+{
+	setFreq(freq);
+	setPhase(phase);
+}
+
+void NCO::setFreq(float freq)
+{
+	mFreq = freq;
+	for (int k = 0; k < 4; k++) {
+		mStep[2 * k + 0] = cos(4.0 * mFreq);
+		mStep[2 * k + 1] = sin(4.0 * mFreq);
+	}
+	resync();
+}
+
+void NCO::setPhase(float phase)
+{
+	mPhase = fmod(phase, 2.0 * M_PI);
+	if (mPhase < 0.0)
+		mPhase += 2.0 * M_PI;
+	resync();
+}
+
+void NCO::resync()
+{
+	for (int k = 0; k < 4; k++) {
+		mLanes[2 * k + 0] = cos(mPhase + k * mFreq);
+		mLanes[2 * k + 1] = sin(mPhase + k * mFreq);
+	}
+	mSinceSync = 0;
+}
+
+void NCO::advance(int len)
+{
+	mPhase = fmod(mPhase + len * mFreq, 2.0 * M_PI);
+	if (mPhase < 0.0)
+		mPhase += 2.0 * M_PI;
+}
+
+/*
+ * The recurrence only steps whole groups of four, so a block that ends
+ * part way through a group restarts the lanes from the exact phase.
+ */
+void NCO::run(float *y, const float *x, int len, bool real)
+{
+	while (len > 0) {
+		int n = len < NCO_BLOCK_LEN ? len : NCO_BLOCK_LEN;
+		int groups = (n + 3) & ~3;
+
+		if (mSinceSync >= NCO_RESYNC_LEN)
+			resync();
+
+		if (groups > n) {
+			gen(mBlock, mLanes, mStep, groups);
+			advance(n);
+			resync();
+		} else {
+			gen(mBlock, mLanes, mStep, n);
+			advance(n);
+			mSinceSync += n;
+		}
+
+		if (real)
+			mix_real(y, x, mBlock, n);
+		else
+			mix_cplx(y, x, mBlock, n);
+
+		x += 2 * n;
+		y += 2 * n;
+		len -= n;
+	}
+}
+
+void NCO::mix(float *y, const float *x, int len)
+{
+	run(y, x, len, false);
+}
+
+void NCO::mixReal(float *y, const float *x, int len)
+{
+	run(y, x, len, true);
+}
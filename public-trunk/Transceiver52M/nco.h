@@ -0,0 +1,87 @@
+/*
+ * Numerically controlled oscillator and complex mixing kernels
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef NCO_H
+#define NCO_H
+
+/*
+ * Mixing kernels
+ *
+ * All vectors are interleaved complex floats, i.e. the layout of
+ * signalVector data, and 'len' is the number of complex samples. Output
+ * may overwrite the input. As with the convolution kernels, no fused
+ * multiply-add is used and every implementation gives identical results.
+ */
+
+/** Select kernels for the running CPU; safe to call more than once */
+void ncoInit();
+
+/** Return the name of the selected kernel set */
+const char *ncoImpl();
+
+/** y = x * r, sample by sample */
+void mixComplex(float *y, const float *x, const float *r, int len);
+
+/** y = Re{x} * r, sample by sample, for real-valued input vectors */
+void mixReal(float *y, const float *x, const float *r, int len);
+
+/*
+ * Oscillator
+ *
+ * Phasors are generated in blocks by a complex recurrence four samples
+ * wide, then mixed with the input. The phase is also kept in double
+ * precision, and the recurrence is restarted from it every
+ * NCO_RESYNC_LEN samples, so magnitude and phase errors do not build up
+ * over long vectors.
+ */
+#define NCO_BLOCK_LEN		64
+#define NCO_RESYNC_LEN		1024
+
+class NCO {
+public:
+	/** Frequency in radians per sample, starting phase in radians */
+	NCO(float freq = 0.0f, float phase = 0.0f);
+
+	void setFreq(float freq);
+	void setPhase(float phase);
+
+	/** Phase of the next sample, in [0, 2pi) */
+	float phase() const { return (float) mPhase; }
+
+	/** y = x * e^(j phase), advancing the oscillator by len samples */
+	void mix(float *y, const float *x, int len);
+
+	/** y = Re{x} * e^(j phase), for real-valued input vectors */
+	void mixReal(float *y, const float *x, int len);
+
+private:
+	double mFreq;
+	double mPhase;
+	float mLanes[8];		/* next four phasors */
+	float mStep[8];			/* e^(j 4 freq), repeated */
+	float mBlock[2 * NCO_BLOCK_LEN];
+	int mSinceSync;			/* samples since the lanes were reset */
+
+	void resync();
+	void advance(int len);
+	void run(float *y, const float *x, int len, bool real);
+};
+
+#endif /* NCO_H */
@@ -0,0 +1,86 @@
+/*
+ * Receive pipeline stages and the queues between them
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "pipeline.h"
+#include <Logger.h>
+
+void pinThread(int cpu)
+{
+	if (cpu < 0)
+		return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (err) {
+		LOG(ALARM) << "cannot pin thread to CPU " << cpu << ": "
+			   << strerror(err);
+		return;
+	}
+
+	LOG(INFO) << "thread pinned to CPU " << cpu;
+}
+
+uint64_t pipelineTime()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void pipelineWait(volatile int32_t *addr, int32_t value, unsigned timeout)
+{
+	struct timespec ts;
+
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000000;
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, &ts, NULL, 0);
+}
+
+void pipelineWake(volatile int32_t *addr)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void logStageStats(const char *name, const StageQueueStats &stats,
+		   unsigned long *lastDropped)
+{
+	LOG(INFO) << name << " queue depth " << stats.depth
+		  << ", max depth " << stats.maxDepth
+		  << ", mean latency "
+		  << (stats.passed ? stats.totalLatency / stats.passed : 0)
+		  << " us, max latency " << stats.maxLatency << " us";
+
+	if (stats.dropped != *lastDropped) {
+		LOG(NOTICE) << name << " queue was full for "
+			    << stats.dropped << " entries";
+		*lastDropped = stats.dropped;
+	}
+}
@@ -0,0 +1,181 @@
+/*
+ * Receive pipeline stages and the queues between them
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include <string.h>
+
+/** Receive pipeline stages, in the order samples pass through them */
+enum pipelineStage {
+	DEVICE_STAGE,		///< device reads
+	CONVERT_STAGE,		///< conversion, resampling and burst framing
+	DEMOD_STAGE,		///< burst detection and demodulation
+	DELIVERY_STAGE,		///< writes to the GSM core
+	NUM_PIPELINE_STAGES
+};
+
+/** Pin the calling thread to a CPU; a negative CPU leaves it unpinned */
+void pinThread(int cpu);
+
+/** Monotonic time in microseconds */
+uint64_t pipelineTime();
+
+/** Sleep while *addr is 'value', up to 'timeout' milliseconds */
+void pipelineWait(volatile int32_t *addr, int32_t value, unsigned timeout);
+
+/** Wake the thread sleeping on addr */
+void pipelineWake(volatile int32_t *addr);
+
+/** Stage queue counters */
+struct StageQueueStats {
+	unsigned depth;			///< entries queued now
+	unsigned maxDepth;		///< largest depth seen at dequeue
+	unsigned long passed;		///< entries dequeued
+	unsigned long dropped;		///< entries refused because the queue was full
+	uint64_t totalLatency;		///< sum of queueing times in microseconds
+	unsigned maxLatency;		///< largest queueing time in microseconds
+};
+
+/** Log the counters of the queue in front of a stage, and any new drops */
+void logStageStats(const char *name, const StageQueueStats &stats,
+		   unsigned long *lastDropped);
+
+/*
+    StageQueue - Bounded queue between two pipeline stages, built like the
+                 rings of SharedMemoryLink. The counters only ever increase
+                 and each has a cache line to itself; no lock is taken and
+                 no system call is made unless the consumer is asleep.
+                 Entries are copied in and out. A full queue refuses the
+                 entry, so the producer is never held up by the consumer.
+
+                 There is one producer and one consumer at a time. The
+                 counters are kept by the consumer; stats() may be called
+                 from any thread and asks the consumer to restart them.
+*/
+template <class T, unsigned N>
+class StageQueue {
+public:
+	StageQueue()
+		: mHead(0), mTail(0), mSequence(0), mWaiting(0),
+		  mDropped(0), mRestart(0)
+	{
+		memset(&mStats, 0, sizeof(mStats));
+	}
+
+	/** Queue an entry, false if the queue is full */
+	bool put(const T &val)
+	{
+		uint32_t head = mHead;
+		if (head - mTail >= N) {
+			mDropped++;
+			return false;
+		}
+
+		Slot &slot = mSlots[head % N];
+		slot.val = val;
+		slot.time = pipelineTime();
+
+		/* Publish the slot, then check for a sleeping consumer */
+		__sync_synchronize();
+		mHead = head + 1;
+		__sync_synchronize();
+		if (mWaiting) {
+			__sync_fetch_and_add(&mSequence, 1);
+			pipelineWake(&mSequence);
+		}
+		return true;
+	}
+
+	/** Dequeue the oldest entry, waiting up to 'timeout' milliseconds
+	    for one; false if there is none */
+	bool get(T &val, unsigned timeout)
+	{
+		uint32_t tail = mTail;
+		if (mHead == tail) {
+			/* Announce the wait, then look again, so that a producer
+			   either sees the flag or its entry is seen here */
+			int32_t sequence = mSequence;
+			mWaiting = 1;
+			__sync_synchronize();
+			if (mHead == tail)
+				pipelineWait(&mSequence, sequence, timeout);
+			mWaiting = 0;
+			if (mHead == tail)
+				return false;
+		}
+
+		__sync_synchronize();
+		unsigned depth = mHead - tail;
+		Slot &slot = mSlots[tail % N];
+		val = slot.val;
+		unsigned latency = pipelineTime() - slot.time;
+
+		/* Release the slot only after the copy is complete */
+		__sync_synchronize();
+		mTail = tail + 1;
+
+		if (mRestart) {
+			memset(&mStats, 0, sizeof(mStats));
+			mRestart = 0;
+		}
+		if (depth > mStats.maxDepth)
+			mStats.maxDepth = depth;
+		if (latency > mStats.maxLatency)
+			mStats.maxLatency = latency;
+		mStats.totalLatency += latency;
+		mStats.passed++;
+		return true;
+	}
+
+	/** Return the counters, optionally restarting the maximums and totals */
+	StageQueueStats stats(bool restart = false)
+	{
+		StageQueueStats stats = mStats;
+		stats.depth = mHead - mTail;
+		stats.dropped = mDropped;
+		if (restart)
+			mRestart = 1;
+		return stats;
+	}
+
+private:
+	struct Slot {
+		T val;
+		uint64_t time;		///< when the entry was queued
+	};
+
+	volatile uint32_t mHead;	///< entries queued, owned by the producer
+	char pad0[60];
+	volatile uint32_t mTail;	///< entries dequeued, owned by the consumer
+	char pad1[60];
+	volatile int32_t mSequence;	///< futex word, bumped to wake the consumer
+	volatile int32_t mWaiting;	///< set while the consumer may sleep
+	char pad2[56];
+
+	Slot mSlots[N];
+
+	unsigned long mDropped;		///< owned by the producer
+	volatile int mRestart;
+	StageQueueStats mStats;		///< owned by the consumer
+};
+
+#endif /* PIPELINE_H */
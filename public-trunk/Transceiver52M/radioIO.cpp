@@ -22,53 +22,35 @@
 #include <radioInterface.h>
 #include <Logger.h>
 
-/* Device side buffers */
-static short rx_buf[OUTCHUNK * 2 * 2];
-static short tx_buf[INCHUNK * 2 * 2];
+/*
+ * Without resampling the interface buffers are already in the device
+ * format; bursts are converted and scaled on their way in and out of them.
+ */
 
-/* Complex float to short conversion */
-static int float_to_short(short *shrt_out, float *flt_in, int num)
+/* Receive a timestamped chunk from the device */ 
+void RadioInterface::pullBuffer()
 {
-	int i;
-
-	for (i = 0; i < num; i++) {
-		shrt_out[2 * i + 0] = flt_in[2 * i + 0];
-		shrt_out[2 * i + 1] = flt_in[2 * i + 1];
-	}
+	/* Read straight into the receive buffer */
+	short *rx_buf = rcvBuffer + 2 * rcvCursor;
 
-	return i;
+	readChunk(rx_buf);
+	convertChunk(rx_buf);
 }
 
-/* Comlpex short to float conversion */
-static int short_to_float(float *flt_out, short *shrt_in, int num)
+int RadioInterface::rxChunkSize()
 {
-	int i;
-
-	for (i = 0; i < num; i++) {
-		flt_out[2 * i + 0] = shrt_in[2 * i + 0];
-		flt_out[2 * i + 1] = shrt_in[2 * i + 1];
-	}
-
-	return i;
+	return OUTCHUNK;
 }
 
-/* Receive a timestamped chunk from the device */ 
-void RadioInterface::pullBuffer()
+/* Append a chunk to the receive buffer, unless it was read in place */
+void RadioInterface::convertChunk(short *buf)
 {
-	bool local_underrun;
-
-	/* Read samples. Fail if we don't get what we want. */
-	int num_rd = mRadio->readSamples(rx_buf, OUTCHUNK, &overrun,
-					    readTimestamp, &local_underrun);
-
-	LOG(DEBUG) << "Rx read " << num_rd << " samples from device";
-	assert(num_rd == OUTCHUNK);
+	short *rx_buf = rcvBuffer + 2 * rcvCursor;
 
-	underrun |= local_underrun;
-	readTimestamp += (TIMESTAMP) num_rd;
+	if (buf != rx_buf)
+		memcpy(rx_buf, buf, 2 * OUTCHUNK * sizeof(short));
 
-	short_to_float(rcvBuffer + 2 * rcvCursor, rx_buf, num_rd);
-	rcvCursor += num_rd;
+	rcvCursor += OUTCHUNK;
 }
 
 /* Send timestamped chunk to the device with arbitrary size */ 
@@ -77,10 +59,11 @@ void RadioInterface::pushBuffer()
 	if (sendCursor < INCHUNK)
 		return;
 
-	float_to_short(tx_buf, sendBuffer, sendCursor);
+	if (mTxCapture)
+		mTxCapture->record(sendBuffer, sendCursor, writeTimestamp);
 
 	/* Write samples. Fail if we don't get what we want. */
-	int num_smpls = mRadio->writeSamples(tx_buf,
+	int num_smpls = mRadio->writeSamples(sendBuffer,
 					     sendCursor,
 					     &underrun,
 					     writeTimestamp);
@@ -32,17 +32,45 @@ RadioInterface::RadioInterface(RadioDevice *wRadio,
 			       int wRadioOversampling,
 			       int wTransceiverOversampling,
 			       GSM::Time wStartTime)
-  : underrun(false), sendCursor(0), rcvCursor(0), mOn(false),
+  : underrun(false), sendBuffer(NULL), sendCursor(0),
+    rcvBuffer(NULL), rcvCursor(0), mOn(false),
     mRadio(wRadio), receiveOffset(wReceiveOffset),
-    samplesPerSymbol(wRadioOversampling), powerScaling(1.0)
+    samplesPerSymbol(wRadioOversampling), powerScaling(1.0), mTxSetting(1),
+    mRxCapture(NULL), mTxCapture(NULL),
+    mPipelined(false), mDeviceCPU(-1), mConvertCPU(-1),
+    mRxChunks(NULL), mRxChunkNext(0), mConvertTimestamp(0)
 {
   mClock.set(wStartTime);
+
+  convertInit();
+  LOG(INFO) << "using " << convertImpl() << " conversion kernels";
 }
 
 
 RadioInterface::~RadioInterface(void) {
-  if (rcvBuffer!=NULL) delete rcvBuffer;
+  if (rcvBuffer!=NULL) delete[] rcvBuffer;
   //mReceiveFIFO.clear();
+  delete mRxCapture;
+  delete mTxCapture;
+  delete[] mRxChunks;
+}
+
+void RadioInterface::enableCapture(double seconds, bool tx)
+{
+  double rate = mRadio->getSampleRate();
+
+  LOG(INFO) << "capturing the last " << seconds << " seconds of samples";
+  mRxCapture = new SampleCapture(rate,seconds);
+  if (tx) mTxCapture = new SampleCapture(rate,seconds);
+}
+
+bool RadioInterface::dumpCapture(const std::string &prefix, double seconds)
+{
+  if (!mRxCapture) return false;
+
+  if (!mRxCapture->dump(prefix + "-rx.iq",seconds)) return false;
+  if (mTxCapture) mTxCapture->dump(prefix + "-tx.iq",seconds);
+  return true;
 }
 
 double RadioInterface::fullScaleInputValue(void) {
@@ -53,17 +81,26 @@ double RadioInterface::fullScaleOutputValue(void) {
   return mRadio->fullScaleOutputValue();
 }
 
-void RadioInterface::setPowerAttenuation(double atten)
+void RadioInterface::setPowerAttenuation(double atten, int chan)
 {
   double rfGain, digAtten;
 
   rfGain = mRadio->setTxGain(mRadio->maxTxGain() - atten);
   digAtten = atten - mRadio->maxTxGain() + rfGain;
 
+  double scaling;
   if (digAtten < 1.0)
-    powerScaling = 1.0;
+    scaling = 1.0;
   else
-    powerScaling = 1.0/sqrt(pow(10, (digAtten/10.0)));
+    scaling = 1.0/sqrt(pow(10, (digAtten/10.0)));
+
+  // the transmit thread reads the setting before the scaling, so a
+  // burst is never kept under the new setting with the old scaling
+  if (scaling != powerScaling) {
+    powerScaling = scaling;
+    __sync_synchronize();
+    mTxSetting++;
+  }
 }
 
 int RadioInterface::radioifyVector(signalVector &wVector,
@@ -88,9 +125,61 @@ int RadioInterface::radioifyVector(signalVector &wVector,
   return wVector.size();
 }
 
+int RadioInterface::radioifyVector(signalVector &wVector,
+				   short *retVector,
+				   float scale,
+				   bool zero)
+{
+  if (zero) {
+    memset(retVector, 0, wVector.size() * 2 * sizeof(short));
+    return wVector.size();
+  }
+
+  convertFloatToShort(retVector, (float *) wVector.begin(), scale,
+		      wVector.size());
+
+  return wVector.size();
+}
+
+int RadioInterface::radioifyBurst(radioVector &wVector,
+				  RadioSample *retVector,
+				  bool zero)
+{
+#ifdef RESAMPLE
+  // bursts stay floats until the resampler, nothing worth keeping
+  return radioifyVector(wVector, retVector, powerScaling, zero);
+#else
+  if (zero)
+    return radioifyVector(wVector, retVector, powerScaling, zero);
+
+  unsigned setting = mTxSetting;
+  __sync_synchronize();
+
+  const short *samples = wVector.txSamples(setting);
+  if (samples) {
+    memcpy(retVector, samples, wVector.size() * 2 * sizeof(short));
+    return wVector.size();
+  }
+
+  // most bursts are replaced in the filler table before they are sent
+  // again, so only a burst that is sent twice keeps its conversion
+  if (!wVector.markSent(setting))
+    return radioifyVector(wVector, retVector, powerScaling, false);
+
+  short *converted = wVector.newTxSamples(setting);
+  radioifyVector(wVector, converted, powerScaling, false);
+  memcpy(retVector, converted, wVector.size() * 2 * sizeof(short));
+  return wVector.size();
+#endif
+}
+
 int RadioInterface::unRadioifyVector(float *floatVector,
-				     signalVector& newVector)
+				     radioVector& newVector)
 {
+#ifdef FIXED_POINT
+  convertFloatToShort(newVector.fixed(), floatVector, 1.0f,
+		      newVector.size());
+#else
   int i;
   signalVector::iterator itr = newVector.begin();
 
@@ -98,22 +187,152 @@ int RadioInterface::unRadioifyVector(float *floatVector,
     *itr++ = Complex<float>(floatVector[2 * i + 0],
 			    floatVector[2 * i + 1]);
   }
+#endif
+
+  return newVector.size();
+}
+
+int RadioInterface::unRadioifyVector(short *shortVector,
+				     radioVector& newVector)
+{
+#ifdef FIXED_POINT
+  memcpy(newVector.fixed(), shortVector,
+	 newVector.size() * 2 * sizeof(short));
+#else
+  convertShortToFloat((float *) newVector.begin(), shortVector, 1.0f,
+		      newVector.size());
+#endif
 
   return newVector.size();
 }
 
-bool RadioInterface::tuneTx(double freq)
+bool RadioInterface::tuneTx(double freq, int chan)
 {
   return mRadio->setTxFreq(freq);
 }
 
-bool RadioInterface::tuneRx(double freq)
+bool RadioInterface::tuneRx(double freq, int chan)
 {
   return mRadio->setRxFreq(freq);
 }
 
 
-void RadioInterface::start()
+void RadioInterface::start(int chan)
+{
+  startDevice();
+
+  sendBuffer = new RadioSample[2*2*INCHUNK*samplesPerSymbol];
+  rcvBuffer = new RadioSample[2*2*OUTCHUNK*samplesPerSymbol];
+ 
+  mOn = true;
+
+  startPipeline();
+}
+
+void RadioInterface::pipelineReceive(int deviceCPU, int convertCPU)
+{
+  mPipelined = true;
+  mDeviceCPU = deviceCPU;
+  mConvertCPU = convertCPU;
+}
+
+void RadioInterface::startPipeline()
+{
+  if (!mPipelined) return;
+
+  // one buffer being read, one being converted, the queued ones and
+  // a silent one that stands in for reads the queue had no room for
+  int len = rxChunkSize();
+  int numChunks = RX_PIPELINE_CHUNKS + 3;
+  mRxChunks = new short[2*len*numChunks];
+  memset(mRxChunks + 2*len*(numChunks-1), 0, 2*len*sizeof(short));
+  mConvertTimestamp = readTimestamp;
+
+  LOG(INFO) << "starting receive pipeline";
+  mRxDeviceThread.start((void * (*)(void*))RxDeviceServiceLoopAdapter,
+                        (void*)this);
+  mRxConvertThread.start((void * (*)(void*))RxConvertServiceLoopAdapter,
+                         (void*)this);
+}
+
+void RadioInterface::readChunk(short *buf)
+{
+  bool local_underrun;
+  int len = rxChunkSize();
+
+  // Read samples. Fail if we don't get what we want.
+  int num_rd = mRadio->readSamples(buf, len, &overrun,
+                                   readTimestamp, &local_underrun);
+
+  LOG(DEEPDEBUG) << "Rx read " << num_rd << " samples from device";
+  assert(num_rd == len);
+
+  if (mRxCapture)
+    mRxCapture->record(buf, num_rd, readTimestamp);
+
+  underrun |= local_underrun;
+  readTimestamp += (TIMESTAMP) num_rd;
+}
+
+void RadioInterface::driveDeviceStage()
+{
+  RxChunk chunk;
+  int len = rxChunkSize();
+
+  chunk.index = mRxChunkNext % (RX_PIPELINE_CHUNKS + 2);
+  chunk.timestamp = readTimestamp;
+  readChunk(mRxChunks + 2*len*chunk.index);
+
+  // a full queue costs the samples, never a late device read; the
+  // buffer is simply read into again
+  if (mRxChunkQueue.put(chunk)) mRxChunkNext++;
+}
+
+void RadioInterface::driveConvertStage()
+{
+  RxChunk chunk;
+  int len = rxChunkSize();
+
+  if (!mRxChunkQueue.get(chunk,100)) return;
+
+  // reads that were lost are replaced by silence, so that the clock
+  // keeps counting timeslots with the device
+  while (mConvertTimestamp < chunk.timestamp) {
+    convertChunk(mRxChunks + 2*len*(RX_PIPELINE_CHUNKS + 2));
+    frameBursts();
+    mConvertTimestamp += len;
+  }
+
+  convertChunk(mRxChunks + 2*len*chunk.index);
+  frameBursts();
+  mConvertTimestamp += len;
+}
+
+void *RxDeviceServiceLoopAdapter(RadioInterface *radioInterface)
+{
+  radioInterface->setPriority();
+  pinThread(radioInterface->mDeviceCPU);
+
+  while (1) {
+    radioInterface->driveDeviceStage();
+    pthread_testcancel();
+  }
+  return NULL;
+}
+
+void *RxConvertServiceLoopAdapter(RadioInterface *radioInterface)
+{
+  radioInterface->setPriority();
+  pinThread(radioInterface->mConvertCPU);
+
+  while (1) {
+    radioInterface->driveConvertStage();
+    pthread_testcancel();
+  }
+  return NULL;
+}
+
+void RadioInterface::startDevice()
 {
   LOG(INFO) << "starting radio interface...";
   mAlignRadioServiceLoopThread.start((void * (*)(void*))AlignRadioServiceLoopAdapter,
@@ -124,11 +343,6 @@ void RadioInterface::start()
   LOG(DEBUG) << "Radio started";
   mRadio->updateAlignment(writeTimestamp-10000); 
   mRadio->updateAlignment(writeTimestamp-10000);
-
-  sendBuffer = new float[2*2*INCHUNK*samplesPerSymbol];
-  rcvBuffer = new float[2*2*OUTCHUNK*samplesPerSymbol];
- 
-  mOn = true;
 }
 
 void *AlignRadioServiceLoopAdapter(RadioInterface *radioInterface)
@@ -145,25 +359,36 @@ void RadioInterface::alignRadio() {
   mRadio->updateAlignment(writeTimestamp+ (TIMESTAMP) 10000);
 }
 
-void RadioInterface::driveTransmitRadio(signalVector &radioBurst, bool zeroBurst) {
+void RadioInterface::driveTransmitRadio(radioVector &radioBurst, bool zeroBurst,
+                                        const GSM::Time &wTime, int chan) {
 
   if (!mOn) return;
 
-  radioifyVector(radioBurst, sendBuffer + 2 * sendCursor, powerScaling, zeroBurst);
+  radioifyBurst(radioBurst, sendBuffer + 2 * sendCursor, zeroBurst);
 
   sendCursor += radioBurst.size();
 
   pushBuffer();
 }
 
-void RadioInterface::driveReceiveRadio() {
+void RadioInterface::driveReceiveRadio(int chan) {
 
   if (!mOn) return;
 
+  // the pipeline threads frame the bursts, wait for them
+  if (mPipelined) {
+    mReceiveFIFO.wait(RX_PIPELINE_WAIT);
+    return;
+  }
+
   if (mReceiveFIFO.size() > 8) return;
 
   pullBuffer();
+  frameBursts();
+}
 
+void RadioInterface::frameBursts()
+{
   GSM::Time rcvClock = mClock.get();
   rcvClock.decTN(receiveOffset);
   unsigned tN = rcvClock.TN();
@@ -175,12 +400,13 @@ void RadioInterface::driveReceiveRadio() {
   //    GSM bursts and pass up to Transceiver
   // Using the 157-156-156-156 symbols per timeslot format.
   while (rcvSz > (symbolsPerSlot + (tN % 4 == 0))*samplesPerSymbol) {
-    signalVector rxVector((symbolsPerSlot + (tN % 4 == 0)*samplesPerSymbol));
-    unRadioifyVector(rcvBuffer+readSz*2,rxVector);
     GSM::Time tmpTime = rcvClock;
-    if (rcvClock.FN() >= 0) {
+    // idle timeslots are skipped before any conversion
+    if ((rcvClock.FN() >= 0) && mReceiveFIFO.wanted(rcvClock)) {
       LOG(DEEPDEBUG) << "FN: " << rcvClock.FN();
-      radioVector* rxBurst = new radioVector(rxVector,tmpTime);
+      radioVector* rxBurst = new radioVector((symbolsPerSlot + (tN % 4 == 0)*samplesPerSymbol),
+					     tmpTime);
+      unRadioifyVector(rcvBuffer+readSz*2,*rxBurst);
       mReceiveFIFO.put(rxBurst); 
     }
     mClock.incTN(); 
@@ -195,7 +421,7 @@ void RadioInterface::driveReceiveRadio() {
 
   if (readSz > 0) {
     rcvCursor -= readSz;
-    memmove(rcvBuffer,rcvBuffer+2*readSz,sizeof(float) * 2 * rcvCursor);
+    memmove(rcvBuffer,rcvBuffer+2*readSz,sizeof(RadioSample) * 2 * rcvCursor);
   }
 }
 
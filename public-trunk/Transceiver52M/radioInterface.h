@@ -30,16 +30,47 @@
 #include "radioDevice.h"
 #include "radioVector.h"
 #include "radioClock.h"
+#include "resampler.h"
+#include "channelizer.h"
+#include "sampleCapture.h"
+#include "convert.h"
+#include "pipeline.h"
 
 /** samples per GSM symbol */
 #define SAMPSPERSYM 1 
 #define INCHUNK    625
 #define OUTCHUNK   625
 
+/**
+ * Sample type of the interface buffers. Resampling works on floats, so
+ * bursts are held as floats until the resampler converts them; otherwise
+ * they are converted once, straight into the device format.
+ */
+#ifdef RESAMPLE
+typedef float RadioSample;
+#else
+typedef short RadioSample;
+#endif
+
+/** maximum number of channels of a multi-carrier interface */
+#define CHAN_MAX 8
+
+/** device reads the receive pipeline can queue for conversion */
+#define RX_PIPELINE_CHUNKS 64
+
+/** longest wait of a transceiver for pipeline bursts, in milliseconds */
+#define RX_PIPELINE_WAIT 1
+
+/** a device read queued for the conversion stage */
+struct RxChunk {
+  unsigned index;			      ///< buffer of the samples
+  TIMESTAMP timestamp;			      ///< device time of the first sample
+};
+
 /** class to interface the transceiver with the USRP */
 class RadioInterface {
 
-private:
+protected:
 
   Thread mAlignRadioServiceLoopThread;	      ///< thread that synchronizes transmit and receive sections
 
@@ -47,10 +78,10 @@ private:
 
   RadioDevice *mRadio;			      ///< the USRP object
  
-  float *sendBuffer;
+  RadioSample *sendBuffer;		      ///< transmit samples waiting for the device
   unsigned sendCursor;
 
-  float *rcvBuffer;
+  RadioSample *rcvBuffer;		      ///< receive samples not yet framed into bursts
   unsigned rcvCursor;
  
   bool underrun;			      ///< indicates writes to USRP are too slow
@@ -68,6 +99,20 @@ private:
   bool mOn;				      ///< indicates radio is on
 
   double powerScaling;
+  volatile unsigned mTxSetting;		      ///< bumped whenever powerScaling changes
+
+  SampleCapture *mRxCapture;		      ///< ring of recent receive samples, or NULL
+  SampleCapture *mTxCapture;		      ///< ring of recent transmit samples, or NULL
+
+  bool mPipelined;			      ///< receive runs on the device and conversion threads
+  int mDeviceCPU;			      ///< CPU of the device thread, negative if not pinned
+  int mConvertCPU;			      ///< CPU of the conversion thread, negative if not pinned
+  Thread mRxDeviceThread;		      ///< thread that reads the device
+  Thread mRxConvertThread;		      ///< thread that converts samples and frames bursts
+  short *mRxChunks;			      ///< device read buffers, the last one silent
+  unsigned mRxChunkNext;		      ///< device reads queued so far
+  TIMESTAMP mConvertTimestamp;		      ///< device time of the next sample to convert
+  StageQueue<RxChunk,RX_PIPELINE_CHUNKS> mRxChunkQueue; ///< device reads waiting for conversion
 
   /** format samples to USRP */ 
   int radioifyVector(signalVector &wVector,
@@ -75,19 +120,57 @@ private:
                      float scale,
                      bool zero);
 
-  /** format samples from USRP */
-  int unRadioifyVector(float *floatVector, signalVector &wVector);
+  /** format samples to USRP, scaled and saturated to the device format */
+  int radioifyVector(signalVector &wVector,
+                     short *shortVector,
+                     float scale,
+                     bool zero);
+
+  /** format a burst to USRP at the current power scaling; a burst sent
+      a second time keeps its device format conversion, so a filler burst
+      is then only copied until the power changes */
+  int radioifyBurst(radioVector &wVector,
+                    RadioSample *retVector,
+                    bool zero);
+
+  /** format samples from USRP; into the device format samples of the
+      burst in a fixed-point build */
+  int unRadioifyVector(float *floatVector, radioVector &wVector);
+
+  /** format samples from USRP, from the device format */
+  int unRadioifyVector(short *shortVector, radioVector &wVector);
 
   /** push GSM bursts into the transmit buffer */
-  void pushBuffer(void);
+  virtual void pushBuffer(void);
 
   /** pull GSM bursts from the receive buffer */
-  void pullBuffer(void);
+  virtual void pullBuffer(void);
+
+  /** number of samples in a device read */
+  virtual int rxChunkSize(void);
+
+  /** read rxChunkSize() samples from the device */
+  void readChunk(short *buf);
+
+  /** convert a device read into the receive buffer */
+  virtual void convertChunk(short *buf);
+
+  /** frame received GSM bursts out of the receive buffer */
+  virtual void frameBursts(void);
+
+  /** start the receive pipeline threads, if the pipeline is enabled */
+  void startPipeline();
+
+  /** drive one device read of the receive pipeline */
+  void driveDeviceStage();
+
+  /** drive conversion and framing of one device read */
+  void driveConvertStage();
 
 public:
 
-  /** start the interface */
-  void start();
+  /** start the interface, or a channel of it */
+  virtual void start(int chan = 0);
 
   /** constructor */
   RadioInterface(RadioDevice* wRadio = NULL,
@@ -97,7 +180,7 @@ public:
 		 GSM::Time wStartTime = GSM::Time(0));
     
   /** destructor */
-  ~RadioInterface();
+  virtual ~RadioInterface();
 
   /** check for underrun, resets underrun value */
   bool isUnderrun();
@@ -105,17 +188,20 @@ public:
   /** attach an existing USRP to this interface */
   void attach(RadioDevice *wRadio, int wRadioOversampling);
 
-  /** return the receive FIFO */
-  VectorFIFO* receiveFIFO() { return &mReceiveFIFO;}
+  /** return the receive FIFO of a channel */
+  virtual VectorFIFO* receiveFIFO(int chan = 0) { return &mReceiveFIFO;}
+
+  /** number of channels carried by the interface */
+  virtual int numChans() { return 1; }
 
   /** return the basestation clock */
   RadioClock* getClock(void) { return &mClock;};
 
   /** set transmit frequency */
-  bool tuneTx(double freq);
+  virtual bool tuneTx(double freq, int chan = 0);
 
   /** set receive frequency */
-  bool tuneRx(double freq);
+  virtual bool tuneRx(double freq, int chan = 0);
 
   /** set receive gain */
   double setRxGain(double dB);
@@ -123,13 +209,14 @@ public:
   /** get receive gain */
   double getRxGain(void);
 
-  /** drive transmission of GSM bursts */
-  void driveTransmitRadio(signalVector &radioBurst, bool zeroBurst);
+  /** drive transmission of GSM bursts, 'wTime' is the burst's transmit time */
+  virtual void driveTransmitRadio(radioVector &radioBurst, bool zeroBurst,
+                                  const GSM::Time &wTime, int chan = 0);
 
   /** drive reception of GSM bursts */
-  void driveReceiveRadio();
+  virtual void driveReceiveRadio(int chan = 0);
 
-  void setPowerAttenuation(double atten); 
+  virtual void setPowerAttenuation(double atten, int chan = 0);
 
   /** returns the full-scale transmit amplitude **/
   double fullScaleInputValue();
@@ -137,14 +224,34 @@ public:
   /** returns the full-scale receive amplitude **/
   double fullScaleOutputValue();
 
+  /** keep the last 'seconds' of device samples, of transmit too if 'tx' */
+  void enableCapture(double seconds, bool tx);
+
+  /** write up to 'seconds' of the newest captured samples to files
+      named 'prefix'-rx.iq and 'prefix'-tx.iq in the background */
+  bool dumpCapture(const std::string &prefix, double seconds);
+
   /** set thread priority on current thread */
   void setPriority() { mRadio->setPriority(); }
 
+  /** read the device and frame bursts on threads of their own, pinned to
+      the given CPUs if not negative; call before start() */
+  void pipelineReceive(int deviceCPU, int convertCPU);
+
+  /** indicates receive runs as a pipeline */
+  bool pipelined() { return mPipelined; }
+
+  /** return the counters of the device reads waiting for conversion */
+  StageQueueStats rxChunkStats(bool restart = false) { return mRxChunkQueue.stats(restart); }
+
   /** get transport bus type of attached device */ 
   enum RadioDevice::busType getBus() { return mRadio->getBus(); }
 
 protected:
 
+  /** start the alignment thread and the device */
+  void startDevice();
+
   /** drive synchronization of Tx/Rx of USRP */
   void alignRadio();
 
@@ -153,7 +260,102 @@ protected:
 
   friend void *AlignRadioServiceLoopAdapter(RadioInterface*);
 
+  friend void *RxDeviceServiceLoopAdapter(RadioInterface*);
+
+  friend void *RxConvertServiceLoopAdapter(RadioInterface*);
+
 };
 
 /** synchronization thread loop */
 void *AlignRadioServiceLoopAdapter(RadioInterface*);
+
+/** receive pipeline device thread loop */
+void *RxDeviceServiceLoopAdapter(RadioInterface*);
+
+/** receive pipeline conversion thread loop */
+void *RxConvertServiceLoopAdapter(RadioInterface*);
+
+/**
+  Multi-carrier interface. Up to CHAN_MAX channels, spaced at the resampled
+  channel rate of 96/65 times the GSM symbol rate, share one device. The
+  device runs at the channel rate times the channelizer size, a power of
+  two not less than the number of channels. Each channel is resampled to
+  and from the GSM rate on its own, and all channels share the basestation
+  clock. Channel c sits c channel spacings above the device center
+  frequency for c below half the channelizer size, and below it otherwise.
+*/
+class RadioInterfaceMulti : public RadioInterface {
+
+private:
+
+  int mChans;				      ///< number of channels in use
+  Channelizer *dnchannelizer;		      ///< receive side filterbank
+  Synthesizer *upchannelizer;		      ///< transmit side filterbank
+  PolyphaseResampler *dnsampler[CHAN_MAX];    ///< per channel receive resamplers
+  PolyphaseResampler *upsampler[CHAN_MAX];    ///< per channel transmit resamplers
+
+  VectorFIFO mReceiveFIFOs[CHAN_MAX];	      ///< per channel FIFOs of receive bursts
+  bool mChanOn[CHAN_MAX];		      ///< indicates channel has been started
+  double mChanScaling[CHAN_MAX];	      ///< per channel digital power scaling
+
+  float *txBuffer[CHAN_MAX];		      ///< time addressed GSM rate transmit samples
+  int txFill[CHAN_MAX];			      ///< end of the written part of each transmit buffer
+  int txRefFN;				      ///< frame number of the transmit reference frame
+  int txStart;				      ///< position of txBuffer[0] in the reference frame
+  bool txStarted;			      ///< indicates the transmit reference is set
+
+  float *rxBuffer[CHAN_MAX];		      ///< GSM rate receive samples
+  float *chanBuffer[CHAN_MAX];		      ///< channel rate samples at the filterbank
+  float *wideBuffer;			      ///< device rate samples
+  short *deviceBuffer;			      ///< device rate samples in device format
+
+  double mTxCenter, mRxCenter;		      ///< device center frequencies, zero until set
+
+  Mutex mTxLock, mRxLock;
+
+  /** sample offset of a timeslot from the start of its frame */
+  int slotStart(int TN);
+
+  /** frequency offset of a channel from the device center */
+  double chanOffset(int chan);
+
+  void pushBuffer(void);
+
+  void pullBuffer(void);
+
+  int rxChunkSize(void);
+
+  void convertChunk(short *buf);
+
+  void frameBursts(void);
+
+public:
+
+  /** constructor */
+  RadioInterfaceMulti(RadioDevice* wRadio, int numChans,
+		      int receiveOffset = 3,
+		      GSM::Time wStartTime = GSM::Time(0));
+
+  /** destructor */
+  ~RadioInterfaceMulti();
+
+  /** device sample rate for a number of channels */
+  static double deviceRate(int numChans);
+
+  void start(int chan = 0);
+
+  VectorFIFO* receiveFIFO(int chan = 0) { return &mReceiveFIFOs[chan]; }
+
+  int numChans() { return mChans; }
+
+  bool tuneTx(double freq, int chan = 0);
+
+  bool tuneRx(double freq, int chan = 0);
+
+  void driveTransmitRadio(radioVector &radioBurst, bool zeroBurst,
+                          const GSM::Time &wTime, int chan = 0);
+
+  void driveReceiveRadio(int chan = 0);
+
+  void setPowerAttenuation(double atten, int chan = 0);
+};
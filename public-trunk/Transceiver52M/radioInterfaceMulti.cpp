@@ -0,0 +1,405 @@
+/*
+ * Multi-carrier radio interface
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <radioInterface.h>
+#include <Logger.h>
+
+/* Chunk sizes at the GSM and channel rates */
+#ifdef INCHUNK
+  #undef INCHUNK
+#endif
+#ifdef OUTCHUNK
+  #undef OUTCHUNK
+#endif
+
+/* Resampling parameters, as for the single channel resampling interface */
+#define INRATE       (65 * SAMPSPERSYM)
+#define INHISTORY    (INRATE * 2)
+#define INCHUNK      (INRATE * 9)
+
+#define OUTRATE      (96 * SAMPSPERSYM)
+#define OUTHISTORY   (OUTRATE * 2)
+#define OUTCHUNK     (OUTRATE * 9)
+
+/* Resampler filter lengths */
+#define TX_FILTER_LEN	651
+#define RX_FILTER_LEN	961
+
+/* Channel rate and spacing in Hz */
+#define CHAN_RATE	(400e3 * SAMPSPERSYM)
+
+/* Samples in a TDMA frame at the GSM rate */
+#define FRAME_LEN	(1250 * SAMPSPERSYM)
+
+/* Time addressed transmit buffer length, bounds how far channels may run
+ * ahead of the slowest one */
+#define TX_BUF_LEN	(8 * FRAME_LEN)
+
+RadioInterfaceMulti::RadioInterfaceMulti(RadioDevice *wRadio,
+					 int numChans,
+					 int wReceiveOffset,
+					 GSM::Time wStartTime)
+	: RadioInterface(wRadio, wReceiveOffset, SAMPSPERSYM,
+			 SAMPSPERSYM, wStartTime),
+	  mChans(numChans), txRefFN(0), txStart(0), txStarted(false),
+	  mTxCenter(0.0), mRxCenter(0.0)
+{
+	assert((mChans > 0) && (mChans <= CHAN_MAX));
+
+	int M = FFT::roundUp(mChans);
+
+	dnchannelizer = new Channelizer(M, OUTCHUNK);
+	upchannelizer = new Synthesizer(M, OUTCHUNK);
+
+	for (int i = 0; i < CHAN_MAX; i++) {
+		dnsampler[i] = NULL;
+		upsampler[i] = NULL;
+		txBuffer[i] = NULL;
+		rxBuffer[i] = NULL;
+		chanBuffer[i] = NULL;
+		txFill[i] = 0;
+		mChanOn[i] = false;
+		mChanScaling[i] = 1.0;
+	}
+
+	/* Unused filterbank paths carry zeros */
+	for (int i = 0; i < M; i++) {
+		chanBuffer[i] = new float[2 * OUTCHUNK];
+		memset(chanBuffer[i], 0, 2 * OUTCHUNK * sizeof(float));
+	}
+
+	for (int i = 0; i < mChans; i++) {
+		dnsampler[i] = new PolyphaseResampler(INRATE, OUTRATE,
+						      RX_FILTER_LEN,
+						      OUTCHUNK, OUTHISTORY);
+		upsampler[i] = new PolyphaseResampler(OUTRATE, INRATE,
+						      TX_FILTER_LEN,
+						      INCHUNK, INHISTORY);
+
+		txBuffer[i] = new float[2 * TX_BUF_LEN];
+		memset(txBuffer[i], 0, 2 * TX_BUF_LEN * sizeof(float));
+		rxBuffer[i] = new float[2 * 2 * INCHUNK];
+	}
+
+	wideBuffer = new float[2 * M * OUTCHUNK];
+	deviceBuffer = new short[2 * M * OUTCHUNK];
+}
+
+RadioInterfaceMulti::~RadioInterfaceMulti()
+{
+	for (int i = 0; i < CHAN_MAX; i++) {
+		delete dnsampler[i];
+		delete upsampler[i];
+		delete[] txBuffer[i];
+		delete[] rxBuffer[i];
+		delete[] chanBuffer[i];
+	}
+
+	delete[] wideBuffer;
+	delete[] deviceBuffer;
+	delete dnchannelizer;
+	delete upchannelizer;
+}
+
+double RadioInterfaceMulti::deviceRate(int numChans)
+{
+	return FFT::roundUp(numChans) * CHAN_RATE;
+}
+
+int RadioInterfaceMulti::slotStart(int TN)
+{
+	/* 157-156-156-156 symbols per timeslot */
+	return samplesPerSymbol * (156 * TN + (TN + 3) / 4);
+}
+
+double RadioInterfaceMulti::chanOffset(int chan)
+{
+	return dnchannelizer->offset(chan) * CHAN_RATE;
+}
+
+/*
+ * The device runs at full gain and each channel is attenuated digitally,
+ * since one RF gain setting serves all channels.
+ */
+void RadioInterfaceMulti::start(int chan)
+{
+	mTxLock.lock();
+	mRxLock.lock();
+
+	if (!mOn) {
+		startDevice();
+		mRadio->setTxGain(mRadio->maxTxGain());
+		mOn = true;
+		startPipeline();
+	}
+
+	LOG(INFO) << "starting channel " << chan;
+	mChanOn[chan] = true;
+
+	mRxLock.unlock();
+	mTxLock.unlock();
+}
+
+/*
+ * The first tuned channel sets the device center frequency. Every other
+ * channel has to land on the channel grid around that center.
+ */
+static bool tuneChan(double freq, double offset, double *center,
+		     bool (RadioDevice::*set)(double), RadioDevice *radio)
+{
+	double want = freq - offset;
+
+	if (*center == 0.0) {
+		if (!(radio->*set)(want))
+			return false;
+
+		*center = want;
+		return true;
+	}
+
+	if (fabs(want - *center) > 1.0) {
+		LOG(ALARM) << "frequency " << freq << " is off the channel grid"
+			   << " around the device center " << *center;
+		return false;
+	}
+
+	return true;
+}
+
+bool RadioInterfaceMulti::tuneTx(double freq, int chan)
+{
+	return tuneChan(freq, chanOffset(chan), &mTxCenter,
+			&RadioDevice::setTxFreq, mRadio);
+}
+
+bool RadioInterfaceMulti::tuneRx(double freq, int chan)
+{
+	return tuneChan(freq, chanOffset(chan), &mRxCenter,
+			&RadioDevice::setRxFreq, mRadio);
+}
+
+void RadioInterfaceMulti::setPowerAttenuation(double atten, int chan)
+{
+	if (atten < 1.0)
+		mChanScaling[chan] = 1.0;
+	else
+		mChanScaling[chan] = 1.0 / sqrt(pow(10, (atten / 10.0)));
+}
+
+/*
+ * Bursts are placed by their transmit time rather than in arrival order,
+ * because each channel is driven by its own transceiver thread. Positions
+ * are counted from a reference frame that moves along with the buffer.
+ * The channel buffers hold floats for the channelizer, so bursts are
+ * scaled here rather than taken from their device format conversion.
+ */
+void RadioInterfaceMulti::driveTransmitRadio(radioVector &radioBurst,
+					     bool zeroBurst,
+					     const GSM::Time &wTime,
+					     int chan)
+{
+	if (!mOn)
+		return;
+
+	mTxLock.lock();
+
+	if (!txStarted) {
+		txRefFN = wTime.FN();
+		txStart = slotStart(wTime.TN());
+		txStarted = true;
+	}
+
+	int pos = FNDelta(wTime.FN(), txRefFN) * FRAME_LEN +
+		  slotStart(wTime.TN()) - txStart;
+	int len = radioBurst.size();
+
+	if ((pos < 0) || (pos + len > TX_BUF_LEN)) {
+		LOG(NOTICE) << "dropping burst at " << wTime << " on channel "
+			    << chan << ", outside of the transmit window";
+		mTxLock.unlock();
+		return;
+	}
+
+	radioifyVector(radioBurst, txBuffer[chan] + 2 * pos,
+		       mChanScaling[chan], zeroBurst);
+
+	if (pos + len > txFill[chan])
+		txFill[chan] = pos + len;
+
+	pushBuffer();
+
+	mTxLock.unlock();
+}
+
+/* Send chunks to the device once every started channel has filled one */
+void RadioInterfaceMulti::pushBuffer()
+{
+	int M = upchannelizer->size();
+	int num_wr;
+
+	while (true) {
+		for (int i = 0; i < mChans; i++) {
+			if (mChanOn[i] && (txFill[i] < INCHUNK))
+				return;
+		}
+
+		for (int i = 0; i < mChans; i++) {
+			if (!upsampler[i]->write(txBuffer[i], INCHUNK)) {
+				LOG(ERROR) << "Tx resampler input overflow";
+				return;
+			}
+			upsampler[i]->read(chanBuffer[i]);
+		}
+
+		upchannelizer->rotate(chanBuffer, OUTCHUNK, wideBuffer);
+
+		convertFloatToShort(deviceBuffer, wideBuffer, 1.0f,
+				    M * OUTCHUNK);
+
+		if (mTxCapture)
+			mTxCapture->record(deviceBuffer, M * OUTCHUNK, writeTimestamp);
+
+		/* Write samples. Fail if we don't get what we want. */
+		num_wr = mRadio->writeSamples(deviceBuffer, M * OUTCHUNK,
+					      &underrun, writeTimestamp);
+
+		LOG(DEEPDEBUG) << "Tx wrote " << num_wr << " samples to device";
+		assert(num_wr == M * OUTCHUNK);
+
+		writeTimestamp += (TIMESTAMP) num_wr;
+
+		for (int i = 0; i < mChans; i++) {
+			memmove(txBuffer[i], txBuffer[i] + 2 * INCHUNK,
+				2 * (TX_BUF_LEN - INCHUNK) * sizeof(float));
+			memset(txBuffer[i] + 2 * (TX_BUF_LEN - INCHUNK), 0,
+			       2 * INCHUNK * sizeof(float));
+
+			txFill[i] -= INCHUNK;
+			if (txFill[i] < 0)
+				txFill[i] = 0;
+		}
+
+		txStart += INCHUNK;
+		while (txStart >= FRAME_LEN) {
+			txStart -= FRAME_LEN;
+			txRefFN = (txRefFN + 1) % gHyperframe;
+		}
+	}
+}
+
+/* Receive a chunk from the device and split it into channels */
+void RadioInterfaceMulti::pullBuffer()
+{
+	readChunk(deviceBuffer);
+	convertChunk(deviceBuffer);
+}
+
+int RadioInterfaceMulti::rxChunkSize()
+{
+	return dnchannelizer->size() * OUTCHUNK;
+}
+
+/* Split a device read into the channels, at the GSM rate */
+void RadioInterfaceMulti::convertChunk(short *buf)
+{
+	int M = dnchannelizer->size();
+	int num_cv = 0;
+
+	convertShortToFloat(wideBuffer, buf, 1.0f, M * OUTCHUNK);
+
+	dnchannelizer->rotate(wideBuffer, OUTCHUNK, chanBuffer);
+
+	/* Channels stay in step, so all share the receive cursor */
+	for (int i = 0; i < mChans; i++) {
+		if (!dnsampler[i]->write(chanBuffer[i], OUTCHUNK)) {
+			LOG(ERROR) << "Rx resampler input overflow";
+			return;
+		}
+		num_cv = dnsampler[i]->read(rxBuffer[i] + 2 * rcvCursor);
+	}
+
+	rcvCursor += num_cv;
+}
+
+void RadioInterfaceMulti::driveReceiveRadio(int chan)
+{
+	if (!mOn)
+		return;
+
+	/* The pipeline threads frame the bursts, wait for them */
+	if (mPipelined) {
+		mReceiveFIFOs[chan].wait(RX_PIPELINE_WAIT);
+		return;
+	}
+
+	mRxLock.lock();
+
+	if (mReceiveFIFOs[chan].size() > 8) {
+		mRxLock.unlock();
+		return;
+	}
+
+	pullBuffer();
+	frameBursts();
+
+	mRxLock.unlock();
+}
+
+void RadioInterfaceMulti::frameBursts()
+{
+	GSM::Time rcvClock = mClock.get();
+	rcvClock.decTN(receiveOffset);
+	unsigned tN = rcvClock.TN();
+	int rcvSz = rcvCursor;
+	int readSz = 0;
+	const int symbolsPerSlot = gSlotLen + 8;
+	int slotLen = (symbolsPerSlot + (tN % 4 == 0)) * samplesPerSymbol;
+
+	/* Frame the bursts of all started channels at once */
+	while (rcvSz - readSz > slotLen) {
+		if (rcvClock.FN() >= 0) {
+			for (int i = 0; i < mChans; i++) {
+				if (!mChanOn[i] ||
+				    !mReceiveFIFOs[i].wanted(rcvClock))
+					continue;
+
+				radioVector *rxBurst =
+					new radioVector(slotLen, rcvClock);
+				unRadioifyVector(rxBuffer[i] + 2 * readSz,
+						 *rxBurst);
+				mReceiveFIFOs[i].put(rxBurst);
+			}
+		}
+		mClock.incTN();
+		rcvClock.incTN();
+
+		readSz += slotLen;
+		tN = rcvClock.TN();
+		slotLen = (symbolsPerSlot + (tN % 4 == 0)) * samplesPerSymbol;
+	}
+
+	if (readSz > 0) {
+		rcvCursor -= readSz;
+		for (int i = 0; i < mChans; i++) {
+			memmove(rxBuffer[i], rxBuffer[i] + 2 * readSz,
+				2 * rcvCursor * sizeof(float));
+		}
+	}
+}
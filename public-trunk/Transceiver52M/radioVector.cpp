@@ -19,11 +19,152 @@
  * See the COPYING file in the main directory for details.
  */
 
+#include <new>
+#include <string.h>
+#include <assert.h>
+
 #include "radioVector.h"
+#include "vectorPool.h"
+#include "convert.h"
+
+/* Pools live for the life of the process, since bursts may remain in
+ * queues and the filler table at shutdown */
+static VectorPool *vectorPool = NULL;
+static VectorPool *samplePool = NULL;
+static VectorPool *fixedPool = NULL;
+
+void radioVector::initPools(size_t maxSize, int numVectors)
+{
+	if (vectorPool)
+		return;
+
+	vectorPool = new VectorPool(sizeof(radioVector), numVectors);
+	samplePool = new VectorPool(maxSize * sizeof(complex), numVectors);
+	fixedPool = new VectorPool(maxSize * 2 * sizeof(short), numVectors);
+}
+
+void *radioVector::operator new(size_t size)
+{
+	void *ptr;
+
+	if (vectorPool)
+		ptr = vectorPool->alloc(size);
+	else
+		ptr = VectorPool::heapAlloc(size);
+
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void radioVector::operator delete(void *ptr)
+{
+	if (vectorPool)
+		vectorPool->release(ptr);
+	else
+		VectorPool::heapRelease(ptr);
+}
+
+complex *radioVector::allocSamples(size_t size)
+{
+	void *ptr;
+
+	if (samplePool)
+		ptr = samplePool->alloc(size * sizeof(complex));
+	else
+		ptr = VectorPool::heapAlloc(size * sizeof(complex));
+
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return (complex *) ptr;
+}
+
+short *radioVector::allocFixed(size_t size)
+{
+	void *ptr;
+
+	if (fixedPool)
+		ptr = fixedPool->alloc(size * 2 * sizeof(short));
+	else
+		ptr = VectorPool::heapAlloc(size * 2 * sizeof(short));
+
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return (short *) ptr;
+}
+
+#ifdef FIXED_POINT
+short *radioVector::fixed()
+{
+	if (!mFixed)
+		mFixed = allocFixed(size());
+
+	return mFixed;
+}
+
+void radioVector::unpack()
+{
+	if (mFixed)
+		convertShortToFloat((float *) begin(), mFixed, 1.0f, size());
+}
+#endif
+
+const short *radioVector::txSamples(unsigned setting) const
+{
+	if (!mFixed || (mTxSetting != setting))
+		return NULL;
+
+	return mFixed;
+}
+
+short *radioVector::newTxSamples(unsigned setting)
+{
+	if (!mFixed)
+		mFixed = allocFixed(size());
+
+	mTxSetting = setting;
+	return mFixed;
+}
+
+bool radioVector::markSent(unsigned setting)
+{
+	bool repeat = (mTxSent == setting);
+	mTxSent = setting;
+	return repeat;
+}
+
+radioVector::radioVector(const signalVector& wVector, const GSM::Time& wTime)
+	: signalVector(allocSamples(wVector.size()), 0, wVector.size()),
+	  mTime(wTime), mFixed(NULL), mTxSetting(0), mTxSent(0)
+{
+	mBlock = begin();
+	wVector.copyTo(*this);
+	setSymmetry(wVector.getSymmetry());
+}
 
-radioVector::radioVector(const signalVector& wVector, GSM::Time& wTime)
-	: signalVector(wVector), mTime(wTime)
+radioVector::radioVector(size_t size, const GSM::Time& wTime)
+	: signalVector(allocSamples(size), 0, size), mTime(wTime),
+	  mFixed(NULL), mTxSetting(0), mTxSent(0)
 {
+	mBlock = begin();
+}
+
+radioVector::~radioVector()
+{
+	if (samplePool)
+		samplePool->release(mBlock);
+	else
+		VectorPool::heapRelease(mBlock);
+
+	if (!mFixed)
+		return;
+	if (fixedPool)
+		fixedPool->release(mFixed);
+	else
+		VectorPool::heapRelease(mFixed);
 }
 
 GSM::Time radioVector::getTime() const
@@ -41,69 +182,357 @@ bool radioVector::operator>(const radioVector& other) const
 	return mTime > other.mTime;
 }
 
+/* Timeslots from 'b' to 'a' */
+static int slotDelta(const GSM::Time &a, const GSM::Time &b)
+{
+	return FNDelta(a.FN(), b.FN()) * 8 + (int) a.TN() - (int) b.TN();
+}
+
+VectorFIFO::VectorFIFO(unsigned maxSize, unsigned maxAge)
+	: mHead(0), mSize(0), mMaxSize(maxSize), mMaxAge(maxAge),
+	  mClassifier(NULL), mClassifierArg(NULL),
+	  mFilter(NULL), mFilterArg(NULL)
+{
+	mQ = new Entry[mMaxSize];
+	memset(&mStats, 0, sizeof(mStats));
+}
+
+VectorFIFO::~VectorFIFO()
+{
+	for (unsigned i = 0; i < mSize; i++)
+		delete at(i).vec;
+
+	delete[] mQ;
+}
+
+void VectorFIFO::setClassifier(Classifier fn, void *arg)
+{
+	mLock.lock();
+	mClassifier = fn;
+	mClassifierArg = arg;
+	mLock.unlock();
+}
+
+void VectorFIFO::setFilter(Filter fn, void *arg)
+{
+	mLock.lock();
+	mFilter = fn;
+	mFilterArg = arg;
+	mLock.unlock();
+}
+
+bool VectorFIFO::wanted(const GSM::Time &wTime)
+{
+	mLock.lock();
+	bool want = !mFilter || mFilter(wTime, mFilterArg);
+	mLock.unlock();
+
+	return want;
+}
+
 unsigned VectorFIFO::size()
 {
-	return mQ.size();
+	mLock.lock();
+	unsigned size = mSize;
+	mLock.unlock();
+
+	return size;
+}
+
+/* Close the gap left by entry i, keeping the order of the rest */
+void VectorFIFO::remove(unsigned i)
+{
+	for (; i + 1 < mSize; i++)
+		at(i) = at(i + 1);
+
+	mSize--;
+}
+
+unsigned VectorFIFO::age(const GSM::Time &wTime)
+{
+	int slots = slotDelta(mNewest, wTime);
+
+	return (slots > 0) ? slots : 0;
 }
 
 void VectorFIFO::put(radioVector *ptr)
 {
-	mQ.put((void*) ptr);
+	Entry entry;
+
+	mLock.lock();
+
+	entry.vec = ptr;
+	if (mClassifier)
+		entry.prio = mClassifier(ptr->getTime(), mClassifierArg);
+	else
+		entry.prio = TRAFFIC_BURST;
+
+	if (!mSize || (ptr->getTime() > mNewest))
+		mNewest = ptr->getTime();
+
+	if (mSize == mMaxSize) {
+		unsigned victim = mSize;
+		for (unsigned i = 0; i < mSize; i++) {
+			if (at(i).prio > entry.prio)
+				continue;
+			if ((victim == mSize) || (at(i).prio < at(victim).prio))
+				victim = i;
+		}
+
+		if (victim == mSize) {
+			mStats.shed[entry.prio]++;
+			mLock.unlock();
+			delete ptr;
+			return;
+		}
+
+		radioVector *shed = at(victim).vec;
+		mStats.shed[at(victim).prio]++;
+		remove(victim);
+		delete shed;
+	}
+
+	at(mSize++) = entry;
+	if (mSize > mStats.maxDepth)
+		mStats.maxDepth = mSize;
+
+	mPutSignal.signal();
+	mLock.unlock();
+}
+
+void VectorFIFO::wait(unsigned timeout)
+{
+	mLock.lock();
+	if (!mSize)
+		mPutSignal.wait(mLock, timeout);
+	mLock.unlock();
 }
 
 radioVector *VectorFIFO::get()
 {
-	return (radioVector*) mQ.get();
+	radioVector *ptr = NULL;
+
+	mLock.lock();
+
+	while (mSize) {
+		Entry entry = at(0);
+		unsigned slots = age(entry.vec->getTime());
+
+		mHead = (mHead + 1) % mMaxSize;
+		mSize--;
+
+		if ((slots > mMaxAge) && (entry.prio < CONTROL_BURST)) {
+			mStats.stale++;
+			delete entry.vec;
+			continue;
+		}
+
+		mStats.lastAge = slots;
+		if (slots > mStats.maxAge)
+			mStats.maxAge = slots;
+		mStats.totalAge += slots;
+		mStats.dequeued++;
+
+		ptr = entry.vec;
+		break;
+	}
+
+	mLock.unlock();
+
+	return ptr;
 }
 
-GSM::Time VectorQueue::nextTime() const
+VectorFIFOStats VectorFIFO::stats(bool restart)
 {
-	GSM::Time retVal;
 	mLock.lock();
 
-	while (mQ.size()==0)
-		mWriteSignal.wait(mLock);
+	mStats.depth = mSize;
+	VectorFIFOStats stats = mStats;
+
+	if (restart) {
+		mStats.maxDepth = mSize;
+		mStats.maxAge = 0;
+		mStats.totalAge = 0;
+		mStats.dequeued = 0;
+	}
 
-	retVal = mQ.top()->getTime();
 	mLock.unlock();
 
-	return retVal;
+	return stats;
 }
 
-radioVector* VectorQueue::getStaleBurst(const GSM::Time& targTime)
+VectorQueue::VectorQueue(int window)
+	: mNumSlots(window * 8), mSize(0), mStarted(false)
+{
+	assert(!(gHyperframe % window));
+
+	mSlots = new radioVector *[mNumSlots];
+	for (int i = 0; i < mNumSlots; i++)
+		mSlots[i] = NULL;
+
+	memset(&mStats, 0, sizeof(mStats));
+}
+
+VectorQueue::~VectorQueue()
+{
+	flush();
+	delete[] mSlots;
+}
+
+int VectorQueue::index(const GSM::Time &wTime)
+{
+	return (wTime.FN() * 8 + wTime.TN()) % mNumSlots;
+}
+
+void VectorQueue::flush()
+{
+	for (int i = 0; i < mNumSlots; i++) {
+		delete mSlots[i];
+		mSlots[i] = NULL;
+	}
+
+	while (radioVector *ptr = (radioVector *) mStale.get())
+		delete ptr;
+
+	mSize = 0;
+}
+
+void VectorQueue::clear()
 {
 	mLock.lock();
-	if ((mQ.size()==0)) {
-		mLock.unlock();
-		return NULL;
+	flush();
+	mLock.unlock();
+}
+
+void VectorQueue::reset(const GSM::Time &wTime)
+{
+	mLock.lock();
+	flush();
+	mNext = wTime;
+	mStarted = true;
+	mLock.unlock();
+}
+
+size_t VectorQueue::size()
+{
+	mLock.lock();
+	size_t size = mSize;
+	mLock.unlock();
+
+	return size;
+}
+
+/*
+ * Move the sweep point up to 'targTime', handing bursts of the slots that
+ * were passed over to the stale list. No more than one window of slots is
+ * visited however far the sweep point moves.
+ */
+void VectorQueue::advance(const GSM::Time &targTime)
+{
+	if (!mStarted) {
+		mNext = targTime;
+		mStarted = true;
+		return;
+	}
+
+	int num = slotDelta(targTime, mNext);
+	if (num > mNumSlots)
+		num = mNumSlots;
+
+	for (int i = 0; i < num; i++) {
+		radioVector *ptr = mSlots[index(mNext)];
+
+		if (ptr) {
+			mSlots[index(mNext)] = NULL;
+			mStale.put(ptr);
+		}
+
+		mNext.incTN();
+	}
+
+	if (mNext < targTime)
+		mNext = targTime;
+}
+
+void VectorQueue::write(radioVector *ptr)
+{
+	GSM::Time wTime = ptr->getTime();
+
+	mLock.lock();
+
+	if (!mStarted) {
+		mNext = wTime;
+		mStarted = true;
+	}
+
+	int ahead = slotDelta(wTime, mNext);
+
+	if (ahead < 0) {
+		mStats.late++;
+		mStale.put(ptr);
+		mSize++;
+	} else if (ahead >= mNumSlots) {
+		mStats.dropped++;
+		delete ptr;
+	} else {
+		radioVector **slot = &mSlots[index(wTime)];
+
+		if (*slot) {
+			mStats.dropped++;
+			delete *slot;
+		} else {
+			mSize++;
+		}
+
+		*slot = ptr;
 	}
 
-	if (mQ.top()->getTime() < targTime) {
-		radioVector* retVal = mQ.top();
-		mQ.pop();
-		mLock.unlock();
-		return retVal;
+	mLock.unlock();
+}
+
+radioVector* VectorQueue::getStaleBurst(const GSM::Time& targTime)
+{
+	mLock.lock();
+
+	advance(targTime);
+
+	radioVector *ptr = (radioVector *) mStale.get();
+	if (ptr) {
+		mStats.stale++;
+		mSize--;
 	}
+
 	mLock.unlock();
 
-	return NULL;
+	return ptr;
 }
 
 radioVector* VectorQueue::getCurrentBurst(const GSM::Time& targTime)
 {
 	mLock.lock();
-	if ((mQ.size()==0)) {
-		mLock.unlock();
-		return NULL;
-	}
 
-	if (mQ.top()->getTime() == targTime) {
-		radioVector* retVal = mQ.top();
-		mQ.pop();
-		mLock.unlock();
-		return retVal;
+	advance(targTime);
+
+	radioVector **slot = &mSlots[index(targTime)];
+	radioVector *ptr = *slot;
+
+	if (ptr && (ptr->getTime() == targTime)) {
+		*slot = NULL;
+		mSize--;
+	} else {
+		ptr = NULL;
 	}
+
+	mLock.unlock();
+
+	return ptr;
+}
+
+VectorQueueStats VectorQueue::stats()
+{
+	mLock.lock();
+	VectorQueueStats stats = mStats;
 	mLock.unlock();
 
-	return NULL;
+	return stats;
 }
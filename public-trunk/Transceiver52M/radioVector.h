@@ -22,35 +22,255 @@
 #ifndef RADIOVECTOR_H
 #define RADIOVECTOR_H
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "sigProcLib.h"
 #include "GSMCommon.h"
 
+/*
+    radioVector - Timestamped burst. Both the object and its samples come
+                  from fixed pools once initPools() has been called, so
+                  bursts can be created and deleted per timeslot without
+                  touching the heap. Bursts are handed between queues and
+                  the filler table by pointer; ownership moves with the
+                  pointer and samples are never copied.
+
+                  A burst also holds its samples in the device format:
+                  received samples in a fixed-point build, or the transmit
+                  conversion of a burst that is sent more than once, such
+                  as a filler burst.
+*/
 class radioVector : public signalVector {
 public:
-	radioVector(const signalVector& wVector, GSM::Time& wTime);
+	radioVector(const signalVector& wVector, const GSM::Time& wTime);
+
+	/** Build a burst of 'size' samples, left uninitialized */
+	radioVector(size_t size, const GSM::Time& wTime);
+	~radioVector();
+
 	GSM::Time getTime() const;
 	void setTime(const GSM::Time& wTime);
 	bool operator>(const radioVector& other) const;
 
+	/** Object storage from the vector pool */
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr);
+
+	/** Create the pools, must be called before any threads start
+	    @param maxSize largest burst in samples
+	    @param numVectors number of bursts held by the pools
+	*/
+	static void initPools(size_t maxSize, int numVectors);
+
+#ifdef FIXED_POINT
+	/** Samples in the device format, allocated on first use. Received
+	    bursts are filled here, and the complex samples are only valid
+	    once unpack() has been called */
+	short *fixed();
+
+	/** Convert the device format samples into the complex samples */
+	void unpack();
+#endif
+
+	/** Transmit samples in the device format, converted at power
+	    setting 'setting' of the radio interface, or NULL if the burst
+	    has not been converted at that setting */
+	const short *txSamples(unsigned setting) const;
+
+	/** Storage for the transmit samples of power setting 'setting',
+	    to be filled by the caller; 'setting' must not be zero */
+	short *newTxSamples(unsigned setting);
+
+	/** Record a transmission at power setting 'setting', true if the
+	    burst was last sent at that setting too */
+	bool markSent(unsigned setting);
+
 private:
 	GSM::Time mTime;
+	complex *mBlock;
+
+	static complex *allocSamples(size_t size);
+
+	short *mFixed;			///< device format samples, or NULL
+	unsigned mTxSetting;		///< power setting of mFixed, zero if received
+	unsigned mTxSent;		///< power setting of the last transmission, zero if never sent
+
+	static short *allocFixed(size_t size);
+
+	/* Disable copies, the pool blocks must not be shared */
+	radioVector(const radioVector &other);
+	radioVector &operator=(const radioVector &other);
+};
+
+/* Receive FIFO capacity in bursts */
+#define VECTORFIFO_MAX_SIZE	64
+
+/* Age in timeslots after which bursts below control priority are stale */
+#define VECTORFIFO_MAX_AGE	32
+
+/** Value of a received burst to the GSM core, lowest is shed first */
+enum burstPriority {
+	IDLE_BURST,		///< idle or unused slot
+	TRAFFIC_BURST,		///< TCH, including stolen FACCH
+	CONTROL_BURST,		///< RACH, SACCH and dedicated control
+	NUM_BURST_PRIORITIES
+};
+
+/** Receive FIFO counters */
+struct VectorFIFOStats {
+	unsigned depth;			///< bursts queued now
+	unsigned maxDepth;		///< largest depth seen
+	unsigned lastAge;		///< age of the last dequeued burst in timeslots
+	unsigned maxAge;		///< largest age at dequeue
+	unsigned long long totalAge;	///< sum of ages at dequeue
+	unsigned long dequeued;		///< bursts handed to the consumer
+	unsigned long shed[NUM_BURST_PRIORITIES]; ///< bursts dropped when full
+	unsigned long stale;		///< bursts dropped as stale at dequeue
 };
 
+/*
+    VectorFIFO - Bounded receive burst FIFO. Locked, since a multi-carrier
+                 radio interface fills the FIFOs of all channels from
+                 whichever channel thread is pulling samples.
+
+                 The consumer classifies bursts by their time through
+                 setClassifier(). When the FIFO is full, the oldest burst
+                 of the lowest priority makes room, or the new burst is
+                 dropped if nothing queued is worth less. At dequeue,
+                 bursts below control priority that trail the newest
+                 burst by more than the maximum age are dropped, so a
+                 consumer that fell behind catches up instead of working
+                 through late bursts. Age is counted in timeslots from
+                 the newest queued burst.
+
+                 Producers ask wanted() before building a burst, so that
+                 bursts the consumer would throw away are never converted
+                 or queued. The consumer decides through setFilter().
+*/
 class VectorFIFO {
 public:
+	typedef enum burstPriority (*Classifier)(const GSM::Time &wTime,
+						 void *arg);
+	typedef bool (*Filter)(const GSM::Time &wTime, void *arg);
+
+	VectorFIFO(unsigned maxSize = VECTORFIFO_MAX_SIZE,
+		   unsigned maxAge = VECTORFIFO_MAX_AGE);
+	~VectorFIFO();
+
+	/** Set the burst classifier, bursts are of traffic priority without one */
+	void setClassifier(Classifier fn, void *arg);
+
+	/** Set the burst filter, all bursts are wanted without one */
+	void setFilter(Filter fn, void *arg);
+
+	/** Whether the consumer wants the burst of 'wTime' built at all */
+	bool wanted(const GSM::Time &wTime);
+
 	unsigned size();
+
+	/** Queue a burst, the FIFO takes ownership even if the burst is shed */
 	void put(radioVector *ptr);
+
+	/** Dequeue the oldest burst that is not stale, NULL if none */
 	radioVector *get();
 
+	/** Wait up to 'timeout' milliseconds for the FIFO to hold a burst */
+	void wait(unsigned timeout);
+
+	/** Return the counters, optionally restarting the maximums and totals */
+	VectorFIFOStats stats(bool restart = false);
+
 private:
-	PointerFIFO mQ;
+	struct Entry {
+		radioVector *vec;
+		enum burstPriority prio;
+	};
+
+	Entry *mQ;
+	unsigned mHead;
+	unsigned mSize;
+	unsigned mMaxSize;
+	unsigned mMaxAge;
+
+	Classifier mClassifier;
+	void *mClassifierArg;
+	Filter mFilter;
+	void *mFilterArg;
+
+	GSM::Time mNewest;
+	VectorFIFOStats mStats;
+
+	Mutex mLock;
+	Signal mPutSignal;
+
+	Entry &at(unsigned i) { return mQ[(mHead + i) % mMaxSize]; }
+	void remove(unsigned i);
+	unsigned age(const GSM::Time &wTime);
+};
+
+/* Transmit look-ahead window in frames, a power of two dividing the hyperframe */
+#define VECTORQUEUE_WINDOW	64
+
+/** Transmit queue counters */
+struct VectorQueueStats {
+	unsigned long late;		///< bursts written after their slot was swept
+	unsigned long dropped;		///< bursts beyond the window or replaced
+	unsigned long stale;		///< bursts returned by getStaleBurst()
 };
 
-class VectorQueue : public InterthreadPriorityQueue<radioVector> {
+/*
+    VectorQueue - Transmit burst calendar. Each timeslot of a window of
+                  frames has one entry, indexed by frame number modulo the
+                  window and timeslot, so writes and reads of the current
+                  slot take constant time. A sweep point follows the
+                  reader; bursts for slots that were passed over, or that
+                  arrive after their slot was swept, are returned by
+                  getStaleBurst(). Bursts past the end of the window are
+                  dropped, and a second burst for a slot replaces the
+                  first.
+*/
+class VectorQueue {
 public:
-	GSM::Time nextTime() const;
+	VectorQueue(int window = VECTORQUEUE_WINDOW);
+	~VectorQueue();
+
+	/** Queue a burst, the queue takes ownership even if the burst is dropped */
+	void write(radioVector *ptr);
+
+	/** Delete all bursts */
+	void clear();
+
+	/** Delete all bursts and start the sweep at the given time */
+	void reset(const GSM::Time &wTime);
+
+	size_t size();
+
+	/** Return a burst for a slot before 'targTime', NULL if none */
 	radioVector* getStaleBurst(const GSM::Time& targTime);
+
+	/** Return the burst for 'targTime', NULL if none */
 	radioVector* getCurrentBurst(const GSM::Time& targTime);
+
+	VectorQueueStats stats();
+
+private:
+	radioVector **mSlots;
+	int mNumSlots;
+	size_t mSize;
+
+	PointerFIFO mStale;
+	GSM::Time mNext;
+	bool mStarted;
+
+	VectorQueueStats mStats;
+
+	Mutex mLock;
+
+	int index(const GSM::Time &wTime);
+	void advance(const GSM::Time &targTime);
+	void flush();
 };
 
 #endif /* RADIOVECTOR_H */
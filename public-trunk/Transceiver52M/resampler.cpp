@@ -0,0 +1,197 @@
+/*
+ * Streaming polyphase resampler
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "resampler.h"
+#include "convolve.h"
+#include "convert.h"
+#include "sigProcLib.h"
+
+/* Number of chunks the input buffer holds beyond the history */
+#define RESAMP_MAX_CHUNKS	4
+
+/* Alignment of the filter bank and sample buffer in bytes */
+#define RESAMP_ALIGN		32
+
+static float *alloc_aligned(size_t num_floats)
+{
+	void *ptr;
+
+	if (posix_memalign(&ptr, RESAMP_ALIGN, num_floats * sizeof(float)))
+		return NULL;
+
+	memset(ptr, 0, num_floats * sizeof(float));
+	return (float *) ptr;
+}
+
+PolyphaseResampler::PolyphaseResampler(int wP, int wQ, int filterLen,
+				       int chunkLen, int histLen)
+	: P(wP), Q(wQ), chunk_len(chunkLen), hist_len(histLen),
+	  buf_cnt(0), bank(NULL), buf(NULL)
+{
+	/* Chunks and history must map to a whole number of output samples */
+	assert(!((chunk_len * P) % Q));
+	assert(!((hist_len * P) % Q));
+
+	/* Output alignment used by polyphaseResampleVector() */
+	delay = (filterLen - 1) / 2 / Q;
+
+	initBank(filterLen);
+	assert(hist_len >= branch_len);
+
+	buf_len = hist_len + RESAMP_MAX_CHUNKS * chunk_len;
+	buf = alloc_aligned(2 * buf_len);
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+	free(bank);
+	free(buf);
+}
+
+/*
+ * Split the prototype filter into P branches. Branch taps are stored in
+ * reverse so that each output is a dot product over ascending input
+ * samples. Each branch is padded at the oldest end to a multiple of four
+ * taps, and every tap is duplicated to match interleaved complex input.
+ */
+void PolyphaseResampler::initBank(int filterLen)
+{
+	float cutoff = (P < Q) ? (1.0 / (float) Q) : (1.0 / (float) P);
+	signalVector *lpf = createLPF(cutoff, filterLen, P);
+
+	branch_len = (filterLen + P - 1) / P;
+	branch_len = (branch_len + 3) & ~3;
+
+	bank = alloc_aligned(2 * P * branch_len);
+
+	for (int n = 0; n < P; n++) {
+		float *branch = bank + 2 * n * branch_len;
+
+		for (int k = 0; k < branch_len; k++) {
+			int i = branch_len - 1 - k;
+
+			if (n + k * P >= filterLen)
+				continue;
+
+			branch[2 * i + 0] = (*lpf)[n + k * P].real();
+			branch[2 * i + 1] = (*lpf)[n + k * P].real();
+		}
+	}
+
+	delete lpf;
+}
+
+void PolyphaseResampler::reset()
+{
+	memset(buf, 0, 2 * buf_len * sizeof(float));
+	buf_cnt = 0;
+}
+
+int PolyphaseResampler::outputLen() const
+{
+	return RESAMP_MAX_CHUNKS * chunk_len * P / Q;
+}
+
+bool PolyphaseResampler::write(const short *in, int len)
+{
+	if (hist_len + buf_cnt + len > buf_len)
+		return false;
+
+	convertShortToFloat(buf + 2 * (hist_len + buf_cnt), in, 1.0f, len);
+
+	buf_cnt += len;
+	return true;
+}
+
+bool PolyphaseResampler::write(const float *in, int len)
+{
+	if (hist_len + buf_cnt + len > buf_len)
+		return false;
+
+	memcpy(buf + 2 * (hist_len + buf_cnt), in, 2 * len * sizeof(float));
+
+	buf_cnt += len;
+	return true;
+}
+
+int PolyphaseResampler::read(float *out)
+{
+	return resample(out);
+}
+
+int PolyphaseResampler::read(short *out)
+{
+	return resample(out);
+}
+
+/*
+ * Output sample n draws from input samples up to floor(n * Q / P) through
+ * filter branch (n * Q) mod P. Outputs near the end of the converted data
+ * use only the input that exists, as the one-shot resampler does.
+ */
+template <typename T> int PolyphaseResampler::resample(T *out)
+{
+	float sum[2];
+	int num_chunks = buf_cnt / chunk_len;
+	if (num_chunks < 1)
+		return 0;
+
+	int in_end = hist_len + num_chunks * chunk_len;
+	int num_out = num_chunks * chunk_len * P / Q;
+
+	int n = hist_len * P / Q + delay;
+	int branch = (n * Q) % P;
+	int offset = (n * Q) / P;
+
+	for (int i = 0; i < num_out; i++) {
+		int start = offset - branch_len + 1;
+		int len = in_end - start;
+		if (len > branch_len)
+			len = branch_len;
+
+		if (len > 0) {
+			convolveDotReal(sum, buf + 2 * start,
+					bank + 2 * branch * branch_len, len);
+		} else {
+			sum[0] = sum[1] = 0.0f;
+		}
+
+		out[2 * i + 0] = (T) sum[0];
+		out[2 * i + 1] = (T) sum[1];
+
+		branch += Q;
+		while (branch >= P) {
+			branch -= P;
+			offset++;
+		}
+	}
+
+	/* Keep history and any partial chunk at the front of the buffer */
+	int remain = buf_cnt - num_chunks * chunk_len;
+	memmove(buf, buf + 2 * (in_end - hist_len),
+		2 * (hist_len + remain) * sizeof(float));
+	buf_cnt = remain;
+
+	return num_out;
+}
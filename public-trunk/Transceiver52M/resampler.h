@@ -0,0 +1,89 @@
+/*
+ * Streaming polyphase resampler
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+/*
+    PolyphaseResampler - Rational P/Q sample rate conversion of a continuous
+                         stream of interleaved complex samples. Input is
+                         accepted in arbitrary amounts and converted in
+                         fixed size chunks, with filter history carried
+                         between chunks. All buffers are allocated once at
+                         construction.
+
+                         Each output sample is aligned the same way as
+                         polyphaseResampleVector() aligns it when run over
+                         the history followed by the chunk.
+*/
+class PolyphaseResampler {
+public:
+	/** Resampler constructor
+	    @param P numerator, i.e. the amount of upsampling
+	    @param Q denominator, i.e. the amount of downsampling
+	    @param filterLen number of taps of the prototype low-pass filter
+	    @param chunkLen number of input samples converted at a time
+	    @param histLen number of input samples of history
+	*/
+	PolyphaseResampler(int P, int Q, int filterLen,
+			   int chunkLen, int histLen);
+	~PolyphaseResampler();
+
+	/** Buffer input samples
+	    @param in interleaved complex input samples
+	    @param len number of complex samples
+	    @return false if the samples do not fit in the input buffer
+	*/
+	bool write(const short *in, int len);
+	bool write(const float *in, int len);
+
+	/** Convert all complete chunks of buffered input
+	    @param out interleaved complex output buffer, which must hold
+	               outputLen() samples
+	    @return number of complex output samples
+	*/
+	int read(float *out);
+	int read(short *out);
+
+	/** Largest number of samples a single read can return */
+	int outputLen() const;
+
+	/** Reset filter history and drop buffered input */
+	void reset();
+
+private:
+	int P, Q;
+	int chunk_len, hist_len;
+	int buf_len, buf_cnt;
+	int delay;
+
+	/* Filter bank, one reversed branch of 'branch_len' taps per phase */
+	float *bank;
+	int branch_len;
+
+	/* History followed by pending input samples */
+	float *buf;
+
+	void initBank(int filterLen);
+
+	template <typename T> int resample(T *out);
+};
+
+#endif /* RESAMPLER_H */
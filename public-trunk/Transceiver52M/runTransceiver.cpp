@@ -26,9 +26,11 @@
 
 #include "Transceiver.h"
 #include "radioDevice.h"
+#include "FileDevice.h"
 
 #include <time.h>
 #include <signal.h>
+#include <unistd.h>
 
 #include <GSMCommon.h>
 #include <Logger.h>
@@ -67,27 +69,99 @@ int main(int argc, char *argv[])
     exit(1);
   }
 
+  // Replace the radio with sample files.
+  string rxFile, txFile;
+  int replayFlags = 0;
+  bool replay = false;
+  // Sample capture for dumps on request or alarm.
+  double captureSecs = 4.0;
+  bool captureTx = false;
+  // Demodulation worker threads per channel.
+  int demodWorkers = 0;
+  // Receive pipeline, with the CPUs of its stages.
+  bool pipeline = false;
+  int stageCPU[NUM_PIPELINE_STAGES];
+  for (int i = 0; i < NUM_PIPELINE_STAGES; i++) stageCPU[i] = -1;
+  int opt;
+  while ((opt = getopt(argc,argv,"r:w:lfc:td:pa:")) != -1) {
+    switch (opt) {
+      case 'p': pipeline = true; break;
+      case 'a': {
+        char *cpus = optarg;
+        for (int i = 0; (i < NUM_PIPELINE_STAGES) && *cpus; i++) {
+          if (*cpus != ',') stageCPU[i] = strtol(cpus,&cpus,10);
+          if (*cpus == ',') cpus++;
+        }
+        break;
+      }
+      case 'c': captureSecs = atof(optarg); break;
+      case 'd': demodWorkers = atoi(optarg); break;
+      case 't': captureTx = true; break;
+      case 'r': rxFile = optarg; replay = true; break;
+      case 'w': txFile = optarg; replay = true; break;
+      case 'l': replayFlags |= FileDevice::REPLAY_LOOP; break;
+      case 'f': replayFlags |= FileDevice::REPLAY_FAST; break;
+      default: argc = 0;
+    }
+  }
+  argv[optind-1] = argv[0];
+  argc -= optind - 1;
+  argv += optind - 1;
+
   // Configure logger.
   if (argc<2) {
-    cerr << argv[0] << " <logLevel> [logFilePath]" << endl;
+    cerr << argv[0] << " [-r rxFile] [-w txFile] [-l] [-f] [-c seconds] [-t] [-d workers] [-p] [-a cpus] <logLevel> [logFilePath [numChannels]]" << endl;
     cerr << "Log levels are ERROR, ALARM, WARN, NOTICE, INFO, DEBUG, DEEPDEBUG" << endl;
+    cerr << "Up to " << CHAN_MAX << " channels, channel i uses control port 5701+2*i" << endl;
+    cerr << "-r and -w replace the radio with receive and transmit sample files," << endl;
+    cerr << "-l loops the receive file and -f replays it as fast as possible" << endl;
+    cerr << "-c keeps the last seconds of receive samples for dumps, 0 to disable," << endl;
+    cerr << "-t keeps transmit samples too" << endl;
+    cerr << "-d demodulates the timeslots of each channel on that many threads, up to " << DEMOD_WORKERS_MAX << endl;
+    cerr << "-p runs receive as a pipeline of device, conversion, demodulation and delivery threads," << endl;
+    cerr << "-a pins them to a comma separated list of CPUs, in that order, empty to leave one unpinned" << endl;
     exit(0);
   }
   gLogInit(argv[1]);
   if (argc>2) gSetLogFile(argv[2]);
 
+  int numChans = 1;
+  if (argc>3) numChans = atoi(argv[3]);
+  if ((numChans < 1) || (numChans > CHAN_MAX)) {
+    cerr << "Number of channels must be between 1 and " << CHAN_MAX << endl;
+    exit(1);
+  }
+
   srandom(time(NULL));
 
-  RadioDevice *usrp = RadioDevice::make(DEVICERATE);
+  // several channels share the device through a channelizer
+  double deviceRate = DEVICERATE;
+  if (numChans > 1) deviceRate = RadioInterfaceMulti::deviceRate(numChans);
+
+  RadioDevice *usrp;
+  if (replay)
+    usrp = new FileDevice(deviceRate,rxFile,txFile,replayFlags);
+  else
+    usrp = RadioDevice::make(deviceRate);
   if (!usrp->open()) {
     //delete usrp;
     return EXIT_FAILURE;
   }
-  RadioInterface* radio = new RadioInterface(usrp,3);
-  Transceiver *trx = new Transceiver(5700,"127.0.0.1",SAMPSPERSYM,GSM::Time(3,0),radio);
-  trx->receiveFIFO(radio->receiveFIFO());
-
-  trx->start();
+  RadioInterface* radio;
+  if (numChans > 1)
+    radio = new RadioInterfaceMulti(usrp,numChans,3);
+  else
+    radio = new RadioInterface(usrp,3);
+  if (captureSecs > 0) radio->enableCapture(captureSecs,captureTx);
+  if (pipeline) radio->pipelineReceive(stageCPU[DEVICE_STAGE],stageCPU[CONVERT_STAGE]);
+
+  for (int i = 0; i < numChans; i++) {
+    Transceiver *trx = new Transceiver(5700,"127.0.0.1",SAMPSPERSYM,GSM::Time(3,0),radio,i);
+    trx->receiveFIFO(radio->receiveFIFO(i));
+    trx->demodWorkers(demodWorkers);
+    if (pipeline) trx->pipeline(stageCPU[DEMOD_STAGE],stageCPU[DELIVERY_STAGE]);
+    trx->start();
+  }
   //int i = 0;
   while(!gbShutdown) { sleep(1); }//i++; if (i==60) break;}
 
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "sampleCapture.h"
+#include "FileDevice.h"
+#include "Logger.h"
+
+SampleCapture::SampleCapture(double rate, double seconds)
+	: mRate(rate), mRing(NULL), mStart(0), mEnd(0), mClaim(0),
+	  mPending(false), mQuit(false), mSeconds(0.0), mDumpThread(65536)
+{
+	mLen = (size_t) (rate * seconds);
+	mMapLen = mLen * 2 * sizeof(short);
+
+	/* Fault the pages in now rather than on the receive path */
+	void *ptr = mmap(NULL, mMapLen, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (ptr == MAP_FAILED) {
+		LOG(ALARM) << "Cannot map sample capture ring: " << strerror(errno);
+		mLen = 0;
+		return;
+	}
+
+	mRing = (short *) ptr;
+	mCopy = new short[2 * mLen];
+
+	mDumpThread.start((void *(*)(void*)) SampleCaptureDumpAdapter, (void *) this);
+}
+
+SampleCapture::~SampleCapture()
+{
+	if (!mRing)
+		return;
+
+	mLock.lock();
+	mQuit = true;
+	mRequest.signal();
+	mLock.unlock();
+	mDumpThread.join();
+
+	munmap(mRing, mMapLen);
+	delete[] mCopy;
+}
+
+void SampleCapture::record(const short *buf, int len, TIMESTAMP timestamp)
+{
+	if (!mLen || (len <= 0))
+		return;
+
+	if ((size_t) len > mLen) {
+		buf += 2 * (len - mLen);
+		timestamp += len - mLen;
+		len = mLen;
+	}
+
+	if (timestamp != mEnd)
+		mStart = timestamp;
+
+	/* Announce the samples about to be overwritten before touching them */
+	mClaim = timestamp + len;
+	__sync_synchronize();
+
+	size_t pos = timestamp % mLen;
+	size_t num = mLen - pos;
+	if (num > (size_t) len)
+		num = len;
+
+	memcpy(&mRing[2 * pos], buf, num * 2 * sizeof(short));
+	if (num < (size_t) len)
+		memcpy(mRing, &buf[2 * num], (len - num) * 2 * sizeof(short));
+
+	__sync_synchronize();
+	mEnd = timestamp + len;
+}
+
+bool SampleCapture::dump(const std::string &path, double seconds)
+{
+	bool ok = false;
+
+	mLock.lock();
+	if (mLen && !mPending) {
+		mPath = path;
+		mSeconds = seconds;
+		mPending = true;
+		mRequest.signal();
+		ok = true;
+	}
+	mLock.unlock();
+
+	return ok;
+}
+
+void SampleCapture::copyRange(short *dst, TIMESTAMP start, size_t len)
+{
+	size_t pos = start % mLen;
+	size_t num = mLen - pos;
+	if (num > len)
+		num = len;
+
+	memcpy(dst, &mRing[2 * pos], num * 2 * sizeof(short));
+	if (num < len)
+		memcpy(&dst[2 * num], mRing, (len - num) * 2 * sizeof(short));
+}
+
+void SampleCapture::writeDump(const std::string &path, double seconds)
+{
+	TIMESTAMP start, end, claim, first;
+	size_t want = (size_t) (seconds * mRate);
+
+	if (!want || (want > mLen))
+		want = mLen;
+
+	end = mEnd;
+	__sync_synchronize();
+	start = mStart;
+
+	if (end - start > want)
+		start = end - want;
+	if (start >= end) {
+		LOG(WARN) << "No samples captured for " << path;
+		return;
+	}
+
+	copyRange(mCopy, start, end - start);
+	first = start;
+
+	/* Drop what the recorder claimed for overwriting during the copy */
+	__sync_synchronize();
+	claim = mClaim;
+	if (claim > start + mLen) {
+		if (claim >= end + mLen) {
+			LOG(WARN) << "Sample capture overrun while dumping " << path;
+			return;
+		}
+		start = claim - mLen;
+	}
+
+	short *smpls = &mCopy[2 * (start - first)];
+	size_t num = end - start;
+
+	IQFileHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = IQFILE_MAGIC;
+	hdr.version = IQFILE_VERSION;
+	hdr.headerLen = sizeof(hdr);
+	hdr.sampleRate = mRate;
+	hdr.timestamp = start;
+
+	FILE *file = fopen(path.c_str(), "wb");
+	if (!file) {
+		LOG(ALARM) << "Cannot open " << path << ": " << strerror(errno);
+		return;
+	}
+
+	if ((fwrite(&hdr, sizeof(hdr), 1, file) != 1) ||
+	    (fwrite(smpls, 2 * sizeof(short), num, file) != num)) {
+		LOG(ALARM) << "Cannot write " << path << ": " << strerror(errno);
+	} else {
+		LOG(NOTICE) << "Dumped " << num << " samples from timestamp "
+			    << start << " to " << path;
+	}
+
+	fclose(file);
+}
+
+void SampleCapture::serviceDumps()
+{
+	mLock.lock();
+
+	while (!mQuit) {
+		if (!mPending) {
+			mRequest.wait(mLock);
+			continue;
+		}
+
+		std::string path = mPath;
+		double seconds = mSeconds;
+
+		mLock.unlock();
+		writeDump(path, seconds);
+		mLock.lock();
+
+		mPending = false;
+	}
+
+	mLock.unlock();
+}
+
+void *SampleCaptureDumpAdapter(SampleCapture *capture)
+{
+	capture->serviceDumps();
+	return NULL;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef SAMPLECAPTURE_H
+#define SAMPLECAPTURE_H
+
+#include <string>
+
+#include "Threads.h"
+#include "radioDevice.h"
+
+/*
+    SampleCapture - Ring of the most recent device samples. Samples are
+                    stored at their timestamp modulo the ring length, so
+                    recording is one or two copies into memory that was
+                    mapped and faulted in up front, with no locking and no
+                    system calls.
+
+                    A dump takes the newest samples, up to the ring length
+                    and back to the last gap in the timestamps, and writes
+                    them as an IQ file that FileDevice can replay. Dumps
+                    are written by a thread of their own, one at a time.
+                    Recording continues during a dump; samples overwritten
+                    while they were copied out are left off the front of
+                    the file.
+*/
+class SampleCapture {
+public:
+	/** Ring of 'seconds' of samples at 'rate' */
+	SampleCapture(double rate, double seconds);
+	~SampleCapture();
+
+	/** Store samples, only one thread may record */
+	void record(const short *buf, int len, TIMESTAMP timestamp);
+
+	/** Start writing up to 'seconds' of the newest samples to 'path'
+	    @return false if a dump is already running
+	*/
+	bool dump(const std::string &path, double seconds);
+
+	double seconds() const { return (double) mLen / mRate; }
+
+private:
+	double mRate;
+	short *mRing;
+	size_t mLen;
+	size_t mMapLen;
+
+	/* Written by the recording thread only */
+	volatile TIMESTAMP mStart;	/* first sample since the last gap */
+	volatile TIMESTAMP mEnd;	/* one past the newest sample */
+	volatile TIMESTAMP mClaim;	/* one past the sample being stored */
+
+	/* Dump request, under the lock */
+	Mutex mLock;
+	Signal mRequest;
+	bool mPending;
+	bool mQuit;
+	std::string mPath;
+	double mSeconds;
+
+	Thread mDumpThread;
+	short *mCopy;
+
+	void copyRange(short *dst, TIMESTAMP start, size_t len);
+	void writeDump(const std::string &path, double seconds);
+	void serviceDumps();
+
+	friend void *SampleCaptureDumpAdapter(SampleCapture *capture);
+};
+
+void *SampleCaptureDumpAdapter(SampleCapture *capture);
+
+#endif /* SAMPLECAPTURE_H */
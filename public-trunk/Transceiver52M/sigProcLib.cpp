@@ -30,20 +30,90 @@
 #include "GSMCommon.h"
 #include "sendLPF_961.h"
 #include "rcvLPF_651.h"
+#include "dspTables.h"
+#include "convolve.h"
+#include "nco.h"
+#include "farrow.h"
+#include "fft.h"
 
 #include <Logger.h>
+#include <pthread.h>
 
 #define TABLESIZE 1024
 
-/** Lookup tables for trigonometric approximation */
-float cosTable[TABLESIZE+1]; // add 1 element for wrap around
-float sinTable[TABLESIZE+1];
+// Lookup tables for trigonometric approximation and the Farrow fit are
+// in dspTables.h, written by genTables for these sizes
+#if (DSPTABLES_TABLESIZE != TABLESIZE) || \
+    (DSPTABLES_FARROW_LEN != FARROW_LEN) || \
+    (DSPTABLES_FARROW_ORDER != FARROW_ORDER)
+#error dspTables.h is out of date, rebuild it with genTables
+#endif
 
 /** Constants */
 static const float M_PI_F = (float)M_PI;
 static const float M_2PI_F = (float)(2.0*M_PI);
 static const float M_1_2PI_F = 1/M_2PI_F;
 
+// Scratch buffers of the burst functions. Each thread keeps its own,
+// grown to the largest burst it has seen, so bursts of any length are
+// worked on without allocating per burst or using the thread's stack.
+enum ScratchBuffer {
+  SCRATCH_MODULATE,		// modulateBurst() symbol impulses
+  SCRATCH_DELAY,		// delayVector() shifted burst
+  SCRATCH_CORRELATE,		// RACH and midamble correlations
+  SCRATCH_FORWARD,		// equalizeBurst() feedforward output
+  SCRATCH_DFE,			// equalizeBurst() decisions
+  SCRATCH_FIXED_WINDOW,		// fixed-point correlation input
+  SCRATCH_FIXED_SUMS,		// fixed-point correlation output
+  SCRATCH_FIXED_PADDED,		// fixed-point demodulateBurst() input
+  SCRATCH_FIXED_SHIFTED,	// fixed-point demodulateBurst() output
+  NUM_SCRATCH
+};
+
+struct Scratch {
+  char *buf[NUM_SCRATCH];
+  size_t size[NUM_SCRATCH];
+};
+
+static pthread_key_t gScratchKey;
+static pthread_once_t gScratchOnce = PTHREAD_ONCE_INIT;
+
+static void freeScratch(void *ptr)
+{
+  Scratch *s = (Scratch *) ptr;
+  for (int i = 0; i < NUM_SCRATCH; i++)
+    delete[] s->buf[i];
+  delete s;
+}
+
+static void initScratchKey()
+{
+  pthread_key_create(&gScratchKey,freeScratch);
+}
+
+// Buffer 'which' of the calling thread, of at least 'size' bytes
+static void *scratch(ScratchBuffer which, size_t size)
+{
+  pthread_once(&gScratchOnce,initScratchKey);
+  Scratch *s = (Scratch *) pthread_getspecific(gScratchKey);
+  if (!s) {
+    s = new Scratch;
+    memset(s,0,sizeof(Scratch));
+    pthread_setspecific(gScratchKey,s);
+  }
+  if (s->size[which] < size) {
+    delete[] s->buf[which];
+    s->buf[which] = new char[size];
+    s->size[which] = size;
+  }
+  return s->buf[which];
+}
+
+static complex *scratchSamples(ScratchBuffer which, size_t len)
+{
+  return (complex *) scratch(which,len*sizeof(complex));
+}
+
 /** Static vectors that contain a precomputed +/- f_b/4 sinusoid */ 
 signalVector *GMSKRotation = NULL;
 signalVector *GMSKReverseRotation = NULL;
@@ -54,11 +124,47 @@ typedef struct {
   signalVector *sequenceReversedConjugated;
   float        TOA;
   complex      gain;
+  // spectra of sequenceReversedConjugated, indexed by log2 of the FFT size,
+  // scaled by 1/N and filled on first use under gSpectrumLock
+  signalVector *spectrum[FFT_MAX_LOG2+1];
+  // sequence quantized for fixedCorrelate(), in input order, and the scale of
+  // the quantization
+  short        *fixedRe;
+  short        *fixedIm;
+  float        fixedScale;
 } CorrelationSequence;
 
 CorrelationSequence *gMidambles[] = {NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL};
 CorrelationSequence *gRACHSequence = NULL;
 
+/** Precomputed modulator output for the standard GSM pulse */
+typedef struct {
+  signalVector *pulse;         // the pulse the table was built for
+  signalVector *table;         // one waveform segment per bit pattern
+  int          samplesPerSymbol;
+  int          firstSymbol;    // offset of the oldest symbol in a pattern
+  int          numSymbols;     // number of symbols that reach one sample
+} ModulatorTable;
+
+ModulatorTable *gModulatorTable = NULL;
+
+/** Transforms for fast correlation, indexed by log2 size.  They and the
+    sequence spectra are built on first use, possibly by several receive
+    threads at once, so both are guarded by gSpectrumLock */
+static FFT *gFFT[FFT_MAX_LOG2+1];
+static Mutex gSpectrumLock;
+
+static void deleteSpectra(CorrelationSequence *seq)
+{
+  for (int i = 0; i <= FFT_MAX_LOG2; i++) {
+    delete seq->spectrum[i];
+    seq->spectrum[i] = NULL;
+  }
+  delete[] seq->fixedRe;
+  delete[] seq->fixedIm;
+  seq->fixedRe = seq->fixedIm = NULL;
+}
+
 void sigProcLibDestroy(void) {
   if (GMSKRotation) {
     delete GMSKRotation;
@@ -72,6 +178,7 @@ void sigProcLibDestroy(void) {
     if (gMidambles[i]!=NULL) {
       if (gMidambles[i]->sequence) delete gMidambles[i]->sequence;
       if (gMidambles[i]->sequenceReversedConjugated) delete gMidambles[i]->sequenceReversedConjugated;
+      deleteSpectra(gMidambles[i]);
       delete gMidambles[i];
       gMidambles[i] = NULL;
     }
@@ -79,9 +186,20 @@ void sigProcLibDestroy(void) {
   if (gRACHSequence) {
     if (gRACHSequence->sequence) delete gRACHSequence->sequence;
     if (gRACHSequence->sequenceReversedConjugated) delete gRACHSequence->sequenceReversedConjugated;
+    deleteSpectra(gRACHSequence);
     delete gRACHSequence;
     gRACHSequence = NULL;
   }
+  for (int i = 0; i <= FFT_MAX_LOG2; i++) {
+    delete gFFT[i];
+    gFFT[i] = NULL;
+  }
+  if (gModulatorTable) {
+    delete gModulatorTable->pulse;
+    delete gModulatorTable->table;
+    delete gModulatorTable;
+    gModulatorTable = NULL;
+  }
 }
 
 
@@ -166,7 +284,7 @@ float vectorPower(const signalVector &x)
 float cosLookup(const float x)
 {
   float arg = x*M_1_2PI_F;
-  while (arg > 1.0F) arg -= 1.0F;
+  while (arg >= 1.0F) arg -= 1.0F;
   while (arg < 0.0F) arg += 1.0F;
 
   const float argT = arg*((float)TABLESIZE);
@@ -180,7 +298,7 @@ float cosLookup(const float x)
 float sinLookup(const float x) 
 {
   float arg = x*M_1_2PI_F;
-  while (arg > 1.0F) arg -= 1.0F;
+  while (arg >= 1.0F) arg -= 1.0F;
   while (arg < 0.0F) arg += 1.0F;
 
   const float argT = arg*((float)TABLESIZE);
@@ -195,7 +313,7 @@ float sinLookup(const float x)
 complex expjLookup(float x)
 {
   float arg = x*M_1_2PI_F;
-  while (arg > 1.0F) arg -= 1.0F;
+  while (arg >= 1.0F) arg -= 1.0F;
   while (arg < 0.0F) arg += 1.0F;
 
   const float argT = arg*((float)TABLESIZE);
@@ -207,13 +325,6 @@ complex expjLookup(float x)
 }
 
 /** Library setup functions */
-void initTrigTables() {
-  for (int i = 0; i < TABLESIZE+1; i++) {
-    cosTable[i] = cos(2.0*M_PI*i/TABLESIZE);
-    sinTable[i] = sin(2.0*M_PI*i/TABLESIZE);
-  }
-}
-
 void initGMSKRotationTables(int samplesPerSymbol) {
   GMSKRotation = new signalVector(157*samplesPerSymbol);
   GMSKReverseRotation = new signalVector(157*samplesPerSymbol);
@@ -227,57 +338,122 @@ void initGMSKRotationTables(int samplesPerSymbol) {
   }
 }
 
+// multiply by j^k
+static inline complex rotateQuarter(const complex &x, int k)
+{
+  switch (k & 0x03) {
+  case 1: return complex(-x.imag(),x.real());
+  case 2: return complex(-x.real(),-x.imag());
+  case 3: return complex(x.imag(),-x.real());
+  default: return x;
+  }
+}
+
+// Sample p of symbol i of a modulated burst, divided by j^i. The symbols
+// i+firstSymbol onwards, already mapped to +/-1 or 0 outside the burst,
+// are in 'symbols'. Each symbol is an impulse rotated by j^i, as done by
+// GMSKRotate(), filtered by the pulse aligned as convolve() NO_DELAY.
+static complex modulateSample(const signalVector &pulse,
+			      int samplesPerSymbol,
+			      const float *symbols,
+			      int firstSymbol,
+			      int numSymbols,
+			      int p)
+{
+  int Lp = pulse.size();
+  int center = (Lp % 2) ? Lp/2 : Lp/2-1;
+  complex sum = 0.0;
+  for (int n = 0; n < numSymbols; n++) {
+    int d = firstSymbol + n;
+    int tap = center + p - d*samplesPerSymbol;
+    if ((tap < 0) || (tap >= Lp) || (symbols[n] == 0.0F)) continue;
+    sum += rotateQuarter(complex(pulse[tap].real()*symbols[n],0.0),d);
+  }
+  return sum;
+}
+
+// Each output sample only depends on the few symbols that the pulse
+// overlaps, so the output for every pattern of those symbols is
+// computed once here and modulateBurst() becomes a table lookup.
+void initGMSKModulatorTable(int samplesPerSymbol) {
+  signalVector *pulse = generateGSMPulse(2,samplesPerSymbol);
+  int Lp = pulse->size();
+  int center = (Lp % 2) ? Lp/2 : Lp/2-1;
+
+  // symbols d with a tap in reach of any sample p: 0 <= center+p-d*sps < Lp
+  int lastSymbol = (center+samplesPerSymbol-1)/samplesPerSymbol;
+  int firstSymbol = -((Lp-1-center)/samplesPerSymbol);
+  int numSymbols = lastSymbol-firstSymbol+1;
+  assert(numSymbols <= 8);
+
+  signalVector *table = new signalVector((1 << numSymbols)*samplesPerSymbol);
+  float symbols[8];
+  for (int pattern = 0; pattern < (1 << numSymbols); pattern++) {
+    for (int n = 0; n < numSymbols; n++)
+      symbols[n] = (pattern & (1 << n)) ? 1.0F : -1.0F;
+    for (int p = 0; p < samplesPerSymbol; p++)
+      (*table)[pattern*samplesPerSymbol+p] =
+	modulateSample(*pulse,samplesPerSymbol,symbols,firstSymbol,numSymbols,p);
+  }
+
+  gModulatorTable = new ModulatorTable;
+  gModulatorTable->pulse = pulse;
+  gModulatorTable->table = table;
+  gModulatorTable->samplesPerSymbol = samplesPerSymbol;
+  gModulatorTable->firstSymbol = firstSymbol;
+  gModulatorTable->numSymbols = numSymbols;
+}
+
+// Fractional delay taps, from the precomputed fit instead of evaluating
+// sincs for every burst
+static Farrow *gFarrow = NULL;
+
 void sigProcLibSetup(int samplesPerSymbol) {
-  initTrigTables();
+  convolveInit();
+  LOG(INFO) << "using " << convolveImpl() << " convolution kernels";
+  mlseInit();
+  LOG(INFO) << "using " << mlseImpl() << " MLSE kernels";
+  ncoInit();
+  LOG(INFO) << "using " << ncoImpl() << " mixing kernels";
+  fixedInit();
+  LOG(INFO) << "using " << fixedImpl() << " fixed-point kernels";
+  if (!gFarrow) {
+    gFarrow = new Farrow(FARROW_LEN,FARROW_ORDER,farrowCoeffs,farrowError);
+    LOG(INFO) << "using order " << gFarrow->order()
+	      << " Farrow interpolator, tap error "
+	      << gFarrow->error()*1e6 << " ppm";
+  }
   initGMSKRotationTables(samplesPerSymbol);
+  initGMSKModulatorTable(samplesPerSymbol);
 }
 
 void GMSKRotate(signalVector &x) {
-  signalVector::iterator xPtr = x.begin();
-  signalVector::iterator rotPtr = GMSKRotation->begin();
-  if (x.isRealOnly()) {
-    while (xPtr < x.end()) {
-      *xPtr = *rotPtr++ * (xPtr->real());
-      xPtr++;
-    }
-  }
-  else {
-    while (xPtr < x.end()) {
-      *xPtr = *rotPtr++ * (*xPtr);
-      xPtr++;
-    }
-  }
+  float *xPtr = (float *) x.begin();
+  float *rotPtr = (float *) GMSKRotation->begin();
+  if (x.isRealOnly())
+    mixReal(xPtr,xPtr,rotPtr,x.size());
+  else
+    mixComplex(xPtr,xPtr,rotPtr,x.size());
 }
 
 void GMSKReverseRotate(signalVector &x) {
-  signalVector::iterator xPtr= x.begin();
-  signalVector::iterator rotPtr = GMSKReverseRotation->begin();
-  if (x.isRealOnly()) {
-    while (xPtr < x.end()) {
-      *xPtr = *rotPtr++ * (xPtr->real());
-      xPtr++;
-    }
-  }
-  else {
-    while (xPtr < x.end()) {
-      *xPtr = *rotPtr++ * (*xPtr);
-      xPtr++;
-    }
-  }
+  float *xPtr = (float *) x.begin();
+  float *rotPtr = (float *) GMSKReverseRotation->begin();
+  if (x.isRealOnly())
+    mixReal(xPtr,xPtr,rotPtr,x.size());
+  else
+    mixComplex(xPtr,xPtr,rotPtr,x.size());
 }
 
 
-signalVector* convolve(const signalVector *a,
-		       const signalVector *b,
-		       signalVector *c,
-		       ConvType spanType,
-		       unsigned startIx,
-		       unsigned len)
+// Output span of a convolution, as an index into the full span and a length.
+static bool convolveSpan(int La, int Lb,
+			 ConvType spanType,
+			 unsigned startIx,
+			 unsigned len,
+			 int *start,
+			 unsigned *size)
 {
-  if ((a==NULL) || (b==NULL)) return NULL; 
-  int La = a->size();
-  int Lb = b->size();
-
   int startIndex;
   unsigned int outSize;
   switch (spanType) {
@@ -309,101 +485,84 @@ signalVector* convolve(const signalVector *a,
       outSize = len;
       break;
     default:
-      return NULL;
+      return false;
   }
 
-  
+  *start = startIndex;
+  *size = outSize;
+  return true;
+}
+
+signalVector* convolve(const signalVector *a,
+		       const signalVector *b,
+		       signalVector *c,
+		       ConvType spanType,
+		       unsigned startIx,
+		       unsigned len)
+{
+  if ((a==NULL) || (b==NULL)) return NULL; 
+  int La = a->size();
+  int Lb = b->size();
+
+  int startIndex;
+  unsigned int outSize;
+  if (!convolveSpan(La,Lb,spanType,startIx,len,&startIndex,&outSize))
+    return NULL;
+
   if (c==NULL)
     c = new signalVector(outSize);
   else if (c->size()!=outSize)
     return NULL;
 
-  signalVector::const_iterator aStart = a->begin();
-  signalVector::const_iterator bStart = b->begin();
-  signalVector::const_iterator aEnd = a->end();
-  signalVector::const_iterator bEnd = b->end();
-  signalVector::iterator cPtr = c->begin();
-  int t = startIndex;
+  // Build the output one filter tap at a time. For each tap, the span of
+  // outputs that overlap the input vector is computed up front, so the
+  // partial-overlap prologue and epilogue need no per-sample bounds checks
+  // and the multiply-accumulate kernels always run over contiguous data.
+  float *aData = (float *) a->begin();
+  float *bData = (float *) b->begin();
+  float *cData = (float *) c->begin();
   int stopIndex = startIndex + outSize;
+  c->fill(0.0);
   switch (b->getSymmetry()) {
   case NONE:
     {
-      while (t < stopIndex) {
-	signalVector::const_iterator aP = aStart+t;
-	signalVector::const_iterator bP = bStart;
+      for (int j = 0; j < Lb; j++) {
+	int tStart = (startIndex > j) ? startIndex : j;
+	int tStop = (stopIndex < La+j) ? stopIndex : La+j;
+	if (tStart >= tStop) continue;
+	float *cP = cData + 2*(tStart-startIndex);
+	float *aP = aData + 2*(tStart-j);
+	float *bP = bData + 2*j;
 	if (a->isRealOnly() && b->isRealOnly()) {
-	  float sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (aP->real())*(bP->real());
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	else if (a->isRealOnly()) {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*bP)*(aP->real());
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	else if (b->isRealOnly()) {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*aP)*(bP->real());
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
-	}
-	else {
-	  complex sum = 0.0;
-	  while (bP < bEnd) {
-	    if (aP < aStart) break;
-	    if (aP < aEnd) sum += (*aP)*(*bP);
-	    aP--;
-	    bP++;
-	  }
-	  *cPtr++ = sum;
+	  float tap[2] = {bP[0], 0.0F};
+	  convolveMacReal(cP,aP,tap,tStop-tStart);
 	}
-	t++;
+	else if (a->isRealOnly())
+	  convolveMacReal(cP,aP,bP,tStop-tStart);
+	else if (b->isRealOnly())
+	  convolveMacRealTap(cP,aP,bP,tStop-tStart);
+	else
+	  convolveMacComplex(cP,aP,bP,tStop-tStart);
       }
     }
     break;
   case ABSSYM:
     {
-      complex sum = 0.0;
-      bool isOdd = (bool) (Lb % 2);
-      if (isOdd) 
-	bEnd = bStart + (Lb+1)/2;
-      else 
-	bEnd = bStart + Lb/2;
-      while (t < stopIndex) {
-	signalVector::const_iterator aP = aStart+t;
-	signalVector::const_iterator aPsym = aP-Lb;
-	signalVector::const_iterator bP = bStart;
-	sum = 0.0;
-	while (bP < bEnd) {
-	  if (aP < aStart) break;
-	  if (aP == aPsym)
-	    sum+= (*aP)*(*bP);
-	  else if ((aP < aEnd) && (aPsym >= aStart)) 
-	    sum+= ((*aP)+(*aPsym))*(*bP);
-	  else if (aP < aEnd)
-	    sum += (*aP)*(*bP);
-	  else if (aPsym >= aStart)
-	    sum += (*aPsym)*(*bP);
-	  aP--;
-	  aPsym++;
-	  bP++;
-	}
-	*cPtr++ = sum;
-	t++;
+      // only the first half of the filter is stored, each tap is applied
+      // to the sample pair a[t-j] and a[t-Lb+j]
+      int half = (Lb+1)/2;
+      for (int j = 0; j < half; j++) {
+	float *bP = bData + 2*j;
+	int tStart = (startIndex > j) ? startIndex : j;
+	int tStop = (stopIndex < La+j) ? stopIndex : La+j;
+	if (tStart < tStop)
+	  convolveMacComplex(cData + 2*(tStart-startIndex),
+			     aData + 2*(tStart-j), bP, tStop-tStart);
+	tStart = (startIndex > Lb-j) ? startIndex : Lb-j;
+	tStop = (stopIndex < La+Lb-j) ? stopIndex : La+Lb-j;
+	if (tStart < tStop)
+	  convolveMacComplex(cData + 2*(tStart-startIndex),
+			     aData + 2*(tStart-Lb+j), bP, tStop-tStart);
       }
     }
     break;
@@ -455,26 +614,13 @@ signalVector* frequencyShift(signalVector *y,
 
   if (y->size() < x->size()) return NULL;
 
-  float phase = startPhase;
-  signalVector::iterator yP = y->begin();
-  signalVector::iterator xPEnd = x->end();
-  signalVector::iterator xP = x->begin();
-
-  if (x->isRealOnly()) {
-    while (xP < xPEnd) {
-      (*yP++) = expjLookup(phase)*( (xP++)->real() );
-      phase += freq;
-    }
-  }
-  else {
-    while (xP < xPEnd) {
-      (*yP++) = (*xP++)*expjLookup(phase);
-      phase += freq;
-    }
-  }
-
+  NCO nco(freq,startPhase);
+  if (x->isRealOnly())
+    nco.mixReal((float *) y->begin(),(float *) x->begin(),x->size());
+  else
+    nco.mix((float *) y->begin(),(float *) x->begin(),x->size());
 
-  if (finalPhase) *finalPhase = phase;
+  if (finalPhase) *finalPhase = nco.phase();
 
   return y;
 }
@@ -526,6 +672,190 @@ signalVector* correlate(signalVector *a,
   return c;
 }
 
+// Relative cost of a direct multiply-accumulate against an FFT butterfly,
+// since the direct kernels are vectorized and the transform is not.
+#define DIRECT_MAC_COST 0.25F
+
+// Pick the FFT size for overlap-save correlation of Lb taps over outSize
+// outputs, or return 0 if direct correlation is expected to be cheaper.
+static int correlateFFTSize(int Lb, unsigned outSize)
+{
+  float bestCost = DIRECT_MAC_COST*outSize*Lb;
+  int bestLog2 = 0;
+
+  for (int log2N = 1; log2N <= FFT_MAX_LOG2; log2N++) {
+    int N = 1 << log2N;
+    if (N < 2*Lb) continue;
+    int L = N-Lb+1;
+    int blocks = (outSize+L-1)/L;
+    // two transforms and a spectral product per block
+    float cost = (float) blocks*(N*log2N + N);
+    if (cost < bestCost) {
+      bestCost = cost;
+      bestLog2 = log2N;
+    }
+    if (L >= (int) outSize) break;
+  }
+
+  return bestLog2;
+}
+
+static signalVector *correlationSpectrum(CorrelationSequence *seq, int log2N)
+{
+  if (seq->spectrum[log2N]) return seq->spectrum[log2N];
+
+  int N = 1 << log2N;
+  signalVector *b = seq->sequenceReversedConjugated;
+  signalVector *H = new signalVector(N);
+  H->fill(0.0);
+  for (unsigned i = 0; i < b->size(); i++) {
+    if (b->isRealOnly())
+      (*H)[i] = (*b)[i].real();
+    else
+      (*H)[i] = (*b)[i];
+  }
+  gFFT[log2N]->forward(H->begin());
+  scaleVector(*H,complex(1.0/N,0.0));
+
+  seq->spectrum[log2N] = H;
+  return H;
+}
+
+// Correlate against a stored sequence, directly or by overlap-save FFT,
+// whichever the span makes cheaper.
+static signalVector* correlateSequence(signalVector *a,
+				       CorrelationSequence *seq,
+				       signalVector *c,
+				       ConvType spanType,
+				       unsigned startIx = 0,
+				       unsigned len = 0)
+{
+  signalVector *b = seq->sequenceReversedConjugated;
+  int La = a->size();
+  int Lb = b->size();
+
+  int startIndex;
+  unsigned int outSize;
+  if (!convolveSpan(La,Lb,spanType,startIx,len,&startIndex,&outSize))
+    return NULL;
+
+  int log2N = 0;
+  if (b->getSymmetry() == NONE)
+    log2N = correlateFFTSize(Lb,outSize);
+  if (!log2N)
+    return convolve(a,b,c,spanType,startIx,len);
+
+  if (c==NULL)
+    c = new signalVector(outSize);
+  else if (c->size()!=outSize)
+    return NULL;
+
+  gSpectrumLock.lock();
+  if (!gFFT[log2N])
+    gFFT[log2N] = new FFT(1 << log2N);
+  FFT *fft = gFFT[log2N];
+  signalVector *H = correlationSpectrum(seq,log2N);
+  gSpectrumLock.unlock();
+
+  // Overlap-save: each block of N input samples yields the N-Lb+1 outputs
+  // that do not wrap around the circular convolution.
+  int N = 1 << log2N;
+  signalVector buf(N);
+  int L = N-Lb+1;
+  for (unsigned k0 = 0; k0 < outSize; k0 += L) {
+    int first = startIndex + k0 - (Lb-1);
+    for (int n = 0; n < N; n++) {
+      int t = first + n;
+      if ((t < 0) || (t >= La))
+	buf[n] = 0.0;
+      else if (a->isRealOnly())
+	buf[n] = (*a)[t].real();
+      else
+	buf[n] = (*a)[t];
+    }
+
+    fft->forward(buf.begin());
+    for (int n = 0; n < N; n++)
+      buf[n] = buf[n] * (*H)[n];
+    fft->inverse(buf.begin());
+
+    unsigned num = (outSize-k0 < (unsigned) L) ? outSize-k0 : L;
+    for (unsigned n = 0; n < num; n++)
+      (*c)[k0+n] = buf[Lb-1+n];
+  }
+
+  return c;
+}
+
+// Quantize a stored sequence for fixed-point correlation. The taps are
+// kept in input order, so each output is one dot product with the burst.
+static void fixedSequenceTaps(CorrelationSequence *seq)
+{
+  signalVector *b = seq->sequenceReversedConjugated;
+  int Lb = b->size();
+  signalVector taps(Lb);
+  for (int k = 0; k < Lb; k++) {
+    if (b->isRealOnly())
+      taps[k] = (*b)[Lb-1-k].real();
+    else
+      taps[k] = (*b)[Lb-1-k];
+  }
+
+  seq->fixedRe = new short[2*Lb];
+  seq->fixedIm = new short[2*Lb];
+  seq->fixedScale = fixedTaps(seq->fixedRe,seq->fixedIm,
+			      (float *) taps.begin(),Lb,32767.0F);
+}
+
+// Correlate a burst in the device format against a stored sequence,
+// with the output span of the floating point version.
+static signalVector* correlateSequence(const short *a,
+				       int La,
+				       CorrelationSequence *seq,
+				       signalVector *c,
+				       ConvType spanType,
+				       unsigned startIx = 0,
+				       unsigned len = 0)
+{
+  int Lb = seq->sequenceReversedConjugated->size();
+
+  int startIndex;
+  unsigned int outSize;
+  if (!convolveSpan(La,Lb,spanType,startIx,len,&startIndex,&outSize))
+    return NULL;
+
+  if (c==NULL)
+    c = new signalVector(outSize);
+  else if (c->size()!=outSize)
+    return NULL;
+
+  float gain = 1.0F/seq->fixedScale;
+
+  // output i sums x[i+k]*h[k] over a window x of the burst starting at
+  // sample startIndex-Lb+1, zero padded where it runs past the burst
+  int first = startIndex-Lb+1;
+  int windowLen = outSize+Lb-1;
+  const short *x = a + 2*first;
+  if ((first < 0) || (first+windowLen > La)) {
+    short *window = (short *) scratch(SCRATCH_FIXED_WINDOW,
+				      2*windowLen*sizeof(short));
+    for (int j = 0; j < windowLen; j++) {
+      int t = first+j;
+      bool inside = (t >= 0) && (t < La);
+      window[2*j] = inside ? a[2*t] : 0;
+      window[2*j+1] = inside ? a[2*t+1] : 0;
+    }
+    x = window;
+  }
+
+  int *sums = (int *) scratch(SCRATCH_FIXED_SUMS,2*outSize*sizeof(int));
+  fixedCorrelate(sums,x,seq->fixedRe,seq->fixedIm,Lb,outSize);
+  for (unsigned i = 0; i < outSize; i++)
+    (*c)[i] = complex(sums[2*i]*gain,sums[2*i+1]*gain);
+
+  return c;
+}
+
 
 /* soft output slicer */
 bool vectorSlicer(signalVector *x) 
@@ -542,20 +872,72 @@ bool vectorSlicer(signalVector *x)
   return true;
 }
   
+// Table driven modulation, only valid for the pulse the table was built for
+static void modulateBurstFromTable(const BitVector &wBurst,
+				   signalVector &shapedBurst)
+{
+  ModulatorTable *mod = gModulatorTable;
+  int sps = mod->samplesPerSymbol;
+  int numBits = wBurst.size();
+  int numSymbols = shapedBurst.size()/sps;
+  signalVector::iterator outItr = shapedBurst.begin();
+
+  for (int i = 0; i < numSymbols; i++) {
+    int first = i + mod->firstSymbol;
+    int last = first + mod->numSymbols - 1;
+
+    if ((first >= 0) && (last < numBits)) {
+      int pattern = 0;
+      for (int n = 0; n < mod->numSymbols; n++)
+	pattern |= (wBurst[first+n] & 0x01) << n;
+      signalVector::iterator tableItr = mod->table->begin() + pattern*sps;
+      for (int p = 0; p < sps; p++)
+	*outItr++ = rotateQuarter(*tableItr++,i);
+    }
+    else {
+      // near the burst edges some of the symbols are missing
+      float symbols[8];
+      for (int n = 0; n < mod->numSymbols; n++) {
+	int k = first + n;
+	if ((k < 0) || (k >= numBits))
+	  symbols[n] = 0.0F;
+	else
+	  symbols[n] = 2.0F*(wBurst[k] & 0x01)-1.0F;
+      }
+      for (int p = 0; p < sps; p++)
+	*outItr++ = rotateQuarter(modulateSample(*mod->pulse,sps,symbols,
+						 mod->firstSymbol,mod->numSymbols,p),i);
+    }
+  }
+}
+
 signalVector *modulateBurst(const BitVector &wBurst,
 			    const signalVector &gsmPulse,
 			    int guardPeriodLength,
-			    int samplesPerSymbol)
+			    int samplesPerSymbol,
+			    signalVector *shapedBurst)
 {
 
-  static complex staticBurst[157];
-
   int burstSize = samplesPerSymbol*(wBurst.size()+guardPeriodLength);
-  signalVector modBurst((complex *) staticBurst,0,burstSize);
+
+  ModulatorTable *mod = gModulatorTable;
+  if (mod && (mod->samplesPerSymbol == samplesPerSymbol) &&
+      (mod->pulse->size() == gsmPulse.size()) &&
+      !memcmp(mod->pulse->begin(),gsmPulse.begin(),gsmPulse.bytes())) {
+    if (shapedBurst==NULL)
+      shapedBurst = new signalVector(burstSize);
+    else if (shapedBurst->size()!=(unsigned) burstSize)
+      return NULL;
+    modulateBurstFromTable(wBurst,*shapedBurst);
+    return shapedBurst;
+  }
+
+  complex *burstData = scratchSamples(SCRATCH_MODULATE,burstSize);
+
+  signalVector modBurst(burstData,0,burstSize);
   //signalVector *modBurst = new signalVector(burstSize);
   modBurst.isRealOnly(true);
-  memset(staticBurst,0,sizeof(complex)*burstSize);
-  //modBurst.fill(0.0);
+  modBurst.fill(0.0);
   signalVector::iterator modBurstItr = modBurst.begin();
 
 #if 0 
@@ -584,11 +966,7 @@ signalVector *modulateBurst(const BitVector &wBurst,
   modBurst.isRealOnly(false);
 
   // filter w/ pulse shape
-  signalVector *shapedBurst = convolve(&modBurst,&gsmPulse,NULL,NO_DELAY);
-
-  //delete modBurst;
-  
-  return shapedBurst;
+  return convolve(&modBurst,&gsmPulse,shapedBurst,NO_DELAY);
 
 }
 
@@ -607,18 +985,19 @@ void delayVector(signalVector &wBurst,
   
   // do fractional shift first, only do it for reasonable offsets
   if (fabs(fracOffset) > 1e-2) {
-    // create sinc function
-    static complex staticData[21];
-    signalVector sincVector(staticData,0,21); 
+    // sinc taps from the Farrow interpolator
+    float taps[FARROW_LEN];
+    gFarrow->taps(fracOffset,taps);
+    complex sincData[FARROW_LEN];
+    signalVector sincVector(sincData,0,FARROW_LEN);
     sincVector.isRealOnly(true);
-    signalVector::iterator sincBurstItr = sincVector.begin();
-    for (int i = 0; i < 21; i++) 
-      *sincBurstItr++ = (complex) sinc(M_PI_F*(i-10-fracOffset));
-  
-    static complex shiftedData[300];
+    for (int i = 0; i < FARROW_LEN; i++)
+      sincData[i] = taps[i];
+
+    complex *shiftedData = scratchSamples(SCRATCH_DELAY,wBurst.size());
     signalVector shiftedBurst(shiftedData,0,wBurst.size());
     convolve(&wBurst,&sincVector,&shiftedBurst,NO_DELAY);
-    wBurst.clone(shiftedBurst);
+    shiftedBurst.copyTo(wBurst);
   }
 
   if (intOffset < 0) {
@@ -664,27 +1043,53 @@ signalVector *gaussianNoise(int length,
 complex interpolatePoint(const signalVector &inSig,
 			 float ix)
 {
-  
-  int start = (int) (floor(ix) - 10);
-  if (start < 0) start = 0;
-  int end = (int) (floor(ix) + 11);
-  if ((unsigned) end > inSig.size()-1) end = inSig.size()-1;
-  
-  complex pVal = 0.0;
-  if (!inSig.isRealOnly()) {
-    for (int i = start; i < end; i++) 
-      pVal += inSig[i] * sinc(M_PI_F*(i-ix));
-  }
-  else {
-    for (int i = start; i < end; i++) 
-      pVal += inSig[i].real() * sinc(M_PI_F*(i-ix));
-  }
-   
-  return pVal;
+  // the last sample of inSig has never been part of the sum, and peak
+  // positions depend on it, so it stays out
+  int base = (int) floor(ix);
+  float branches[2*(FARROW_ORDER_MAX+1)];
+  gFarrow->branches((const float *) inSig.begin(),inSig.size()-1,base,
+		    inSig.isRealOnly(),branches);
+
+  float pVal[2];
+  gFarrow->evaluate(branches,ix-base,pVal);
+  return complex(pVal[0],pVal[1]);
 }
 
   
  
+// Points near a correlation peak, from Farrow branch outputs computed
+// once per base sample
+class PeakInterpolator {
+public:
+  PeakInterpolator(const signalVector &sig, int firstBase)
+    : mSig(sig), mFirstBase(firstBase)
+  {
+    for (int i = 0; i < 4; i++) mReady[i] = false;
+  }
+
+  complex point(float ix)
+  {
+    int base = (int) floor(ix);
+    int i = base - mFirstBase;
+    if ((i < 0) || (i >= 4)) return interpolatePoint(mSig,ix);
+
+    if (!mReady[i]) {
+      gFarrow->branches((const float *) mSig.begin(),mSig.size()-1,base,
+			mSig.isRealOnly(),mBranches[i]);
+      mReady[i] = true;
+    }
+    float pVal[2];
+    gFarrow->evaluate(mBranches[i],ix-base,pVal);
+    return complex(pVal[0],pVal[1]);
+  }
+
+private:
+  const signalVector &mSig;
+  int mFirstBase;
+  bool mReady[4];
+  float mBranches[4][2*(FARROW_ORDER_MAX+1)];
+};
+
 complex peakDetect(const signalVector &rxBurst,
 		   float *peakIndex,
 		   float *avgPwr) 
@@ -708,11 +1113,15 @@ complex peakDetect(const signalVector &rxBurst,
   // to save computation, we'll use early-late balancing
   float earlyIndex = maxIndex-1;
   float lateIndex = maxIndex+1;
-  
+
+  // every point probed lies between maxIndex-2 and maxIndex+2, so the
+  // Farrow branch outputs of those four base samples serve all of them
+  PeakInterpolator interp(rxBurst,(int) maxIndex-2);
+
   float incr = 0.5;
   while (incr > 1.0/1024.0) {
-    complex earlyP = interpolatePoint(rxBurst,earlyIndex);
-    complex lateP =  interpolatePoint(rxBurst,lateIndex);
+    complex earlyP = interp.point(earlyIndex);
+    complex lateP =  interp.point(lateIndex);
     if (earlyP < lateP) 
       earlyIndex += incr;
     else if (earlyP > lateP)
@@ -723,7 +1132,7 @@ complex peakDetect(const signalVector &rxBurst,
   }
 
   maxIndex = earlyIndex + 1.0;
-  maxVal = interpolatePoint(rxBurst,maxIndex);
+  maxVal = interp.point(maxIndex);
 
   if (peakIndex!=NULL)
     *peakIndex = maxIndex;
@@ -812,6 +1221,9 @@ bool generateMidamble(signalVector &gsmPulse,
   if (gMidambles[TSC]) {
     if (gMidambles[TSC]->sequence!=NULL) delete gMidambles[TSC]->sequence;
     if (gMidambles[TSC]->sequenceReversedConjugated!=NULL)  delete gMidambles[TSC]->sequenceReversedConjugated;
+    deleteSpectra(gMidambles[TSC]);
+    delete gMidambles[TSC];
+    gMidambles[TSC] = NULL;
   }
 
   signalVector emptyPulse(1); 
@@ -842,10 +1254,11 @@ bool generateMidamble(signalVector &gsmPulse,
   
   if (autocorr == NULL) return false;
 
-  gMidambles[TSC] = new CorrelationSequence;
+  gMidambles[TSC] = new CorrelationSequence();
   gMidambles[TSC]->sequence = middleMidamble;
   gMidambles[TSC]->sequenceReversedConjugated = reverseConjugate(middleMidamble);
   gMidambles[TSC]->gain = peakDetect(*autocorr,&gMidambles[TSC]->TOA,NULL);
+  fixedSequenceTaps(gMidambles[TSC]);
 
   LOG(DEBUG) << "midamble autocorr: " << *autocorr;
 
@@ -866,6 +1279,9 @@ bool generateRACHSequence(signalVector &gsmPulse,
   if (gRACHSequence) {
     if (gRACHSequence->sequence!=NULL) delete gRACHSequence->sequence;
     if (gRACHSequence->sequenceReversedConjugated!=NULL) delete gRACHSequence->sequenceReversedConjugated;
+    deleteSpectra(gRACHSequence);
+    delete gRACHSequence;
+    gRACHSequence = NULL;
   }
 
   signalVector *RACHSeq = modulateBurst(gRACHSynchSequence,
@@ -879,10 +1295,11 @@ bool generateRACHSequence(signalVector &gsmPulse,
 
   assert(autocorr);
 
-  gRACHSequence = new CorrelationSequence;
+  gRACHSequence = new CorrelationSequence();
   gRACHSequence->sequence = RACHSeq;
   gRACHSequence->sequenceReversedConjugated = reverseConjugate(RACHSeq);
   gRACHSequence->gain = peakDetect(*autocorr,&gRACHSequence->TOA,NULL);
+  fixedSequenceTaps(gRACHSequence);
  
   delete autocorr;
 
@@ -891,18 +1308,13 @@ bool generateRACHSequence(signalVector &gsmPulse,
 }
 
 				
-bool detectRACHBurst(signalVector &rxBurst,
-		     float detectThreshold,
-		     int samplesPerSymbol,
-		     complex *amplitude,
-		     float* TOA)
+// Peak search of a RACH correlation, common to both sample formats
+static bool detectRACHPeak(signalVector &correlatedRACH,
+			   float detectThreshold,
+			   int samplesPerSymbol,
+			   complex *amplitude,
+			   float* TOA)
 {
- 
-  static complex staticData[500];
-
-  signalVector correlatedRACH(staticData,0,rxBurst.size());
-  correlate(&rxBurst,gRACHSequence->sequenceReversedConjugated,&correlatedRACH,NO_DELAY,true);
-
   float meanPower;
   complex peakAmpl = peakDetect(correlatedRACH,TOA,&meanPower);
 
@@ -943,6 +1355,40 @@ bool detectRACHBurst(signalVector &rxBurst,
   return (peakToMean > detectThreshold);
 }
 
+bool detectRACHBurst(signalVector &rxBurst,
+		     float detectThreshold,
+		     int samplesPerSymbol,
+		     complex *amplitude,
+		     float* TOA)
+{
+ 
+  complex *corrData = scratchSamples(SCRATCH_CORRELATE,rxBurst.size());
+
+  signalVector correlatedRACH(corrData,0,rxBurst.size());
+  correlateSequence(&rxBurst,gRACHSequence,&correlatedRACH,NO_DELAY);
+
+  return detectRACHPeak(correlatedRACH,detectThreshold,samplesPerSymbol,
+			amplitude,TOA);
+}
+
+bool detectRACHBurst(const short *rxBurst,
+		     unsigned burstLength,
+		     float detectThreshold,
+		     int samplesPerSymbol,
+		     complex *amplitude,
+		     float* TOA)
+{
+ 
+  complex *corrData = scratchSamples(SCRATCH_CORRELATE,burstLength);
+
+  signalVector correlatedRACH(corrData,0,burstLength);
+  correlateSequence(rxBurst,burstLength,gRACHSequence,&correlatedRACH,
+		    NO_DELAY);
+
+  return detectRACHPeak(correlatedRACH,detectThreshold,samplesPerSymbol,
+			amplitude,TOA);
+}
+
 bool energyDetect(signalVector &rxBurst,
 		  unsigned windowLength,
 		  float detectThreshold,
@@ -961,44 +1407,55 @@ bool energyDetect(signalVector &rxBurst,
   LOG(DEEPDEBUG) << "detected energy: " << energy/windowLength;
   return (energy/windowLength > detectThreshold*detectThreshold);
 }
-  
 
-bool analyzeTrafficBurst(signalVector &rxBurst,
-			 unsigned TSC,
-			 float detectThreshold,
-			 int samplesPerSymbol,
-			 complex *amplitude,
-			 float *TOA,
-			 unsigned maxTOA,
-                         bool requestChannel,
-                         signalVector **channelResponse,
-			 float *channelResponseOffset) 
+bool energyDetect(const short *rxBurst,
+		  unsigned burstLength,
+		  unsigned windowLength,
+		  float detectThreshold,
+                  float *avgPwr)
 {
+  if (windowLength > burstLength) windowLength = burstLength;
+  float energy = (float) fixedEnergy(rxBurst,windowLength,4);
+  if (avgPwr) *avgPwr = energy/windowLength;
+  LOG(DEEPDEBUG) << "detected energy: " << energy/windowLength;
+  return (energy/windowLength > detectThreshold*detectThreshold);
+}
+  
 
-  assert(TSC<8);
-  assert(amplitude);
-  assert(TOA);
-  assert(gMidambles[TSC]);
-
-  if (maxTOA < 3*samplesPerSymbol) maxTOA = 3*samplesPerSymbol;
-  unsigned spanTOA = maxTOA;
+// Span of a normal burst searched for the midamble, and the first
+// correlation output, common to both sample formats
+static void trafficWindow(unsigned TSC,
+			  int samplesPerSymbol,
+			  unsigned *maxTOA,
+			  unsigned *startIx,
+			  unsigned *windowLen,
+			  unsigned *corrStart)
+{
+  if (*maxTOA < 3*samplesPerSymbol) *maxTOA = 3*samplesPerSymbol;
+  unsigned spanTOA = *maxTOA;
   if (spanTOA < 5*samplesPerSymbol) spanTOA = 5*samplesPerSymbol;
 
-  unsigned startIx = (66-spanTOA)*samplesPerSymbol;
-  unsigned endIx = (66+16+spanTOA)*samplesPerSymbol;
-  unsigned windowLen = endIx - startIx;
-  unsigned corrLen = 2*maxTOA+1;
+  // the span is in samples, as is the TOA
+  *startIx = 66*samplesPerSymbol-spanTOA;
+  unsigned endIx = (66+16)*samplesPerSymbol+spanTOA;
+  *windowLen = endIx - *startIx;
 
   unsigned expectedTOAPeak = (unsigned) round(gMidambles[TSC]->TOA + (gMidambles[TSC]->sequenceReversedConjugated->size()-1)/2);
+  *corrStart = expectedTOAPeak - *maxTOA;
+}
 
-  signalVector burstSegment(rxBurst.begin(),startIx,windowLen);
-
-  static complex staticData[200];
-  signalVector correlatedBurst(staticData,0,corrLen);
-  correlate(&burstSegment, gMidambles[TSC]->sequenceReversedConjugated,
-					    &correlatedBurst, CUSTOM,true,
-					    expectedTOAPeak-maxTOA,corrLen);
-
+// Peak search and channel estimate of a midamble correlation
+static bool analyzeTrafficPeak(signalVector &correlatedBurst,
+			       unsigned TSC,
+			       float detectThreshold,
+			       int samplesPerSymbol,
+			       complex *amplitude,
+			       float *TOA,
+			       unsigned maxTOA,
+			       bool requestChannel,
+			       signalVector **channelResponse,
+			       float *channelResponseOffset)
+{
   float meanPower;
   *amplitude = peakDetect(correlatedBurst,TOA,&meanPower);
   float valleyPower = 0.0; //amplitude->norm2();
@@ -1075,6 +1532,77 @@ bool analyzeTrafficBurst(signalVector &rxBurst,
 		  
 }
 
+bool analyzeTrafficBurst(signalVector &rxBurst,
+			 unsigned TSC,
+			 float detectThreshold,
+			 int samplesPerSymbol,
+			 complex *amplitude,
+			 float *TOA,
+			 unsigned maxTOA,
+                         bool requestChannel,
+                         signalVector **channelResponse,
+			 float *channelResponseOffset) 
+{
+
+  assert(TSC<8);
+  assert(amplitude);
+  assert(TOA);
+  assert(gMidambles[TSC]);
+
+  unsigned startIx, windowLen, corrStart;
+  trafficWindow(TSC,samplesPerSymbol,&maxTOA,&startIx,&windowLen,&corrStart);
+  unsigned corrLen = 2*maxTOA+1;
+
+  signalVector burstSegment(rxBurst.begin(),startIx,windowLen);
+
+  complex *corrData = scratchSamples(SCRATCH_CORRELATE,corrLen);
+  signalVector correlatedBurst(corrData,0,corrLen);
+  correlateSequence(&burstSegment, gMidambles[TSC],
+		    &correlatedBurst, CUSTOM,
+		    corrStart,corrLen);
+
+  return analyzeTrafficPeak(correlatedBurst,TSC,detectThreshold,
+			    samplesPerSymbol,amplitude,TOA,maxTOA,
+			    requestChannel,channelResponse,
+			    channelResponseOffset);
+}
+
+bool analyzeTrafficBurst(const short *rxBurst,
+			 unsigned burstLength,
+			 unsigned TSC,
+			 float detectThreshold,
+			 int samplesPerSymbol,
+			 complex *amplitude,
+			 float *TOA,
+			 unsigned maxTOA,
+                         bool requestChannel,
+                         signalVector **channelResponse,
+			 float *channelResponseOffset) 
+{
+
+  assert(TSC<8);
+  assert(amplitude);
+  assert(TOA);
+  assert(gMidambles[TSC]);
+
+  unsigned startIx, windowLen, corrStart;
+  trafficWindow(TSC,samplesPerSymbol,&maxTOA,&startIx,&windowLen,&corrStart);
+  unsigned corrLen = 2*maxTOA+1;
+
+  if (startIx + windowLen > burstLength) return false;
+
+  complex *corrData = scratchSamples(SCRATCH_CORRELATE,corrLen);
+  signalVector correlatedBurst(corrData,0,corrLen);
+  correlateSequence(rxBurst + 2*startIx, windowLen, gMidambles[TSC],
+		    &correlatedBurst, CUSTOM,
+		    corrStart,corrLen);
+
+  return analyzeTrafficPeak(correlatedBurst,TSC,detectThreshold,
+			    samplesPerSymbol,amplitude,TOA,maxTOA,
+			    requestChannel,channelResponse,
+			    channelResponseOffset);
+}
+
 signalVector *decimateVector(signalVector &wVector,
 			     int decimationFactor) 
 {
@@ -1096,39 +1624,106 @@ SoftVector *demodulateBurst(signalVector &rxBurst,
 			 const signalVector &gsmPulse,
 			 int samplesPerSymbol,
 			 complex channel,
-			 float TOA) 
+			 float TOA,
+			 SoftVector *burstBits) 
 
 {
+  unsigned numSymbols = rxBurst.size()/samplesPerSymbol;
+  if (burstBits==NULL)
+    burstBits = new SoftVector(numSymbols);
+  else if (burstBits->size()!=numSymbols)
+    return NULL;
+
   scaleVector(rxBurst,((complex) 1.0)/channel);
   delayVector(rxBurst,-TOA);
 
-  signalVector *shapedBurst = &rxBurst;
-
   // shift up by a quarter of a frequency
   // ignore starting phase, since spec allows for discontinuous phase
-  GMSKReverseRotate(*shapedBurst);
+  GMSKReverseRotate(rxBurst);
 
-  // run through slicer
-  if (samplesPerSymbol > 1) {
-     signalVector *decShapedBurst = decimateVector(*shapedBurst,samplesPerSymbol);
-     shapedBurst = decShapedBurst;
+  LOG(DEEPDEBUG) << "shapedBurst: " << rxBurst;
+
+  // run through slicer, then keep one sample per symbol
+  vectorSlicer(&rxBurst);
+
+  SoftVector::iterator burstItr = burstBits->begin();
+  signalVector::iterator shapedItr = rxBurst.begin();
+  for (unsigned i = 0; i < numSymbols; i++) {
+    *burstItr++ = shapedItr->real();
+    shapedItr += samplesPerSymbol;
   }
 
-  LOG(DEEPDEBUG) << "shapedBurst: " << *shapedBurst;
+  return burstBits;
 
-  vectorSlicer(shapedBurst);
+}
 
-  SoftVector *burstBits = new SoftVector(shapedBurst->size());
+// Same steps as above, but only at the sample of each symbol. The delay
+// is a 21 tap sinc interpolator, as in delayVector(), run in fixed point
+// on the samples around the one that is kept.
+SoftVector *demodulateBurst(const short *rxBurst,
+			 unsigned burstLength,
+			 int samplesPerSymbol,
+			 complex channel,
+			 float TOA,
+			 SoftVector *burstBits)
+{
+  unsigned numSymbols = burstLength/samplesPerSymbol;
+  if (burstBits==NULL)
+    burstBits = new SoftVector(numSymbols);
+  else if (burstBits->size()!=numSymbols)
+    return NULL;
+
+  int intOffset = (int) floor(-TOA);
+  float fracOffset = -TOA - intOffset;
+  bool interpolate = (fabs(fracOffset) > 1e-2);
+
+  // the burst is interpolated in one pass over a copy padded with 10
+  // samples ahead and 12 behind, so that output sample p weighs samples
+  // p-10 to p+10 of the burst with taps 0 to 20; tap 21 is zero padding
+  int *shifted = NULL;
+  float gain = 1.0F;
+  if (interpolate) {
+    // tap k is sinc(pi*(10-k-fracOffset)), the Farrow taps for -fracOffset
+    float sincTaps[22];
+    gFarrow->taps(-fracOffset,sincTaps);
+    sincTaps[21] = 0.0F;
+    short sincFixed[22];
+    gain = 1.0F/fixedRealTaps(sincFixed,sincTaps,22,16384.0F);
+
+    short *padded = (short *) scratch(SCRATCH_FIXED_PADDED,
+				      2*(burstLength+22)*sizeof(short));
+    memset(padded,0,2*10*sizeof(short));
+    memcpy(padded+2*10,rxBurst,2*burstLength*sizeof(short));
+    memset(padded+2*(burstLength+10),0,2*12*sizeof(short));
+    shifted = (int *) scratch(SCRATCH_FIXED_SHIFTED,2*burstLength*sizeof(int));
+    fixedFilter(shifted,padded,sincFixed,22,burstLength);
+  }
 
+  complex scale = ((complex) 1.0)/channel;
   SoftVector::iterator burstItr = burstBits->begin();
-  signalVector::iterator shapedItr = shapedBurst->begin();
-  for (; shapedItr < shapedBurst->end(); shapedItr++) 
-    *burstItr++ = shapedItr->real();
+  for (unsigned i = 0; i < numSymbols; i++) {
+    unsigned m = i*samplesPerSymbol;
+    int p = m - intOffset;
+    complex x = 0.0;
+    if ((p >= 0) && (p < (int) burstLength)) {
+      if (interpolate)
+	x = complex(shifted[2*p]*gain,shifted[2*p+1]*gain);
+      else
+	x = complex(rxBurst[2*p],rxBurst[2*p+1]);
+    }
 
-  if (samplesPerSymbol > 1) delete shapedBurst;
+    *burstItr++ = 0.5F*((x*scale*(*GMSKReverseRotation)[m]).real()+1.0F);
+  }
 
-  return burstBits;
+  // soft slicer, as vectorSlicer(), in a loop of its own so that it
+  // compiles to min and max rather than branches on random bits
+  float *bits = burstBits->begin();
+  for (unsigned i = 0; i < numSymbols; i++) {
+    float v = (bits[i] < 1.0F) ? bits[i] : 1.0F;
+    bits[i] = (v > 0.0F) ? v : 0.0F;
+  }
 
+  return burstBits;
 }
 
 
@@ -1277,38 +1872,104 @@ signalVector *resampleVector(signalVector &wVector,
 }
 		   
 
+DFEState::DFEState(int wNf, float channelDistance, float SNRDistance)
+  : Nf(wNf),
+    mValid(false),
+    mSNR(0.0),
+    mOffset(0.0),
+    mForward(wNf),
+    mG0(wNf), mG1(wNf), mG0new(wNf), mG1new(wNf), mV(wNf)
+{
+  distances(channelDistance,SNRDistance);
+}
+
+void DFEState::distances(float channelDistance, float SNRDistance)
+{
+  mChannelDistance = channelDistance;
+  mSNRRatio = pow(10.0,SNRDistance/10.0);
+}
+
+void DFEState::resize(int channelLength)
+{
+  if ((int) mChannel.size() == channelLength) return;
+  int nu = channelLength-1;
+  mChannel.resize(channelLength);
+  mFeedback.resize(nu);
+  mL.resize(Nf*(Nf+nu));
+  mValid = false;
+}
+
+bool DFEState::moved(const signalVector &channelResponse,
+		     float SNRestimate,
+		     float offset) const
+{
+  if (!mValid || (channelResponse.size() != mChannel.size())) return true;
+  if (offset != mOffset) return true;
+
+  float ratio = SNRestimate/mSNR;
+  if (ratio < 1.0) ratio = 1.0/ratio;
+  if (ratio > mSNRRatio) return true;
+
+  // squared distance against the squared norm, no square roots needed
+  float error = 0.0;
+  signalVector::const_iterator newPtr = channelResponse.begin();
+  signalVector::const_iterator oldPtr = mChannel.begin();
+  while (oldPtr < mChannel.end()) {
+    error += (*newPtr - *oldPtr).norm2();
+    newPtr++; oldPtr++;
+  }
+  return (error > mChannelDistance*mChannelDistance*vectorNorm2(mChannel));
+}
+
+bool DFEState::update(const signalVector &channelResponse,
+		      float SNRestimate,
+		      float offset)
+{
+  if (!moved(channelResponse,SNRestimate,offset)) return false;
+  design(channelResponse,SNRestimate,offset);
+  return true;
+}
+
 // Assumes symbol-spaced sampling!!!
 // Based upon paper by Al-Dhahir and Cioffi
-bool designDFE(signalVector &channelResponse,
-	       float SNRestimate,
-	       int Nf,
-	       signalVector **feedForwardFilter,
-	       signalVector **feedbackFilter)
+void DFEState::design(const signalVector &channelResponse,
+		      float SNRestimate,
+		      float offset)
 {
-  
-  signalVector G0(Nf);
-  signalVector G1(Nf);
+  resize(channelResponse.size());
+  channelResponse.copyTo(mChannel);
+  mSNR = SNRestimate;
+  mOffset = offset;
+
+  signalVector &G0 = mG0;
+  signalVector &G1 = mG1;
+  signalVector &G0new = mG0new;
+  signalVector &G1new = mG1new;
+  G0.fill(0.0);
+  G1.fill(0.0);
+  mL.fill(0.0);
+
   signalVector::iterator G0ptr = G0.begin();
   signalVector::iterator G1ptr = G1.begin();
-  signalVector::iterator chanPtr = channelResponse.begin();
+  signalVector::const_iterator chanPtr = channelResponse.begin();
 
   int nu = channelResponse.size()-1;
+  int rowLen = Nf+nu;
 
   *G0ptr = 1.0/sqrtf(SNRestimate);
-  for(int j = 0; j <= nu; j++) {
+  for(int j = 0; (j <= nu) && (j < Nf); j++) {
     *G1ptr = chanPtr->conj();
     G1ptr++; chanPtr++;
   }
 
-  signalVector *L[Nf];
   signalVector::iterator Lptr;
   float d;
   for(int i = 0; i < Nf; i++) {
     d = G0.begin()->norm2() + G1.begin()->norm2();
-    L[i] = new signalVector(Nf+nu);
-    Lptr = L[i]->begin()+i;
+    signalVector::iterator Lend = mL.begin()+(i+1)*rowLen;
+    Lptr = mL.begin()+i*rowLen+i;
     G0ptr = G0.begin(); G1ptr = G1.begin();
-    while ((G0ptr < G0.end()) &&  (Lptr < L[i]->end())) {
+    while ((G0ptr < G0.end()) &&  (Lptr < Lend)) {
       *Lptr = (*G0ptr*(G0.begin()->conj()) + *G1ptr*(G1.begin()->conj()) )/d;
       Lptr++;
       G0ptr++;
@@ -1317,33 +1978,31 @@ bool designDFE(signalVector &channelResponse,
     complex k = (*G1.begin())/(*G0.begin());
 
     if (i != Nf-1) {
-      signalVector G0new = G1;
+      G1.copyTo(G0new);
       scaleVector(G0new,k.conj());
       addVector(G0new,G0);
 
-      signalVector G1new = G0;
+      G0.copyTo(G1new);
       scaleVector(G1new,k*(-1.0));
       addVector(G1new,G1);
       delayVector(G1new,-1.0);
 
       scaleVector(G0new,1.0/sqrtf(1.0+k.norm2()));
       scaleVector(G1new,1.0/sqrtf(1.0+k.norm2()));
-      G0 = G0new;
-      G1 = G1new;
+      G0new.copyTo(G0);
+      G1new.copyTo(G1);
     }
   }
 
-  *feedbackFilter = new signalVector(nu);
-  L[Nf-1]->segmentCopyTo(**feedbackFilter,Nf,nu);
-  scaleVector(**feedbackFilter,(complex) -1.0);
-  conjugateVector(**feedbackFilter);
+  mL.segmentCopyTo(mFeedback,(Nf-1)*rowLen+Nf,nu);
+  scaleVector(mFeedback,(complex) -1.0);
+  conjugateVector(mFeedback);
 
-  signalVector v(Nf);
-  signalVector::iterator vStart = v.begin();
+  signalVector::iterator vStart = mV.begin();
   signalVector::iterator vPtr;
   *(vStart+Nf-1) = (complex) 1.0;
   for(int k = Nf-2; k >= 0; k--) {
-    Lptr = L[k]->begin()+k+1;
+    Lptr = mL.begin()+k*rowLen+k+1;
     vPtr = vStart + k+1;
     complex v_k = 0.0;
     for (int j = k+1; j < Nf; j++) {
@@ -1353,10 +2012,8 @@ bool designDFE(signalVector &channelResponse,
      *(vStart + k) = v_k;
   }
 
-  *feedForwardFilter = new signalVector(Nf);
-  signalVector::iterator w = (*feedForwardFilter)->begin();
+  signalVector::iterator w = mForward.begin();
   for (int i = 0; i < Nf; i++) {
-    delete L[i];
     complex w_i = 0.0;
     int endPt = ( nu < (Nf-1-i) ) ? nu : (Nf-1-i);
     vPtr = vStart+i;
@@ -1369,9 +2026,22 @@ bool designDFE(signalVector &channelResponse,
     w++;
   }
 
+  mValid = true;
+}
+
+bool designDFE(signalVector &channelResponse,
+	       float SNRestimate,
+	       int Nf,
+	       signalVector **feedForwardFilter,
+	       signalVector **feedbackFilter)
+{
+  DFEState dfe(Nf);
+  dfe.design(channelResponse,SNRestimate);
+
+  *feedForwardFilter = new signalVector(dfe.forward());
+  *feedbackFilter = new signalVector(dfe.feedback());
 
   return true;
-  
 }
 
 // Assumes symbol-rate sampling!!!!
@@ -1379,23 +2049,34 @@ SoftVector *equalizeBurst(signalVector &rxBurst,
 		       float TOA,
 		       int samplesPerSymbol,
 		       signalVector &w, // feedforward filter
-		       signalVector &b) // feedback filter
+		       signalVector &b, // feedback filter
+		       SoftVector *burstBits)
 {
 
-  delayVector(rxBurst,-TOA);
+  // the rotation tables cover one burst
+  if (rxBurst.size() > GMSKRotation->size())
+    return NULL;
+
+  if (burstBits==NULL)
+    burstBits = new SoftVector(rxBurst.size());
+  else if (burstBits->size()!=rxBurst.size())
+    return NULL;
 
-  signalVector* postForwardFull = convolve(&rxBurst,&w,NULL,FULL_SPAN);
+  delayVector(rxBurst,-TOA);
 
-  signalVector* postForward = new signalVector(rxBurst.size());
-  postForwardFull->segmentCopyTo(*postForward,w.size()-1,rxBurst.size());
-  delete postForwardFull;
+  complex *postForwardData = scratchSamples(SCRATCH_FORWARD,rxBurst.size());
+  signalVector postForwardVector(postForwardData,0,rxBurst.size());
+  signalVector* postForward = &postForwardVector;
+  convolve(&rxBurst,&w,postForward,CUSTOM,w.size()-1,rxBurst.size());
 
   signalVector::iterator dPtr = postForward->begin();
   signalVector::iterator dBackPtr;
   signalVector::iterator rotPtr = GMSKRotation->begin();
   signalVector::iterator revRotPtr = GMSKReverseRotation->begin();
 
-  signalVector *DFEoutput = new signalVector(postForward->size());
+  complex *DFEoutputData = scratchSamples(SCRATCH_DFE,postForward->size());
+  signalVector DFEoutputVector(DFEoutputData,0,postForward->size());
+  signalVector *DFEoutput = &DFEoutputVector;
   signalVector::iterator DFEItr = DFEoutput->begin();
 
   // NOTE: can insert the midamble and/or use midamble to estimate BER
@@ -1420,15 +2101,78 @@ SoftVector *equalizeBurst(signalVector &rxBurst,
 
   vectorSlicer(DFEoutput);
 
-  SoftVector *burstBits = new SoftVector(postForward->size());
   SoftVector::iterator burstItr = burstBits->begin();
   DFEItr = DFEoutput->begin();
   for (; DFEItr < DFEoutput->end(); DFEItr++) 
     *burstItr++ = DFEItr->real();
 
-  delete postForward;
+  return burstBits;
+}
+
+SoftVector *mlseEqualizeBurst(signalVector &rxBurst,
+			      float TOA,
+			      int samplesPerSymbol,
+			      const signalVector &channelResponse,
+			      float channelOffset,
+			      float SNRestimate,
+			      int memory,
+			      SoftVector *burstBits)
+{
+  // the trellis runs on symbols, so does the channel estimate
+  if ((samplesPerSymbol != 1) ||
+      (memory < MLSE_MIN_MEMORY) || (memory > MLSE_MAX_MEMORY) ||
+      (memory >= (int) channelResponse.size()) ||
+      (rxBurst.size() > MLSE_MAX_SYMBOLS) ||
+      (rxBurst.size() > GMSKReverseRotation->size()))
+    return NULL;
+
+  if (burstBits==NULL)
+    burstBits = new SoftVector(rxBurst.size());
+  else if (burstBits->size()!=rxBurst.size())
+    return NULL;
 
-  delete DFEoutput;
+  delayVector(rxBurst,-(TOA-channelOffset));
+
+  // The estimate is of the rotated channel, r[n] = sum h[k] s[n-k] with
+  // s[n] = GMSKRotation[n] a[n].  After derotation the taps seen by the
+  // symbols a[n] are h[k]*GMSKReverseRotation[k].  Keep the window of
+  // memory+1 taps with the most energy and align the burst to its start.
+  int numTaps = memory+1;
+  int start = 0;
+  float maxEnergy = -1.0;
+  for (int i = 0; i + numTaps <= (int) channelResponse.size(); i++) {
+    float energy = 0.0;
+    for (int k = 0; k < numTaps; k++)
+      energy += channelResponse[i+k].norm2();
+    if (energy > maxEnergy) {
+      maxEnergy = energy;
+      start = i;
+    }
+  }
+
+  complex taps[MLSE_MAX_MEMORY+1];
+  for (int k = 0; k < numTaps; k++)
+    taps[k] = channelResponse[start+k] * (*GMSKReverseRotation)[start+k];
+
+  complex symbolData[MLSE_MAX_SYMBOLS];
+  int numSymbols = rxBurst.size();
+  for (int n = 0; n < numSymbols; n++) {
+    if (n+start < numSymbols)
+      symbolData[n] = rxBurst[n+start] * (*GMSKReverseRotation)[n+start];
+    else
+      symbolData[n] = 0.0;
+  }
+
+  // the burst is scaled to the channel, so the noise variance is 1/SNR
+  float noiseVar = (SNRestimate > 0.0) ? 1.0/SNRestimate : 1.0;
+
+  float softData[MLSE_MAX_SYMBOLS];
+  if (mlseSoft((float *) symbolData,numSymbols,(float *) taps,memory,noiseVar,softData) < 0)
+    return NULL;
+
+  SoftVector::iterator burstItr = burstBits->begin();
+  for (int n = 0; n < numSymbols; n++)
+    *burstItr++ = softData[n];
 
   return burstBits;
 }
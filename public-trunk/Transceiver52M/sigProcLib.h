@@ -28,6 +28,8 @@
 #include "Vector.h"
 #include "Complex.h"
 #include "GSMTransfer.h"
+#include "mlse.h"
+#include "fixed.h"
 
 
 using namespace GSM;
@@ -174,11 +176,20 @@ signalVector* correlate(signalVector *a,
 /** Operate soft slicer on real-valued portion of vector */ 
 bool vectorSlicer(signalVector *x);
 
-/** GMSK modulate a GSM burst of bits */
+/** 
+	GMSK modulate a GSM burst of bits.
+	@param wBurst The bits to be modulated.
+	@param gsmPulse The GSM pulse.
+	@param guardPeriodLength The number of guard symbols after the bits.
+	@param samplesPerSymbol The number of samples per GSM symbol.
+	@param modBurst A preallocated vector of the burst length to hold the result.
+	@return The modulated burst.
+*/
 signalVector *modulateBurst(const BitVector &wBurst,
 			    const signalVector &gsmPulse,
 			    int guardPeriodLength,
-			    int samplesPerSymbol);
+			    int samplesPerSymbol,
+			    signalVector *modBurst = NULL);
 
 /** Sinc function */
 float sinc(float x);
@@ -264,6 +275,18 @@ bool energyDetect(signalVector &rxBurst,
                   float detectThreshold,
                   float *avgPwr = NULL);
 
+/**
+        Energy detector on a burst in the device format, see fixed.h.
+        @param rxBurst The received burst, interleaved 16-bit complex samples.
+        @param burstLength The number of samples in the burst.
+        The other parameters are those of the floating point version.
+*/
+bool energyDetect(const short *rxBurst,
+		  unsigned burstLength,
+		  unsigned windowLength,
+                  float detectThreshold,
+                  float *avgPwr = NULL);
+
 /**
         RACH correlator/detector.
         @param rxBurst The received GSM burst of interest.
@@ -279,6 +302,20 @@ bool detectRACHBurst(signalVector &rxBurst,
 		     complex *amplitude,
 		     float* TOA);
 
+/**
+        RACH correlator/detector on a burst in the device format.
+        The correlation runs in fixed point, the peak search in floating
+        point, otherwise as the floating point version.
+        @param rxBurst The received burst, interleaved 16-bit complex samples.
+        @param burstLength The number of samples in the burst.
+*/
+bool detectRACHBurst(const short *rxBurst,
+		     unsigned burstLength,
+		     float detectThreshold,
+		     int samplesPerSymbol,
+		     complex *amplitude,
+		     float* TOA);
+
 /**
         Normal burst correlator, detector, channel estimator.
         @param rxBurst The received GSM burst of interest.
@@ -304,6 +341,26 @@ bool analyzeTrafficBurst(signalVector &rxBurst,
 			 signalVector** channelResponse = NULL,
 			 float *channelResponseOffset = NULL);
 
+/**
+        Normal burst correlator, detector, channel estimator on a burst in
+        the device format. The correlation runs in fixed point, the peak
+        search and channel estimate in floating point, otherwise as the
+        floating point version.
+        @param rxBurst The received burst, interleaved 16-bit complex samples.
+        @param burstLength The number of samples in the burst.
+*/
+bool analyzeTrafficBurst(const short *rxBurst,
+			 unsigned burstLength,
+			 unsigned TSC,
+			 float detectThreshold,
+			 int samplesPerSymbol,
+			 complex *amplitude,
+			 float *TOA,
+                         unsigned maxTOA,
+                         bool requestChannel = false,
+			 signalVector** channelResponse = NULL,
+			 float *channelResponseOffset = NULL);
+
 /**
 	Decimate a vector.
         @param wVector The vector of interest.
@@ -320,13 +377,30 @@ signalVector *decimateVector(signalVector &wVector,
         @param samplesPerSymbol The number of samples per GSM symbol.
         @param channel The amplitude estimate of the received burst.
         @param TOA The time-of-arrival of the received burst.
+        @param burstBits A preallocated vector of one value per symbol to hold the result.
         @return The demodulated bit sequence.
 */
 SoftVector *demodulateBurst(signalVector &rxBurst,
 			 const signalVector &gsmPulse,
 			 int samplesPerSymbol,
 			 complex channel,
-			 float TOA);
+			 float TOA,
+			 SoftVector *burstBits = NULL);
+
+/**
+        Demodulates a burst in the device format using a soft-slicer.
+        Only the sample of each symbol is delayed and rotated, the delay
+        filter runs in fixed point.
+	@param rxBurst The received burst, interleaved 16-bit complex samples.
+        @param burstLength The number of samples in the burst.
+        The other parameters are those of the floating point version.
+*/
+SoftVector *demodulateBurst(const short *rxBurst,
+			 unsigned burstLength,
+			 int samplesPerSymbol,
+			 complex channel,
+			 float TOA,
+			 SoftVector *burstBits = NULL);
 
 /**
         Creates a simple Kaiser-windowed low-pass FIR filter.
@@ -377,6 +451,75 @@ bool designDFE(signalVector &channelResponse,
 	       signalVector **feedForwardFilter,
 	       signalVector **feedbackFilter);
 
+/**
+	The decision-feedback equalizer of one timeslot.
+	The filters are kept from burst to burst and redesigned only when the
+	channel estimate or the SNR has moved too far from the ones they were
+	designed for.  The solver workspace is kept along with them, so a
+	redesign does not allocate unless the channel length changes.
+*/
+class DFEState {
+
+ private:
+
+  int Nf;			///< number of feedforward taps
+  float mChannelDistance;	///< relative channel change that forces a redesign
+  float mSNRRatio;		///< SNR ratio that forces a redesign
+
+  bool mValid;			///< true if the filters have been designed
+  signalVector mChannel;	///< channel the filters were designed for
+  float mSNR;			///< SNR the filters were designed for
+  float mOffset;		///< channel response offset of mChannel
+
+  signalVector mForward;	///< feedforward filter
+  signalVector mFeedback;	///< feedback filter
+
+  /** solver workspace */
+  signalVector mL;		///< rows of the factorization, Nf by Nf+nu
+  signalVector mG0, mG1, mG0new, mG1new, mV;
+
+  /** Size the filters and workspace for a channel of the given length */
+  void resize(int channelLength);
+
+  /** True if the filters need to be redesigned for this channel */
+  bool moved(const signalVector &channelResponse, float SNRestimate, float offset) const;
+
+ public:
+
+  /**
+	@param wNf The number of taps in the feedforward filter.
+	@param channelDistance Relative channel error, |h-h0|/|h0|, that forces a redesign.
+	@param SNRDistance SNR change in dB that forces a redesign.
+  */
+  DFEState(int wNf = 7, float channelDistance = 0.1, float SNRDistance = 3.0);
+
+  /** Set the distances that force a redesign, as for the constructor */
+  void distances(float channelDistance, float SNRDistance);
+
+  /**
+	Design the filters for a channel, unconditionally.
+	@param channelResponse The channel, normalized to the burst amplitude.
+	@param SNRestimate The linear signal-to-noise estimate.
+	@param offset The channel response offset from analyzeTrafficBurst.
+  */
+  void design(const signalVector &channelResponse, float SNRestimate, float offset = 0.0);
+
+  /**
+	Redesign the filters if the channel or SNR has moved, or none exist.
+	@return True if the filters were redesigned.
+  */
+  bool update(const signalVector &channelResponse, float SNRestimate, float offset);
+
+  /** Forget the filters, the next update designs new ones */
+  void reset() { mValid = false; }
+
+  bool valid() const { return mValid; }
+  float offset() const { return mOffset; }
+  float SNR() const { return mSNR; }
+  signalVector &forward() { return mForward; }
+  signalVector &feedback() { return mFeedback; }
+};
+
 /**
 	Equalize/demodulate a received burst via a decision-feedback equalizer.
 	@param rxBurst The received burst to be demodulated.
@@ -384,12 +527,36 @@ bool designDFE(signalVector &channelResponse,
 	@param samplesPerSymbol The number of samples per GSM symbol.
 	@param w The feed forward filter of the DFE.
 	@param b The feedback filter of the DFE.
-	@return The demodulated bit sequence.
+	@param burstBits A preallocated vector of one value per symbol to hold the result.
+	@return The demodulated bit sequence, NULL if the burst is longer than a burst period.
 */
 SoftVector *equalizeBurst(signalVector &rxBurst,
 		       float TOA,
 		       int samplesPerSymbol,
 		       signalVector &w, 
-		       signalVector &b);
+		       signalVector &b,
+		       SoftVector *burstBits = NULL);
+
+/**
+	Equalize/demodulate a received burst via a max-log-MAP sequence estimator.
+	The strongest memory+1 taps of the channel estimate are used.
+	@param rxBurst The received burst to be demodulated, scaled to the channel estimate.
+	@param TOA The time-of-arrival of the received burst.
+	@param samplesPerSymbol The number of samples per GSM symbol, only 1 is supported.
+	@param channelResponse The channel estimate from analyzeTrafficBurst.
+	@param channelOffset The channel response offset from analyzeTrafficBurst.
+	@param SNRestimate The SNR of the burst, sets the confidence of the soft bits.
+	@param memory The channel memory in symbols, MLSE_MIN_MEMORY to MLSE_MAX_MEMORY.
+	@param burstBits A preallocated vector of one value per symbol to hold the result.
+	@return The demodulated bit sequence, NULL on bad arguments.
+*/
+SoftVector *mlseEqualizeBurst(signalVector &rxBurst,
+			      float TOA,
+			      int samplesPerSymbol,
+			      const signalVector &channelResponse,
+			      float channelOffset,
+			      float SNRestimate,
+			      int memory,
+			      SoftVector *burstBits = NULL);
 
 #endif /* SIGPROCLIB_H */
@@ -0,0 +1,448 @@
+/*
+* Copyright 2011 Free Software Foundation, Inc.
+*
+* This software is distributed under the terms of the GNU Affero Public License.
+* See the COPYING file in the main directory for details.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+  Micro-benchmark of the sigProcLib burst kernels.
+
+  Every kernel runs on the same synthetic bursts, a normal burst through a
+  two path channel and a RACH burst, both with gaussian noise from a fixed
+  seed.  The first call of each kernel is fingerprinted and checked against
+  the reference output below, so a faster kernel that changes the results
+  shows up as a mismatch.  The timed calls follow on the same thread, so
+  the rates are per core.
+
+  mlseEqualizeBurst runs at a channel memory of 4, where it should cost no
+  more than designDFE and equalizeBurst together.  Its trellis runs on
+  symbols, so at 4 samples per symbol it returns no bits and the row only
+  times the rejection, with an empty fingerprint.
+
+  Output is CSV on stdout, one line per kernel and samples per symbol:
+
+    kernel,sps,iterations,ns_per_burst,bursts_per_sec,energy,signature,golden
+
+  The energy is the sum of the squared outputs and the signature a sum of
+  the outputs with fixed pseudo-random weights, so it also catches outputs
+  that are reordered or conjugated.  Both are compared with a relative
+  tolerance, which absorbs rounding differences between vector kernels.
+  The reference values assume the glibc rand() behind gaussianNoise().
+
+  Usage: sigProcLibBench [iterations] [-g]
+
+  -g prints the golden table for the current build instead of the CSV.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "sigProcLib.h"
+#include "convolve.h"
+#include "GSMCommon.h"
+#include <Logger.h>
+#include <Configuration.h>
+
+using namespace std;
+
+ConfigurationTable gConfig;
+
+// relative tolerance of the golden comparison
+static const double goldenTolerance = 1e-4;
+
+struct Golden {
+  const char *kernel;
+  int sps;
+  double energy;
+  double signature;
+};
+
+// reference outputs of the original kernels, regenerate with -g
+static const Golden goldens[] = {
+  { "convolve", 1, 210704142, -4353.9589 },
+  { "correlate", 1, 5.71965587e+09, 2812.06278 },
+  { "frequencyShift", 1, 168599236, -128.287141 },
+  { "modulateBurst", 1, 147.298552, 2.21415107 },
+  { "detectRACHBurst", 1, 1040800.4, -528.09062 },
+  { "analyzeTrafficBurst", 1, 2156221.26, -1029.14236 },
+  { "demodulateBurst", 1, 63.115825, -3.36904735 },
+  { "designDFE", 1, 1.53100764, 0.307015159 },
+  { "equalizeBurst", 1, 67.6225323, -3.60073016 },
+  { "mlseEqualizeBurst", 1, 74.9497172, -3.56502857 },
+  { "polyphaseResampleVector", 1, 116712036, 1147.65162 },
+  { "convolve", 4, 1.42309632e+10, 26155.9521 },
+  { "correlate", 4, 3.81526284e+11, 45149.0394 },
+  { "frequencyShift", 4, 683894151, 3057.56374 },
+  { "modulateBurst", 4, 589.797196, 3.5814984 },
+  { "detectRACHBurst", 4, 984654.558, -514.583799 },
+  { "analyzeTrafficBurst", 4, 5685149.17, -1562.67173 },
+  { "demodulateBurst", 4, 62.5116749, -3.00533365 },
+  { "designDFE", 4, 19.7146002, -0.752901752 },
+  { "equalizeBurst", 4, 291.678225, -7.6750246 },
+  { "mlseEqualizeBurst", 4, 0, 0 },
+  { "polyphaseResampleVector", 4, 469473937, 5955.39884 },
+  { NULL, 0, 0.0, 0.0 }
+};
+
+class Fingerprint {
+
+public:
+  double energy;	///< sum of squares of the outputs
+  double signature;	///< weighted sum of the outputs
+  unsigned count;	///< number of real outputs
+
+  Fingerprint() : energy(0.0), signature(0.0), count(0) {}
+
+  void add(float x)
+  {
+    // Knuth multiplicative hash of the index, mapped onto [-1,1)
+    unsigned h = (count++ + 1) * 2654435761U;
+    double w = (double) (h >> 16) / 32768.0 - 1.0;
+    energy += (double) x * x;
+    signature += w * x;
+  }
+
+  void add(complex x) { add(x.real()); add(x.imag()); }
+
+  void add(const signalVector &v)
+  {
+    for (signalVector::const_iterator i = v.begin(); i < v.end(); i++)
+      add(*i);
+  }
+
+  void add(const SoftVector &v)
+  {
+    for (size_t i = 0; i < v.size(); i++)
+      add(v[i]);
+  }
+};
+
+// state shared by the kernels at one rate
+struct BenchContext {
+  int sps;
+  int TSC;
+  signalVector *gsmPulse;
+  BitVector *normalBits;	///< bits of the normal burst
+  signalVector *normalBurst;	///< received normal burst
+  signalVector *rachBurst;	///< received RACH burst
+  signalVector *midamble;	///< modulated training sequence
+  signalVector *lpf;		///< resampling filter
+  signalVector *modBurst;	///< modulator output
+  signalVector *work;		///< copy of a burst for kernels that modify it
+  SoftVector *demodBits;	///< demodulator output
+  SoftVector *eqBits;		///< equalizer output
+
+  // traffic burst estimates, as the transceiver would keep them
+  complex amplitude;
+  float TOA;
+  signalVector *chanResp;
+  float chanOffset;
+  float SNR;
+  signalVector *DFEForward;
+  signalVector *DFEFeedback;
+};
+
+static const int resampP = 96;
+static const int resampQ = 65;
+
+typedef void (*BenchKernel)(BenchContext &ctx, Fingerprint *fp);
+
+static void benchConvolve(BenchContext &ctx, Fingerprint *fp)
+{
+  signalVector *y = convolve(ctx.normalBurst,ctx.gsmPulse,NULL,NO_DELAY);
+  if (fp) fp->add(*y);
+  delete y;
+}
+
+static void benchCorrelate(BenchContext &ctx, Fingerprint *fp)
+{
+  signalVector *y = correlate(ctx.normalBurst,ctx.midamble,NULL,NO_DELAY);
+  if (fp) fp->add(*y);
+  delete y;
+}
+
+// quarter symbol rate, the GMSK rotation, from an arbitrary phase
+static void benchFrequencyShift(BenchContext &ctx, Fingerprint *fp)
+{
+  frequencyShift(ctx.work,ctx.normalBurst,M_PI/2.0/ctx.sps,0.3);
+  if (fp) fp->add(*ctx.work);
+}
+
+static void benchModulateBurst(BenchContext &ctx, Fingerprint *fp)
+{
+  modulateBurst(*ctx.normalBits,*ctx.gsmPulse,8,ctx.sps,ctx.modBurst);
+  if (fp) fp->add(*ctx.modBurst);
+}
+
+static void benchDetectRACHBurst(BenchContext &ctx, Fingerprint *fp)
+{
+  complex amp; float toa = 0.0;
+  bool found = detectRACHBurst(*ctx.rachBurst,5.0,ctx.sps,&amp,&toa);
+  if (fp) { fp->add((float) found); fp->add(amp); fp->add(toa); }
+}
+
+static void benchAnalyzeTrafficBurst(BenchContext &ctx, Fingerprint *fp)
+{
+  complex amp; float toa = 0.0;
+  signalVector *chan = NULL;
+  float offset = 0.0;
+  bool found = analyzeTrafficBurst(*ctx.normalBurst,ctx.TSC,3.0,ctx.sps,
+                                   &amp,&toa,3*ctx.sps,true,&chan,&offset);
+  if (fp) {
+    fp->add((float) found); fp->add(amp); fp->add(toa); fp->add(offset);
+    if (chan) fp->add(*chan);
+  }
+  delete chan;
+}
+
+static void benchDemodulateBurst(BenchContext &ctx, Fingerprint *fp)
+{
+  ctx.normalBurst->copyTo(*ctx.work);
+  SoftVector *bits = demodulateBurst(*ctx.work,*ctx.gsmPulse,ctx.sps,
+                                     ctx.amplitude,ctx.TOA,ctx.demodBits);
+  if (fp && bits) fp->add(*bits);
+}
+
+static void benchDesignDFE(BenchContext &ctx, Fingerprint *fp)
+{
+  signalVector *w = NULL, *b = NULL;
+  designDFE(*ctx.chanResp,ctx.SNR,7,&w,&b);
+  if (fp) { fp->add(*w); fp->add(*b); }
+  delete w;
+  delete b;
+}
+
+static void benchEqualizeBurst(BenchContext &ctx, Fingerprint *fp)
+{
+  ctx.normalBurst->copyTo(*ctx.work);
+  scaleVector(*ctx.work,complex(1.0,0.0)/ctx.amplitude);
+  SoftVector *bits = equalizeBurst(*ctx.work,ctx.TOA-ctx.chanOffset,ctx.sps,
+                                   *ctx.DFEForward,*ctx.DFEFeedback,
+                                   ctx.eqBits);
+  if (fp && bits) fp->add(*bits);
+}
+
+// sequence estimator at the memory the DFE has to beat on CPU time
+static void benchMLSEEqualizeBurst(BenchContext &ctx, Fingerprint *fp)
+{
+  ctx.normalBurst->copyTo(*ctx.work);
+  scaleVector(*ctx.work,complex(1.0,0.0)/ctx.amplitude);
+  SoftVector *bits = mlseEqualizeBurst(*ctx.work,ctx.TOA,ctx.sps,
+                                       *ctx.chanResp,ctx.chanOffset,
+                                       ctx.SNR,4,ctx.eqBits);
+  if (fp && bits) fp->add(*bits);
+}
+
+static void benchPolyphaseResample(BenchContext &ctx, Fingerprint *fp)
+{
+  signalVector *y = polyphaseResampleVector(*ctx.normalBurst,resampP,resampQ,
+                                            ctx.lpf);
+  if (fp) fp->add(*y);
+  delete y;
+}
+
+struct BenchEntry {
+  const char *name;
+  BenchKernel kernel;
+};
+
+static const BenchEntry benchmarks[] = {
+  { "convolve", benchConvolve },
+  { "correlate", benchCorrelate },
+  { "frequencyShift", benchFrequencyShift },
+  { "modulateBurst", benchModulateBurst },
+  { "detectRACHBurst", benchDetectRACHBurst },
+  { "analyzeTrafficBurst", benchAnalyzeTrafficBurst },
+  { "demodulateBurst", benchDemodulateBurst },
+  { "designDFE", benchDesignDFE },
+  { "equalizeBurst", benchEqualizeBurst },
+  { "mlseEqualizeBurst", benchMLSEEqualizeBurst },
+  { "polyphaseResampleVector", benchPolyphaseResample },
+};
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static const Golden *findGolden(const char *kernel, int sps)
+{
+  for (const Golden *g = goldens; g->kernel; g++)
+    if (!strcmp(g->kernel,kernel) && (g->sps == sps)) return g;
+  return NULL;
+}
+
+// compare against the reference, the signature is bounded by the output norm
+static bool matchesGolden(const Golden &g, const Fingerprint &fp)
+{
+  double scale = sqrt(g.energy*fp.count) + 1e-6;
+  return (fabs(fp.energy - g.energy) <= goldenTolerance*(g.energy + 1e-6)) &&
+         (fabs(fp.signature - g.signature) <= goldenTolerance*scale);
+}
+
+static void setupContext(BenchContext &ctx, int sps)
+{
+  ctx.sps = sps;
+  ctx.TSC = 2;
+
+  sigProcLibSetup(sps);
+  ctx.gsmPulse = generateGSMPulse(2,sps);
+  generateMidamble(*ctx.gsmPulse,sps,ctx.TSC);
+  generateRACHSequence(*ctx.gsmPulse,sps);
+
+  srand(1);
+
+  // normal burst, random data around the training sequence
+  BitVector data(58);
+  for (size_t i = 0; i < data.size(); i++) data[i] = rand() & 0x01;
+  BitVector tail = "000";
+  ctx.normalBits = new BitVector(BitVector(BitVector(tail,data),
+                                           BitVector(gTrainingSequence[ctx.TSC],data)),
+                                 tail);
+
+  // two paths a symbol apart, half a symbol late, at 20 dB SNR
+  const float amplitude = 1000.0;
+  signalVector *tx = modulateBurst(*ctx.normalBits,*ctx.gsmPulse,8,sps);
+  signalVector channel(sps+1);
+  channel.fill(0.0);
+  channel[0] = complex(amplitude,0.0);
+  channel[sps] = complex(0.0,0.4*amplitude);
+  ctx.normalBurst = convolve(tx,&channel,NULL,NO_DELAY);
+  delayVector(*ctx.normalBurst,0.5*sps);
+  signalVector *noise = gaussianNoise(ctx.normalBurst->size(),
+                                      0.01*amplitude*amplitude);
+  addVector(*ctx.normalBurst,*noise);
+  delete noise;
+  delete tx;
+
+  // RACH burst after 8 tail bits, same noise
+  BitVector rachStart = "01010101";
+  BitVector rachRest(99);
+  for (size_t i = 0; i < rachRest.size(); i++) rachRest[i] = rand() & 0x01;
+  BitVector rachBits(BitVector(rachStart,gRACHSynchSequence),rachRest);
+  ctx.rachBurst = modulateBurst(rachBits,*ctx.gsmPulse,8,sps);
+  scaleVector(*ctx.rachBurst,amplitude);
+  noise = gaussianNoise(ctx.rachBurst->size(),0.01*amplitude*amplitude);
+  addVector(*ctx.rachBurst,*noise);
+  delete noise;
+
+  ctx.midamble = modulateBurst(gTrainingSequence[ctx.TSC],*ctx.gsmPulse,0,sps);
+  ctx.lpf = createLPF(1.0/resampP/3.0,651,resampQ);
+  ctx.modBurst = new signalVector(ctx.normalBurst->size());
+  ctx.work = new signalVector(ctx.normalBurst->size());
+  ctx.demodBits = new SoftVector(ctx.normalBurst->size()/sps);
+  ctx.eqBits = new SoftVector(ctx.normalBurst->size());
+
+  // channel estimate and equalizer, as in Transceiver::demodulate
+  ctx.chanResp = NULL;
+  ctx.DFEForward = ctx.DFEFeedback = NULL;
+  if (!analyzeTrafficBurst(*ctx.normalBurst,ctx.TSC,3.0,sps,&ctx.amplitude,
+                           &ctx.TOA,3*sps,true,&ctx.chanResp,&ctx.chanOffset)) {
+    fprintf(stderr,"no training sequence found at %d sps\n",sps);
+    exit(1);
+  }
+  ctx.SNR = 100.0;
+  scaleVector(*ctx.chanResp,complex(1.0,0.0)/ctx.amplitude);
+  designDFE(*ctx.chanResp,ctx.SNR,7,&ctx.DFEForward,&ctx.DFEFeedback);
+}
+
+static void destroyContext(BenchContext &ctx)
+{
+  delete ctx.gsmPulse;
+  delete ctx.normalBits;
+  delete ctx.normalBurst;
+  delete ctx.rachBurst;
+  delete ctx.midamble;
+  delete ctx.lpf;
+  delete ctx.modBurst;
+  delete ctx.work;
+  delete ctx.demodBits;
+  delete ctx.eqBits;
+  delete ctx.chanResp;
+  delete ctx.DFEForward;
+  delete ctx.DFEFeedback;
+  sigProcLibDestroy();
+}
+
+int main(int argc, char **argv)
+{
+  gLogInit("ERROR");
+
+  int iterations = 10000;
+  bool printGoldens = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i],"-g")) printGoldens = true;
+    else iterations = atoi(argv[i]);
+  }
+  if (iterations <= 0) {
+    fprintf(stderr,"usage: %s [iterations] [-g]\n",argv[0]);
+    return 1;
+  }
+
+  static const int spsList[] = { 1, 4 };
+  const unsigned numBenchmarks = sizeof(benchmarks)/sizeof(benchmarks[0]);
+  int failures = 0;
+
+  convolveInit();
+  if (!printGoldens) {
+    printf("# convolve kernel: %s\n",convolveImpl());
+    printf("kernel,sps,iterations,ns_per_burst,bursts_per_sec,energy,signature,golden\n");
+  }
+
+  for (unsigned s = 0; s < sizeof(spsList)/sizeof(spsList[0]); s++) {
+    BenchContext ctx;
+    setupContext(ctx,spsList[s]);
+
+    for (unsigned k = 0; k < numBenchmarks; k++) {
+      const BenchEntry &b = benchmarks[k];
+
+      // first call also warms the caches and any static tables
+      Fingerprint fp;
+      b.kernel(ctx,&fp);
+
+      if (printGoldens) {
+        printf("  { \"%s\", %d, %.9g, %.9g },\n",
+               b.name,ctx.sps,fp.energy,fp.signature);
+        continue;
+      }
+
+      double start = now();
+      for (int i = 0; i < iterations; i++)
+        b.kernel(ctx,NULL);
+      double ns = (now() - start)/iterations;
+
+      const Golden *g = findGolden(b.name,ctx.sps);
+      const char *status = "none";
+      if (g && matchesGolden(*g,fp)) status = "ok";
+      else if (g) { status = "MISMATCH"; failures++; }
+
+      printf("%s,%d,%d,%.1f,%.0f,%.9g,%.9g,%s\n",
+             b.name,ctx.sps,iterations,ns,1e9/ns,fp.energy,fp.signature,status);
+      fflush(stdout);
+    }
+
+    destroyContext(ctx);
+  }
+
+  return failures ? 2 : 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <string.h>
+
+#include "txLatency.h"
+#include "GSMCommon.h"
+#include "Logger.h"
+
+/* Frames between latency increases for underruns */
+#define TXLATENCY_UNDERRUN_HOLDOFF	10
+
+static int slackBin(int slack)
+{
+	if (slack < 0)
+		return 0;
+	if (slack >= TXSLACK_BINS)
+		return TXSLACK_BINS - 1;
+	return slack;
+}
+
+TxLatencyController::TxLatencyController(int latency, int minLatency,
+					 int maxLatency)
+	: mLatency(latency), mMinLatency(minLatency), mMaxLatency(maxLatency),
+	  mGuard(0), mPercentile(TXLATENCY_PERCENTILE), mPeriodStart(0),
+	  mLastUnderrun(0), mStarted(false), mQuiet(true),
+	  mUnderruns(0), mRaised(0), mLowered(0)
+{
+	for (int i = 0; i < TXSLACK_BINS; i++) {
+		mWindow[i] = 0.0;
+		mSlack[i] = 0;
+	}
+}
+
+int TxLatencyController::update(int fn, int slack, bool underrun, bool adapt)
+{
+	mLock.lock();
+
+	if (!mStarted) {
+		mPeriodStart = fn;
+		mLastUnderrun = fn - TXLATENCY_UNDERRUN_HOLDOFF - 1;
+		mStarted = true;
+	}
+
+	int bin = slackBin(slack);
+	mSlack[bin]++;
+	mWindow[bin] += 1.0;
+
+	if (underrun) {
+		mUnderruns++;
+		mQuiet = false;
+		if (adapt &&
+		    (GSM::FNDelta(fn, mLastUnderrun) > TXLATENCY_UNDERRUN_HOLDOFF)) {
+			mGuard += 8;
+			if (mGuard > mMaxLatency)
+				mGuard = mMaxLatency;
+			setLatency(mLatency + 8);
+			mRaised++;
+			mLastUnderrun = fn;
+			LOG(INFO) << "underrun, transmit latency raised to "
+				  << mLatency << " timeslots";
+		}
+	}
+
+	if (GSM::FNDelta(fn, mPeriodStart) >= TXLATENCY_PERIOD) {
+		if (adapt)
+			decide();
+		for (int i = 0; i < TXSLACK_BINS; i++)
+			mWindow[i] *= 0.5;
+		mPeriodStart = fn;
+		mQuiet = true;
+	}
+
+	int latency = mLatency;
+	mLock.unlock();
+
+	return latency;
+}
+
+/* Move the latency, and the recent slack with it */
+void TxLatencyController::setLatency(int latency)
+{
+	if (latency < mMinLatency)
+		latency = mMinLatency;
+	if (latency > mMaxLatency)
+		latency = mMaxLatency;
+
+	int delta = latency - mLatency;
+	if (!delta)
+		return;
+
+	double window[TXSLACK_BINS];
+	for (int i = 0; i < TXSLACK_BINS; i++)
+		window[i] = 0.0;
+	for (int i = 0; i < TXSLACK_BINS; i++)
+		window[slackBin(i + delta)] += mWindow[i];
+	memcpy(mWindow, window, sizeof(mWindow));
+
+	mLatency = latency;
+}
+
+void TxLatencyController::decide()
+{
+	if (mQuiet && (mGuard > 0))
+		mGuard--;
+
+	double total = 0.0;
+	for (int i = 0; i < TXSLACK_BINS; i++)
+		total += mWindow[i];
+	if (total < TXLATENCY_MIN_SAMPLES)
+		return;
+
+	/* Least slack of the target share of wakeups, from the low end */
+	double tail = total * (1000 - mPercentile) / 1000.0;
+	double sum = 0.0;
+	int slack;
+	for (slack = 0; slack < TXSLACK_BINS - 1; slack++) {
+		sum += mWindow[slack];
+		if (sum > tail)
+			break;
+	}
+
+	int need = TXLATENCY_MARGIN + mGuard;
+	if (slack < need) {
+		int old = mLatency;
+		setLatency(mLatency + need - slack);
+		if (mLatency == old)
+			return;
+		mRaised++;
+		LOG(INFO) << "transmit latency raised to " << mLatency
+			  << " timeslots, slack " << slack << " at the target";
+	} else if ((slack > need) && (mLatency > mMinLatency)) {
+		setLatency(mLatency - 1);
+		mLowered++;
+		LOG(INFO) << "transmit latency lowered to " << mLatency
+			  << " timeslots, slack " << slack << " at the target";
+	}
+}
+
+void TxLatencyController::setPercentile(int permille)
+{
+	if (permille < 500)
+		permille = 500;
+	if (permille > 1000)
+		permille = 1000;
+
+	mLock.lock();
+	mPercentile = permille;
+	mLock.unlock();
+}
+
+TxLatencyStats TxLatencyController::stats()
+{
+	TxLatencyStats stats;
+
+	mLock.lock();
+	stats.latency = mLatency;
+	stats.guard = mGuard;
+	stats.percentile = mPercentile;
+	stats.underruns = mUnderruns;
+	stats.raised = mRaised;
+	stats.lowered = mLowered;
+	memcpy(stats.slack, mSlack, sizeof(stats.slack));
+	mLock.unlock();
+
+	return stats;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef TXLATENCY_H
+#define TXLATENCY_H
+
+#include "Threads.h"
+
+/* Slack histogram bins, one timeslot each; the first bin also holds
+   wakeups with no slack left and the last every slack beyond it */
+#define TXSLACK_BINS		32
+
+/* Frames between latency decisions */
+#define TXLATENCY_PERIOD	216
+
+/* Default share of wakeups that must find at least the margin of slack,
+   in tenths of a percent */
+#define TXLATENCY_PERCENTILE	999
+
+/* Slack kept at the percentile target, in timeslots */
+#define TXLATENCY_MARGIN	2
+
+/* Highest latency, in timeslots */
+#define TXLATENCY_MAX		160
+
+/* Wakeups needed in the window before the latency is lowered */
+#define TXLATENCY_MIN_SAMPLES	100
+
+/** Transmit latency counters */
+struct TxLatencyStats {
+	int latency;			///< current latency in timeslots
+	int guard;			///< slack added after underruns, in timeslots
+	int percentile;			///< target in tenths of a percent
+	unsigned long underruns;	///< underruns seen by the device
+	unsigned long raised;		///< latency increases
+	unsigned long lowered;		///< latency decreases
+	unsigned long slack[TXSLACK_BINS]; ///< wakeups by slack since start
+};
+
+/*
+    TxLatencyController - Transmit latency from the measured slack of
+                          the transmit loop. Slack is how many timeslots
+                          of samples were still queued ahead of the radio
+                          clock each time the loop woke up to top them
+                          up; it absorbs the clock steps and the
+                          scheduling delays of the loop.
+
+                          Once a period the latency is set so that the
+                          target share of recent wakeups kept at least
+                          the margin of slack, plus a guard. The latency
+                          is raised in one step but lowered by a timeslot
+                          per period. An underrun raises the latency by
+                          a frame at once and the guard by as much; the
+                          guard then wears off a timeslot per quiet
+                          period, so one hiccup does not hold the latency
+                          up for good. Recent slack decays by half every
+                          period and is shifted along with the latency.
+*/
+class TxLatencyController {
+public:
+	/** Start at 'latency' timeslots, never going below 'minLatency' */
+	TxLatencyController(int latency, int minLatency, int maxLatency);
+
+	/**
+	 * Record a wakeup of the transmit loop at frame 'fn' with 'slack'
+	 * timeslots queued ahead of the radio clock, and an underrun if one
+	 * was reported. Returns the latency to use, in timeslots; it only
+	 * changes if 'adapt' is set.
+	 */
+	int update(int fn, int slack, bool underrun, bool adapt);
+
+	/** Set the target share of wakeups, in tenths of a percent */
+	void setPercentile(int permille);
+
+	TxLatencyStats stats();
+
+private:
+	Mutex mLock;
+
+	int mLatency;
+	int mMinLatency;
+	int mMaxLatency;
+	int mGuard;
+	int mPercentile;
+
+	int mPeriodStart;		///< frame of the last decision
+	int mLastUnderrun;		///< frame of the last underrun response
+	bool mStarted;
+	bool mQuiet;			///< no underrun in this period
+
+	double mWindow[TXSLACK_BINS];	///< recent wakeups by slack, decaying
+
+	unsigned long mUnderruns;
+	unsigned long mRaised;
+	unsigned long mLowered;
+	unsigned long mSlack[TXSLACK_BINS];
+
+	void setLatency(int latency);
+	void decide();
+};
+
+#endif /* TXLATENCY_H */
@@ -0,0 +1,118 @@
+/*
+ * Fixed capacity memory pool
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "vectorPool.h"
+#include <Logger.h>
+
+VectorPool::VectorPool(size_t blockSize, int numBlocks)
+	: mNumBlocks(numBlocks), mNumFree(0), mExhausted(false)
+{
+	mBlockSize = (blockSize + VECTORPOOL_ALIGN - 1) & ~(VECTORPOOL_ALIGN - 1);
+
+	mArena = (char *) heapAlloc(mBlockSize * mNumBlocks);
+	assert(mArena);
+
+	/* Fault in the arena now rather than on the first bursts */
+	memset(mArena, 0, mBlockSize * mNumBlocks);
+
+	/* Hand out blocks in address order */
+	mFree = new void *[mNumBlocks];
+	for (int i = mNumBlocks - 1; i >= 0; i--)
+		mFree[mNumFree++] = mArena + i * mBlockSize;
+}
+
+VectorPool::~VectorPool()
+{
+	if (mNumFree != mNumBlocks)
+		LOG(ERROR) << mNumBlocks - mNumFree << " blocks still in use";
+
+	delete[] mFree;
+	heapRelease(mArena);
+}
+
+void *VectorPool::alloc(size_t size)
+{
+	void *ptr = NULL;
+
+	if (size <= mBlockSize) {
+		mLock.lock();
+		if (mNumFree) {
+			ptr = mFree[--mNumFree];
+		} else if (!mExhausted) {
+			LOG(WARN) << "pool of " << mNumBlocks
+				  << " blocks exhausted, using heap";
+			mExhausted = true;
+		}
+		mLock.unlock();
+	}
+
+	if (!ptr)
+		ptr = heapAlloc(size);
+
+	return ptr;
+}
+
+void VectorPool::release(void *ptr)
+{
+	char *block = (char *) ptr;
+
+	if (!ptr)
+		return;
+
+	if ((block < mArena) || (block >= mArena + mBlockSize * mNumBlocks)) {
+		heapRelease(ptr);
+		return;
+	}
+
+	assert(!((block - mArena) % mBlockSize));
+
+	mLock.lock();
+	assert(mNumFree < mNumBlocks);
+	mFree[mNumFree++] = ptr;
+	mLock.unlock();
+}
+
+int VectorPool::available()
+{
+	mLock.lock();
+	int num = mNumFree;
+	mLock.unlock();
+
+	return num;
+}
+
+void *VectorPool::heapAlloc(size_t size)
+{
+	void *ptr;
+
+	if (posix_memalign(&ptr, VECTORPOOL_ALIGN, size))
+		return NULL;
+
+	return ptr;
+}
+
+void VectorPool::heapRelease(void *ptr)
+{
+	free(ptr);
+}
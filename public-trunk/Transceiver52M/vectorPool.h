@@ -0,0 +1,74 @@
+/*
+ * Fixed capacity memory pool
+ *
+ * Copyright 2011 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef VECTORPOOL_H
+#define VECTORPOOL_H
+
+#include <stddef.h>
+#include "Threads.h"
+
+/* Alignment of pool blocks and heap fallback allocations in bytes */
+#define VECTORPOOL_ALIGN	32
+
+/*
+    VectorPool - Equally sized, aligned memory blocks carved out of a
+                 single arena that is allocated and touched up front. Blocks
+                 are handed out and returned through a lock protected free
+                 list, so steady state use does not reach the heap.
+
+                 Requests that do not fit in a block, or that arrive while
+                 the pool is exhausted, fall back to the heap. release()
+                 accepts either kind of block.
+*/
+class VectorPool {
+public:
+	/** Pool constructor
+	    @param blockSize size of each block in bytes
+	    @param numBlocks number of blocks in the arena
+	*/
+	VectorPool(size_t blockSize, int numBlocks);
+	~VectorPool();
+
+	/** Allocate a block of at least 'size' bytes */
+	void *alloc(size_t size);
+
+	/** Return a block from alloc() */
+	void release(void *ptr);
+
+	/** Number of free blocks in the arena */
+	int available();
+
+	/** Allocation and release for callers without a pool */
+	static void *heapAlloc(size_t size);
+	static void heapRelease(void *ptr);
+
+private:
+	size_t mBlockSize;
+	int mNumBlocks;
+	char *mArena;
+
+	void **mFree;
+	int mNumFree;
+	bool mExhausted;
+
+	Mutex mLock;
+};
+
+#endif /* VECTORPOOL_H */
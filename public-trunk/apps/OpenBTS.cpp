@@ -546,6 +546,21 @@ int main(int argc, char *argv[])
 	// Set maximum expected delay spread.
 	radio->setMaxDelay(gConfig.getNum("GSM.MaxExpectedDelaySpread"));
 
+	// Set how far the channel may move before the equalizer is redesigned.
+	if (gConfig.defines("TRX.DFE.ChannelDistance") && gConfig.defines("TRX.DFE.SNRDistance"))
+		radio->setDFEDistance(gConfig.getNum("TRX.DFE.ChannelDistance"),gConfig.getNum("TRX.DFE.SNRDistance"));
+
+	// Use the sequence estimator instead on traffic and dedicated control channels.
+	if (gConfig.defines("TRX.MLSE.TCH")) {
+		radio->setEqualizer(1,gConfig.getNum("TRX.MLSE.TCH"));
+		radio->setEqualizer(2,gConfig.getNum("TRX.MLSE.TCH"));
+		radio->setEqualizer(3,gConfig.getNum("TRX.MLSE.TCH"));
+	}
+	if (gConfig.defines("TRX.MLSE.SDCCH")) {
+		radio->setEqualizer(5,gConfig.getNum("TRX.MLSE.SDCCH"));
+		radio->setEqualizer(7,gConfig.getNum("TRX.MLSE.SDCCH"));
+	}
+
 	// Set Receiver Gain
 	radio->setRxGain(gConfig.getNum("GSM.RxGain"));
 